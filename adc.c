@@ -3,11 +3,27 @@
  *
  * Configures the ADC to sample on CH0 and store conversion
  * results into a circular buffer. Conversions are triggered
- * from the Timer0 CMPA signal.
+ * from the Timer0 CMPA signal (15.625 kHz) by default. Other
+ * sample rates are generated with Timer1 in CTC mode, which then
+ * triggers conversions from its CMPB signal.
+ *
+ * The ADC interrupt records the range of its entry times, in CPU
+ * cycles after the conversion trigger (see adc_latency). The minimum
+ * is the conversion time plus the interrupt response; anything above
+ * it is latency added by other interrupts or critical sections.
+ *
+ * In test pattern mode (adc_pattern) the ISR stores the next sample of
+ * a known sequence (pattern.h) in place of the conversion result, so
+ * lost or repeated samples can be found in the recording. In loopback
+ * mode (adc_loopback) results go to the self-test (loopback.c), which
+ * also sets the PWM output, instead of the buffer.
  *
  * Requires:
  *   timer	- Configures Timer0 to trigger ADC conversions. 
  *   buffer - Circular buffer (queue) used to store audio samples.
+ *   load - CPU load meter, accounts the ADC ISR run time.
+ *   pattern - Test pattern sequence.
+ *   loopback - Loopback self-test.
  *
  * Version: v1.0
  *    Date: 10/04/2016
@@ -22,6 +38,32 @@
 #include <avr/interrupt.h>
 
 #include "buffer.h"
+#include "adc.h"
+#include "load.h"
+#include "profile.h"
+#include "pattern.h"
+#include "loopback.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#ifndef F_CPU
+#define F_CPU	16000000UL	// System clock (Timer1 runs at /1)
+#endif
+
+#define ADC_TIMER0_PERIOD	(129 * 8)	// Timer0 trigger period in CPU cycles (OCR0A = 128, /8)
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static volatile uint8_t adcTimer1 = 0;		// Flag: conversions triggered by Timer1
+static volatile uint16_t adcPeriod = ADC_TIMER0_PERIOD;	// Trigger period in CPU cycles
+static volatile uint16_t latencyMin = 0xFFFF;	// Earliest ISR entry after trigger (cycles)
+static volatile uint16_t latencyMax = 0;		// Latest ISR entry after trigger (cycles)
+static volatile uint8_t adcPattern = 0;			// Flag: store the test pattern instead of conversions
+static volatile uint8_t patternLast = PATTERN_SEED;	// Last test pattern sample stored
+static volatile uint8_t patternBefore = 0;		// Test pattern sample before it
+static volatile uint8_t adcLoopback = 0;		// Flag: results go to the loopback self-test
 
 /************************************************************************/
 /* PUBLIC/USER FUNCTIONS                                                */
@@ -31,6 +73,100 @@ void adc_init() {
 	ADCSRB = 0x03;	// Select Timer0 CMPA as trigger	
 }
 
+/**
+ * Function: adc_set_rate
+ * 
+ * Selects the sample rate. The default rate (ADC_RATE_DEFAULT) uses
+ * the Timer0 CMPA trigger; any other rate runs Timer1 in CTC mode at
+ * 16 MHz and triggers on CMPB. Takes effect immediately.
+ *
+ * Parameters:
+ *    rate - Requested rate in samples per second (ADC_RATE_MIN to ADC_RATE_MAX).
+ *
+ * Returns: The rate actually achieved, or 0 if the request is out of range.
+ */
+uint16_t adc_set_rate(uint16_t rate) {
+	uint16_t top;
+	
+	if (rate < ADC_RATE_MIN || rate > ADC_RATE_MAX) return 0;
+	
+	if (rate == ADC_RATE_DEFAULT) {
+		TCCR1B = 0x00;	// Stop Timer1
+		ADCSRB = 0x03;	// Select Timer0 CMPA as trigger
+		adcTimer1 = 0;
+		adcPeriod = ADC_TIMER0_PERIOD;
+		return ADC_RATE_DEFAULT;
+	}
+	
+	top = (F_CPU + rate / 2) / rate - 1;
+	TCCR1B = 0x00;	// Stop Timer1 while reconfiguring
+	TCCR1A = 0x00;	// CTC mode (top = OCR1A), no outputs
+	OCR1A = top;
+	OCR1B = 0;		// Trigger at the start of each period
+	TCNT1 = 0;
+	TIMSK1 = 0x00;	// No Timer1 interrupts (flag cleared by ADC ISR)
+	TCCR1B = 0x09;	// CTC mode, /1 prescaler, start timer
+	ADCSRB = 0x05;	// Select Timer1 CMPB as trigger
+	adcTimer1 = 1;
+	adcPeriod = top + 1;
+	
+	return F_CPU / (top + 1);
+}
+
+/**
+ * Function: adc_latency
+ * 
+ * Returns the range of ADC interrupt entry times since the last call,
+ * in CPU cycles after the conversion trigger, and starts a new
+ * measurement. Both values are 0 if no conversions completed.
+ *
+ * Parameters:
+ *    min - Receives the earliest entry time (conversion + response).
+ *    max - Receives the latest entry time (worst case latency).
+ */
+void adc_latency(uint16_t* min, uint16_t* max) {
+	uint8_t sreg = SREG;
+	
+	cli();
+	*min = (latencyMin == 0xFFFF) ? 0 : latencyMin;
+	*max = latencyMax;
+	latencyMin = 0xFFFF;
+	latencyMax = 0;
+	SREG = sreg;
+}
+
+/**
+ * Function: adc_pattern
+ * 
+ * Selects test pattern mode. The sequence restarts from PATTERN_SEED
+ * on every call, so call it before a take starts (not on resume).
+ *
+ * Parameters:
+ *    on - Non-zero to store the test pattern, 0 for conversion results.
+ */
+void adc_pattern(uint8_t on) {
+	uint8_t sreg = SREG;
+	
+	cli();
+	adcPattern = on;
+	patternLast = PATTERN_SEED;
+	patternBefore = 0;
+	SREG = sreg;
+}
+
+/**
+ * Function: adc_loopback
+ * 
+ * Sends conversion results to the loopback self-test (loopback_sample)
+ * instead of the buffer.
+ *
+ * Parameters:
+ *    on - Non-zero for the self-test, 0 for the buffer.
+ */
+void adc_loopback(uint8_t on) {
+	adcLoopback = on;
+}
+
 void adc_start() {
 	ADCSRA = 0xAE;	// /64 prescaler (250 kHz clock), enable interrupts, ADC enable
 }
@@ -49,6 +185,24 @@ void adc_stop() {
  * Interrupt service routine which executes on completion of ADC conversion.
  */
 ISR(ADC_vect) {
+	uint16_t entry = adcTimer1 ? TCNT1 : (uint16_t)TCNT0 << 3;	//Cycles since trigger
+	LOAD_ENTER();
 	uint8_t result = ADCH;	//Read result
-	buffer_queue(result);	//Store result into buffer
+	if (adcPattern) {		//Test pattern replaces the result
+		result = PATTERN_NEXT(patternLast, patternBefore);
+		patternBefore = patternLast;
+		patternLast = result;
+	}
+	TIFR1 = (1<<OCF1B);		//Re-arm Timer1 trigger (no Timer1 ISR to clear it)
+	if (adcLoopback) {
+		loopback_sample(result);	//Self-test input, sets the next output
+	} else {
+		buffer_queue(result);	//Store result into buffer
+	}
+	
+	if (entry < adcPeriod / 2) entry += adcPeriod;	//Entered after the next trigger
+	if (entry > latencyMax) latencyMax = entry;
+	if (entry < latencyMin) latencyMin = entry;
+	PROFILE_LATENCY(PROFILE_ADC, entry);
+	LOAD_EXIT(LOAD_ADC);
 }
\ No newline at end of file
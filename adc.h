@@ -10,8 +10,17 @@
 #ifndef ADC_H_
 #define ADC_H_
 
+// Sample rate limits (samples per second)
+#define ADC_RATE_DEFAULT	15625	// Timer0 rate
+#define ADC_RATE_MIN		4000
+#define ADC_RATE_MAX		16000	// Limited by 250 kHz ADC clock (13 cycles/conversion)
+
 void adc_init();	// Initialises ADC
+uint16_t adc_set_rate(uint16_t rate);	// Selects the sample rate, returns actual rate (0 if invalid)
 void adc_start();	// Enables ADC to start conversions (triggered by Timer0 CMPA)
 void adc_stop();	// Disables ADC conversions
+void adc_pattern(uint8_t on);	// Stores the test pattern (pattern.h) instead of conversions, restarts the sequence
+void adc_loopback(uint8_t on);	// Sends results to the loopback self-test (loopback.h) instead of the buffer
+void adc_latency(uint16_t* min, uint16_t* max);	// Returns and resets ISR entry time range (cycles after trigger)
 
 #endif /* ADC_H_ */
\ No newline at end of file
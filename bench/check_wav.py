@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""
+check_wav.py - EGB240DVR simulator bench, recording checker
+
+Checks a WAVE file recorded under the simulator (dvrsim) against the
+log of every sample the ADC converted during the run:
+
+  - header: RIFF/WAVE, PCM, 8-bit mono, sample rate, and chunk sizes
+    consistent with the file length
+  - data: each 512 byte page of the recording is located in the ADC
+    log. Samples skipped between consecutive pages are reported as
+    dropped, pages found out of order as duplicated/reordered and
+    pages not found at all as corrupt.
+
+Usage:
+    python3 check_wav.py [--rate HZ] out.wav adc.log
+
+The exit status is 0 only if the header is valid and no samples were
+lost, repeated or corrupted.
+"""
+
+import argparse
+import struct
+import sys
+
+PAGE = 512              # Bytes per buffer page (pageSize in main.c)
+HEADER = 44             # Canonical WAVE header written by wave.c
+
+
+def check_header(wav, rate):
+    """Returns a list of header problems (empty if valid)."""
+    errors = []
+    if len(wav) < HEADER:
+        return ["file too short for a WAVE header (%d bytes)" % len(wav)]
+    (riff, riff_size, wave, fmt, fmt_size, audio, channels, sample_rate,
+     byte_rate, align, bits, data, data_size) = struct.unpack("<4sI4s4sIHHIIHH4sI", wav[:HEADER])
+    if riff != b"RIFF" or wave != b"WAVE" or fmt != b"fmt " or data != b"data":
+        errors.append("bad chunk identifiers")
+    if riff_size != len(wav) - 8:
+        errors.append("RIFF size %d, expected %d" % (riff_size, len(wav) - 8))
+    if fmt_size != 16 or audio != 1:
+        errors.append("not a PCM format chunk")
+    if channels != 1 or bits != 8 or align != 1:
+        errors.append("not 8-bit mono (%d channels, %d bits)" % (channels, bits))
+    if sample_rate != rate or byte_rate != rate:
+        errors.append("sample rate %d (byte rate %d), expected %d" % (sample_rate, byte_rate, rate))
+    if data_size != len(wav) - HEADER:
+        errors.append("data size %d, expected %d" % (data_size, len(wav) - HEADER))
+    return errors
+
+
+def check_data(data, log):
+    """Aligns the recording with the ADC log page by page.
+
+    Returns (pages, dropped, problems) where problems lists
+    human-readable descriptions of every discontinuity.
+    """
+    problems = []
+    dropped = 0
+    cursor = None       # Log offset where the next page should start
+
+    pages = (len(data) + PAGE - 1) // PAGE
+    for page in range(pages):
+        chunk = data[page * PAGE:(page + 1) * PAGE]
+        if cursor is None:
+            found = log.find(chunk)
+            if found < 0:
+                problems.append("page 0: not found in ADC log (corrupt, or the ADC model in dvrsim.c does not match simavr)")
+                continue
+            cursor = found
+        if log.startswith(chunk, cursor):
+            cursor += len(chunk)
+            continue
+        found = log.find(chunk, cursor)
+        if found >= 0:
+            dropped += found - cursor
+            problems.append("page %d (sample %d): %d samples dropped" % (page, page * PAGE, found - cursor))
+            cursor = found + len(chunk)
+        elif log.find(chunk) >= 0:
+            problems.append("page %d (sample %d): duplicated or out of order" % (page, page * PAGE))
+        else:
+            problems.append("page %d (sample %d): not found in ADC log (corrupt)" % (page, page * PAGE))
+            cursor += len(chunk)
+    return pages, dropped, problems
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Check a simulated recording against the ADC log")
+    parser.add_argument("--rate", type=int, default=15625, help="expected sample rate (default 15625)")
+    parser.add_argument("wav")
+    parser.add_argument("log")
+    args = parser.parse_args()
+
+    with open(args.wav, "rb") as f:
+        wav = f.read()
+    with open(args.log, "rb") as f:
+        log = f.read()
+
+    errors = check_header(wav, args.rate)
+    for error in errors:
+        print("header: %s" % error)
+    data = wav[HEADER:]
+    pages, dropped, problems = check_data(data, log)
+    for problem in problems:
+        print(problem)
+
+    print("Recorded samples      %d (%.3f s)" % (len(data), len(data) / float(args.rate)))
+    print("ADC conversions       %d" % len(log))
+    print("Pages                 %d" % pages)
+    print("Dropped samples       %d" % dropped)
+    print("Discontinuities       %d" % len(problems))
+    print("WAVE file             %s" % ("FAIL" if errors or problems else "OK"))
+    return 1 if errors or problems else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,309 @@
+/**
+ * dvrsim.c - EGB240DVR simulator bench
+ *
+ * Runs the firmware ELF on a simulated ATmega32U4 (simavr) with an SD
+ * card model on the SPI port (sdcard.c) and a scripted analog input on
+ * ADC0, presses the record button and lets the recorder take its 10 s
+ * recording. Every sample the ADC converts is also written to a log so
+ * that check_wav.py can compare the recorded WAVE file against exactly
+ * what went in.
+ *
+ * Reports, for the whole run:
+ *   - CPU time per interrupt vector, foreground and sleep (ISR load)
+ *   - ADC conversions, SD blocks written/read, card busy time and the
+ *     time the card was selected (SD busy time)
+ *
+ * Usage: dvrsim [options] firmware.elf card.img adc.log
+ *   -t s    Simulated run time (default 12 s)
+ *   -p s    Record button press time (default 0.5 s)
+ *   -w us   Card busy time per block written (default 800 us)
+ *   -n n    Every n-th block written stalls... (default 256, 0: never)
+ *   -s ms   ...for this long (default 150 ms)
+ *
+ * Requires:
+ *   simavr (1.6 or later) - AVR simulator library, with libelf
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "avr_adc.h"
+#include "avr_ioport.h"
+#include "avr_spi.h"
+
+#include "sdcard.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define F_CPU			16000000UL
+#define VCC_MV			5000		// AVCC, the ADC reference
+#define US(us)			((uint64_t)(us) * (F_CPU / 1000000))	// Microseconds to cycles
+#define SECONDS(s)		((uint64_t)((s) * F_CPU))				// Seconds to cycles
+
+#define PIN_CS			7			// SD card chip select, PB7
+#define PIN_RECORD		5			// Record button, PF5 (active low)
+#define PRESS_TIME		0.1			// Button held for 100 ms
+
+#define VECTORS			43			// Interrupt vectors on the ATmega32U4
+
+#define PLLCSR			0x49		// PLL control and status register (data address)
+#define PLLCSR_PLLE		0x02		// PLL enable
+#define PLLCSR_PLOCK	0x01		// PLL lock
+
+// Scripted input: a linear chirp over the recording plus noise, so that
+// every page of samples is unique and can be located in the log
+#define CHIRP_START		100.0		// Hz
+#define CHIRP_END		3000.0		// Hz
+#define CHIRP_TIME		10.0		// s
+#define CHIRP_MV		1800.0		// Peak amplitude around VCC/2
+#define NOISE_MV		40			// Peak noise
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static avr_t* avr;
+static SDCARD card;
+static FILE* adcLog;
+static uint32_t conversions;		// ADC conversions started
+static uint32_t noise = 1;			// Noise generator state
+
+static const char* vectorNames[VECTORS] = {
+	[0] = "(reset)", [10] = "USB_GEN", [11] = "USB_COM", [12] = "WDT",
+	[18] = "TIMER1_COMPB", [21] = "TIMER0_COMPA", [29] = "ADC", [41] = "TIMER4_OVF",
+};
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+/**
+ * Function: input_mv
+ *
+ * Scripted analog input on ADC0.
+ *
+ * Returns: The input voltage in mV at the given cycle.
+ */
+static uint32_t input_mv(uint64_t cycle) {
+	double t = fmod((double)cycle / F_CPU, CHIRP_TIME);
+	double phase = 2 * M_PI * (CHIRP_START * t + (CHIRP_END - CHIRP_START) * t * t / (2 * CHIRP_TIME));
+	int32_t mv;
+
+	noise = noise * 1103515245 + 12345;
+	mv = VCC_MV / 2 + (int32_t)(CHIRP_MV * sin(phase)) + (int32_t)((noise >> 16) % (2 * NOISE_MV + 1)) - NOISE_MV;
+	return mv < 0 ? 0 : mv > VCC_MV ? VCC_MV : mv;
+}
+
+/**
+ * Function: adc_trigger
+ *
+ * Called by simavr as each conversion starts. Supplies the input and
+ * logs the 8-bit result the firmware will read (ADLAR set: ADCH holds
+ * the top 8 of 10 bits). The expected result follows simavr's single
+ * ended conversion, mV * 0x3FF / AVCC truncated, shifted left 6 for
+ * ADLAR. If a simavr version rounds differently no page of the
+ * recording matches the log, and check_wav.py reports page 0 corrupt.
+ */
+static void adc_trigger(struct avr_irq_t* irq, uint32_t value, void* param) {
+	uint32_t mv = input_mv(avr->cycle);
+	uint8_t expected = ((mv * 1023) / VCC_MV) >> 2;
+
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC0), mv);
+	fputc(expected, adcLog);
+	conversions++;
+}
+
+/**
+ * Function: spi_output
+ *
+ * Called by simavr for every byte the firmware shifts out; the card's
+ * reply is shifted back in.
+ */
+static void spi_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+	uint8_t miso = sdcard_exchange(&card, value, avr->cycle);
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_INPUT), miso);
+}
+
+/**
+ * Function: chip_select
+ *
+ * Called by simavr when PB7 changes.
+ */
+static void chip_select(struct avr_irq_t* irq, uint32_t value, void* param) {
+	sdcard_select(&card, !value, avr->cycle);
+}
+
+/**
+ * Function: button
+ *
+ * Drives a button input on PORTF (pressed pulls the pin low).
+ */
+static void button(uint8_t pin, uint8_t pressed) {
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('F'), pin), !pressed);
+}
+
+static double ms(uint64_t cycles) {
+	return cycles * 1000.0 / F_CPU;
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+	return whole ? part * 100.0 / whole : 0;
+}
+
+static void usage() {
+	fprintf(stderr, "usage: dvrsim [-t s] [-p s] [-w us] [-n blocks] [-s ms] firmware.elf card.img adc.log\n");
+	exit(2);
+}
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+int main(int argc, char* argv[]) {
+	elf_firmware_t firmware;
+	double runTime = 12.0, pressTime = 0.5;
+	uint32_t writeUs = 800, stallEvery = 256, stallMs = 150;
+	uint64_t end, press, release;
+	uint64_t isr[VECTORS] = { 0 };
+	uint64_t idle = 0, foreground = 0, interrupts = 0;
+	uint8_t pressed = 0;
+	int state = cpu_Running;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "t:p:w:n:s:")) != -1) {
+		switch (opt) {
+			case 't': runTime = atof(optarg); break;
+			case 'p': pressTime = atof(optarg); break;
+			case 'w': writeUs = atoi(optarg); break;
+			case 'n': stallEvery = atoi(optarg); break;
+			case 's': stallMs = atoi(optarg); break;
+			default: usage();
+		}
+	}
+	if (argc - optind != 3) usage();
+
+	// Firmware and simulated MCU
+	memset(&firmware, 0, sizeof(firmware));
+	if (elf_read_firmware(argv[optind], &firmware)) {
+		fprintf(stderr, "dvrsim: cannot load %s\n", argv[optind]);
+		return 1;
+	}
+	strcpy(firmware.mmcu, "atmega32u4");
+	firmware.frequency = F_CPU;
+	firmware.vcc = firmware.avcc = firmware.aref = VCC_MV;
+	avr = avr_make_mcu_by_name(firmware.mmcu);
+	if (!avr) {
+		fprintf(stderr, "dvrsim: simavr has no atmega32u4 core\n");
+		return 1;
+	}
+	avr_init(avr);
+	avr_load_firmware(avr, &firmware);
+
+	// SD card on SPI, selected by PB7
+	if (sdcard_open(&card, argv[optind + 1])) {
+		fprintf(stderr, "dvrsim: cannot open %s\n", argv[optind + 1]);
+		return 1;
+	}
+	card.writeBusy = US(writeUs);
+	card.stallEvery = stallEvery;
+	card.stallBusy = US(stallMs * 1000);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_OUTPUT), spi_output, NULL);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), PIN_CS), chip_select, NULL);
+
+	// Scripted input on ADC0
+	adcLog = fopen(argv[optind + 2], "wb");
+	if (!adcLog) {
+		fprintf(stderr, "dvrsim: cannot create %s\n", argv[optind + 2]);
+		return 1;
+	}
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_OUT_TRIGGER), adc_trigger, NULL);
+
+	// Buttons released (external pull-ups)
+	for (i = 4; i <= 6; i++) button(i, 0);
+
+	end = SECONDS(runTime);
+	press = SECONDS(pressTime);
+	release = press + SECONDS(PRESS_TIME);
+
+	// Run, charging every step to the interrupt being serviced, the
+	// foreground or sleep
+	while (avr->cycle < end && state != cpu_Done && state != cpu_Crashed) {
+		uint64_t before = avr->cycle;
+		int sleeping = avr->state == cpu_Sleeping;
+		uint8_t nested = avr->interrupts.running_ptr;
+		uint8_t vector = nested ? avr->interrupts.running[nested - 1]->vector : 0;
+
+		state = avr_run(avr);
+
+		// The firmware waits for PLL lock before starting USB; lock at
+		// once if the core does not model the PLL
+		if ((avr->data[PLLCSR] & (PLLCSR_PLLE | PLLCSR_PLOCK)) == PLLCSR_PLLE) {
+			avr->data[PLLCSR] |= PLLCSR_PLOCK;
+		}
+
+		if (sleeping) {
+			idle += avr->cycle - before;
+		} else if (nested) {
+			isr[vector < VECTORS ? vector : 0] += avr->cycle - before;
+		} else {
+			foreground += avr->cycle - before;
+		}
+
+		if (!pressed && avr->cycle >= press) {
+			button(PIN_RECORD, 1);
+			pressed = 1;
+		} else if (pressed == 1 && avr->cycle >= release) {
+			button(PIN_RECORD, 0);
+			pressed = 2;
+		}
+	}
+	sdcard_select(&card, 0, avr->cycle);
+	sdcard_close(&card);
+	fclose(adcLog);
+
+	if (state == cpu_Crashed) {
+		fprintf(stderr, "dvrsim: firmware crashed at PC 0x%04x\n", avr->pc);
+		return 1;
+	}
+	if (!conversions) {
+		fprintf(stderr, "dvrsim: no ADC conversion after the record press, firmware at PC 0x%04x\n", avr->pc);
+		return 1;
+	}
+
+	// Report
+	printf("Simulated %.3f s (%llu cycles)\n\n", avr->cycle / (double)F_CPU, (unsigned long long)avr->cycle);
+	printf("CPU time              ms       %%\n");
+	for (i = 0; i < VECTORS; i++) {
+		if (!isr[i]) continue;
+		interrupts += isr[i];
+		if (vectorNames[i]) {
+			printf("  %-14s %10.1f %7.2f\n", vectorNames[i], ms(isr[i]), percent(isr[i], avr->cycle));
+		} else {
+			printf("  vector %-7d %10.1f %7.2f\n", i, ms(isr[i]), percent(isr[i], avr->cycle));
+		}
+	}
+	printf("  %-14s %10.1f %7.2f\n", "all ISRs", ms(interrupts), percent(interrupts, avr->cycle));
+	printf("  %-14s %10.1f %7.2f\n", "foreground", ms(foreground), percent(foreground, avr->cycle));
+	printf("  %-14s %10.1f %7.2f\n\n", "sleep", ms(idle), percent(idle, avr->cycle));
+
+	printf("ADC conversions       %u\n", conversions);
+	printf("SD blocks written     %u\n", card.blocksWritten);
+	printf("SD blocks read        %u\n", card.blocksRead);
+	printf("SD busy               %.1f ms (%.2f %%), longest %.1f ms, %u stalls\n",
+		ms(card.busyCycles), percent(card.busyCycles, avr->cycle), ms(card.busyMax), card.stalls);
+	printf("SD selected           %.1f ms (%.2f %%)\n", ms(card.selectedCycles), percent(card.selectedCycles, avr->cycle));
+
+	return 0;
+}
@@ -0,0 +1,350 @@
+/**
+ * sdcard.c - EGB240DVR simulator bench, SD card model
+ *
+ * Byte level model of an SDHC card in SPI mode. The host side is the
+ * firmware's SPI port as simulated by simavr: every byte shifted out
+ * by the firmware is passed to sdcard_exchange, which returns the byte
+ * shifted back in. Responses are queued and shifted out in order;
+ * when nothing is queued the card returns 0xFF, or 0x00 while it is
+ * busy programming a block.
+ *
+ * Supported commands: CMD0, CMD8, CMD9, CMD10, CMD12, CMD13, CMD16,
+ * CMD17, CMD18, CMD24, CMD25, CMD55, CMD58, ACMD13, ACMD23, ACMD41.
+ * The card always reports block addressing (CCS set in the OCR).
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <string.h>
+
+#include "sdcard.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define SD_MODE_CMD			0	// Waiting for a command
+#define SD_MODE_READ_MULTI	1	// Streaming blocks until CMD12
+#define SD_MODE_WRITE_TOKEN	2	// Waiting for a data token
+#define SD_MODE_WRITE_DATA	3	// Receiving a block
+
+#define SD_TOKEN_SINGLE		0xFE	// Start block (single write and all reads)
+#define SD_TOKEN_MULTI		0xFC	// Start block (multiple write)
+#define SD_TOKEN_STOP		0xFD	// Stop transmission (multiple write)
+
+#define R1_IDLE				0x01
+#define R1_ILLEGAL			0x04
+#define R1_ADDRESS			0x20
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+/**
+ * Function: sd_put
+ *
+ * Queues bytes to be shifted out to the host.
+ */
+static void sd_put(SDCARD* card, const uint8_t* bytes, uint16_t count) {
+	while (count--) {
+		card->queue[card->head] = *bytes++;
+		card->head = (card->head + 1) & (SDCARD_QUEUE - 1);
+	}
+}
+
+static void sd_put1(SDCARD* card, uint8_t byte) {
+	sd_put(card, &byte, 1);
+}
+
+/**
+ * Function: sd_put_block
+ *
+ * Queues a data block: one byte of access time, the start token,
+ * the data and a dummy CRC.
+ */
+static void sd_put_block(SDCARD* card, const uint8_t* data, uint16_t count) {
+	static const uint8_t crc[2] = { 0xFF, 0xFF };
+
+	sd_put1(card, 0xFF);
+	sd_put1(card, SD_TOKEN_SINGLE);
+	sd_put(card, data, count);
+	sd_put(card, crc, 2);
+}
+
+/**
+ * Function: sd_read_block
+ *
+ * Queues the next block of a single or multiple block read.
+ *
+ * Returns: 0 on success, -1 if the address is beyond the card.
+ */
+static int sd_read_block(SDCARD* card) {
+	uint8_t block[SDCARD_BLOCK];
+
+	if (card->address >= card->blocks) return -1;
+	fseek(card->image, (long)card->address * SDCARD_BLOCK, SEEK_SET);
+	if (fread(block, 1, SDCARD_BLOCK, card->image) != SDCARD_BLOCK) memset(block, 0, SDCARD_BLOCK);
+	sd_put_block(card, block, SDCARD_BLOCK);
+	card->address++;
+	card->blocksRead++;
+	return 0;
+}
+
+/**
+ * Function: sd_write_block
+ *
+ * Stores a received block and starts the programming (busy) period.
+ */
+static void sd_write_block(SDCARD* card, uint64_t cycle) {
+	uint64_t busy = card->writeBusy;
+
+	if (card->address < card->blocks) {
+		fseek(card->image, (long)card->address * SDCARD_BLOCK, SEEK_SET);
+		fwrite(card->data, 1, SDCARD_BLOCK, card->image);
+		sd_put1(card, 0x05);				// Data accepted
+	} else {
+		sd_put1(card, 0x0D);				// Write error
+	}
+	card->address++;
+	card->blocksWritten++;
+
+	// Wear levelling and erase: real cards occasionally stall for many ms
+	if (card->stallEvery && card->stallBusy && !(card->blocksWritten % card->stallEvery)) {
+		busy = card->stallBusy;
+		card->stalls++;
+	}
+	card->busyUntil = cycle + busy;
+	card->busyCycles += busy;
+	if (busy > card->busyMax) card->busyMax = busy;
+}
+
+/**
+ * Function: sd_command
+ *
+ * Executes a complete command frame and queues its response.
+ */
+static void sd_command(SDCARD* card) {
+	uint8_t index = card->cmd[0] & 0x3F;
+	uint32_t arg = ((uint32_t)card->cmd[1] << 24) | ((uint32_t)card->cmd[2] << 16) | ((uint32_t)card->cmd[3] << 8) | card->cmd[4];
+	uint8_t app = card->app;
+	uint8_t r1 = card->idle ? R1_IDLE : 0;
+	uint8_t reg[16];
+
+	card->app = 0;
+	sd_put1(card, 0xFF);					// Command response time (NCR)
+	if (index == 12) sd_put1(card, 0xFF);	// Stuff byte discarded by the host
+
+	switch (index) {
+		case 0:								// GO_IDLE_STATE
+			card->idle = 1;
+			card->mode = SD_MODE_CMD;
+			sd_put1(card, R1_IDLE);
+			break;
+		case 8:								// SEND_IF_COND: echo voltage and check pattern
+			sd_put1(card, r1);
+			reg[0] = 0; reg[1] = 0; reg[2] = arg >> 8 & 0x0F; reg[3] = arg & 0xFF;
+			sd_put(card, reg, 4);
+			break;
+		case 9: {							// SEND_CSD (version 2.0)
+			uint32_t size = card->blocks / 1024 - 1;	// C_SIZE, 512 KB units
+			static const uint8_t csd[16] = { 0x40, 0x0E, 0x00, 0x32, 0x5B, 0x59, 0x00, 0, 0, 0, 0x7F, 0x80, 0x0A, 0x40, 0x00, 0x01 };
+			memcpy(reg, csd, 16);
+			reg[7] = size >> 16 & 0x3F; reg[8] = size >> 8; reg[9] = size;
+			sd_put1(card, r1);
+			sd_put_block(card, reg, 16);
+			break;
+		}
+		case 10: {							// SEND_CID
+			static const uint8_t cid[16] = { 0x03, 'S', 'D', 'S', 'I', 'M', 'A', 'V', 0x10, 0, 0, 0, 1, 0x01, 0xA0, 0x01 };
+			sd_put1(card, r1);
+			sd_put_block(card, cid, 16);
+			break;
+		}
+		case 12:							// STOP_TRANSMISSION
+			card->mode = SD_MODE_CMD;
+			sd_put1(card, r1);
+			break;
+		case 13:							// SEND_STATUS (ACMD13: SD_STATUS)
+			sd_put1(card, r1);
+			sd_put1(card, 0);
+			if (app) {
+				memset(reg, 0, 16);
+				sd_put_block(card, reg, 16);	// Only the first 16 of 64 bytes are read
+			}
+			break;
+		case 16:							// SET_BLOCKLEN
+		case 23:							// ACMD23: SET_WR_BLK_ERASE_COUNT
+			sd_put1(card, r1);
+			break;
+		case 17:							// READ_SINGLE_BLOCK
+		case 18:							// READ_MULTIPLE_BLOCK
+			card->address = arg;
+			if (arg >= card->blocks) {
+				sd_put1(card, r1 | R1_ADDRESS);
+				break;
+			}
+			sd_put1(card, r1);
+			sd_read_block(card);
+			if (index == 18) card->mode = SD_MODE_READ_MULTI;
+			break;
+		case 24:							// WRITE_BLOCK
+		case 25:							// WRITE_MULTIPLE_BLOCK
+			card->address = arg;
+			if (arg >= card->blocks) {
+				sd_put1(card, r1 | R1_ADDRESS);
+				break;
+			}
+			sd_put1(card, r1);
+			card->mode = SD_MODE_WRITE_TOKEN;
+			break;
+		case 41:							// ACMD41: SD_SEND_OP_COND
+			if (!app) {
+				sd_put1(card, r1 | R1_ILLEGAL);
+				break;
+			}
+			sd_put1(card, r1);				// Reports idle once, ready on the retry
+			card->idle = 0;
+			break;
+		case 55:							// APP_CMD
+			card->app = 1;
+			sd_put1(card, r1);
+			break;
+		case 58:							// READ_OCR: powered up, CCS set
+			sd_put1(card, r1);
+			reg[0] = 0xC0; reg[1] = 0xFF; reg[2] = 0x80; reg[3] = 0x00;
+			sd_put(card, reg, 4);
+			break;
+		default:
+			sd_put1(card, r1 | R1_ILLEGAL);
+			break;
+	}
+}
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: sdcard_open
+ *
+ * Attaches a disk image. The card size is the image size rounded down
+ * to whole blocks. The timing model is left at zero (an infinitely
+ * fast card) for the caller to set.
+ *
+ * Returns: 0 on success, -1 if the image cannot be opened.
+ */
+int sdcard_open(SDCARD* card, const char* path) {
+	long size;
+
+	memset(card, 0, sizeof(*card));
+	card->image = fopen(path, "r+b");
+	if (!card->image) return -1;
+	fseek(card->image, 0, SEEK_END);
+	size = ftell(card->image);
+	card->blocks = size / SDCARD_BLOCK;
+	card->idle = 1;
+	return 0;
+}
+
+/**
+ * Function: sdcard_close
+ *
+ * Detaches the disk image, flushing all written blocks.
+ */
+void sdcard_close(SDCARD* card) {
+	if (card->image) fclose(card->image);
+	card->image = NULL;
+}
+
+/**
+ * Function: sdcard_select
+ *
+ * Tracks the chip select line (PB7, active low). The card ignores the
+ * bus while deselected; a programming period continues regardless.
+ */
+void sdcard_select(SDCARD* card, uint8_t selected, uint64_t cycle) {
+	if (selected == card->selected) return;
+	card->selected = selected;
+	if (selected) {
+		card->selectedAt = cycle;
+	} else {
+		card->selectedCycles += cycle - card->selectedAt;
+		card->cmdLen = 0;
+	}
+}
+
+/**
+ * Function: sdcard_exchange
+ *
+ * Shifts one byte in from the host and one byte out to it.
+ *
+ * Parameters:
+ *    mosi - Byte sent by the host.
+ *    cycle - Current CPU cycle, for the busy timing.
+ *
+ * Returns: The byte received by the host.
+ */
+uint8_t sdcard_exchange(SDCARD* card, uint8_t mosi, uint64_t cycle) {
+	uint8_t miso = 0xFF;
+
+	if (!card->selected) return 0xFF;
+
+	// Output side: queued response, else busy or idle bus
+	if (card->tail != card->head) {
+		miso = card->queue[card->tail];
+		card->tail = (card->tail + 1) & (SDCARD_QUEUE - 1);
+	} else if (cycle < card->busyUntil) {
+		miso = 0x00;
+	}
+
+	// Input side
+	switch (card->mode) {
+		case SD_MODE_WRITE_TOKEN:
+			if (mosi == SD_TOKEN_SINGLE || mosi == SD_TOKEN_MULTI) {
+				card->mode = SD_MODE_WRITE_DATA;
+				card->dataLen = 0;
+			} else if (mosi == SD_TOKEN_STOP) {
+				card->mode = SD_MODE_CMD;
+				card->busyUntil = cycle + card->writeBusy;	// Finishing the last block
+			} else if ((mosi & 0xC0) == 0x40) {
+				card->mode = SD_MODE_CMD;			// Host gave up on the write
+				card->cmd[0] = mosi;
+				card->cmdLen = 1;
+			}
+			break;
+		case SD_MODE_WRITE_DATA:
+			card->data[card->dataLen++] = mosi;
+			if (card->dataLen == sizeof(card->data)) {
+				sd_write_block(card, cycle);
+				// Single block writes end here, multiple block writes wait for the next token
+				card->mode = (card->cmd[0] & 0x3F) == 25 ? SD_MODE_WRITE_TOKEN : SD_MODE_CMD;
+			}
+			break;
+		case SD_MODE_READ_MULTI:
+			if (mosi == (0x40 | 12)) {
+				card->cmd[0] = mosi;				// STOP_TRANSMISSION interrupts the stream
+				card->cmdLen = 1;
+				card->head = card->tail;
+				miso = 0xFF;
+				card->mode = SD_MODE_CMD;
+			} else if (card->tail == card->head && sd_read_block(card)) {
+				card->mode = SD_MODE_CMD;			// Ran off the end of the card
+			}
+			break;
+		default:
+			if (card->cmdLen || (mosi & 0xC0) == 0x40) {
+				card->cmd[card->cmdLen++] = mosi;
+				if (card->cmdLen == sizeof(card->cmd)) {
+					card->cmdLen = 0;
+					sd_command(card);
+				}
+			}
+			break;
+	}
+
+	return miso;
+}
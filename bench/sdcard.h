@@ -0,0 +1,63 @@
+/**
+ * sdcard.h - EGB240DVR simulator bench, SD card model header
+ *
+ * SPI mode SDHC card backed by a disk image file, for the simavr
+ * based benchmark (see dvrsim.c). Implements the command subset used
+ * by lib/fatfs/mmc_avr.c and models the card's programming (busy)
+ * time after every written block, including the occasional long
+ * stall of real cards, so the record pipeline sees realistic
+ * back pressure.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef SDCARD_H_
+#define SDCARD_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define SDCARD_BLOCK	512		// Bytes per block
+#define SDCARD_QUEUE	1024	// Response bytes queued for the host (power of 2)
+
+typedef struct {
+	FILE* image;				// Disk image, one block per 512 bytes
+	uint32_t blocks;			// Card capacity in blocks
+
+	// Timing model (CPU cycles)
+	uint64_t writeBusy;			// Busy time after each block written
+	uint32_t stallEvery;		// Every n-th block written takes...
+	uint64_t stallBusy;			// ...this long instead (0: never)
+
+	// Protocol state
+	uint8_t selected;			// Chip select asserted
+	uint8_t mode;				// SD_MODE_*, see sdcard.c
+	uint8_t idle;				// In idle state (before ACMD41 completes)
+	uint8_t app;				// Next command is an application command
+	uint8_t cmd[6];				// Command frame being received
+	uint8_t cmdLen;
+	uint32_t address;			// Next block of a read/write
+	uint8_t data[SDCARD_BLOCK + 2];	// Block being received (with CRC)
+	uint16_t dataLen;
+	uint8_t queue[SDCARD_QUEUE];	// Bytes to shift out
+	uint16_t head, tail;
+	uint64_t busyUntil;			// DO held low (busy) until this cycle
+
+	// Statistics
+	uint32_t blocksRead;
+	uint32_t blocksWritten;
+	uint32_t stalls;
+	uint64_t busyCycles;		// Total programming time
+	uint64_t busyMax;			// Longest single busy period
+	uint64_t selectedCycles;	// Time spent with chip select asserted
+	uint64_t selectedAt;
+} SDCARD;
+
+int sdcard_open(SDCARD* card, const char* path);			// Opens the image, returns 0 on success
+void sdcard_close(SDCARD* card);							// Flushes and closes the image
+void sdcard_select(SDCARD* card, uint8_t selected, uint64_t cycle);	// Chip select changed
+uint8_t sdcard_exchange(SDCARD* card, uint8_t mosi, uint64_t cycle);	// One SPI byte, returns MISO
+
+#endif /* SDCARD_H_ */
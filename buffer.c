@@ -21,6 +21,7 @@
 /* INCLUDED LIBRARIES/HEADER FILES                                      */
 /************************************************************************/
 #include <avr/io.h>
+#include <avr/interrupt.h>
 
 /************************************************************************/
 /* GLOBAL VARIABLES                                                     */
@@ -173,4 +174,83 @@ uint8_t* buffer_writePage() {
 	}
 	
 	return page;
+}
+
+/**
+ * Function: buffer_block
+ * 
+ * Allows application code to use the whole buffer (both pages) as
+ * one contiguous 1024 byte block, e.g. for bulk file transfers
+ * while no recording or playback is in progress. The read/write
+ * pointers are reset to the top of Page 0.
+ *
+ * Returns: Pointer to the top of the buffer (1024 bytes)
+ */
+uint8_t* buffer_block() {
+	buffer_reset();
+	
+	return samples;
+}
+
+/**
+ * Function: buffer_level
+ * 
+ * Returns the number of samples queued in the buffer (written but
+ * not yet read), for byte-wise producers and consumers running at
+ * independent rates. Must be called with interrupts disabled, or
+ * from an interrupt service routine, as the pointers are shared.
+ *
+ * Returns: Number of samples queued (0 to 1023)
+ */
+uint16_t buffer_level() {
+	return (uint16_t)(pHead - pTail) & 1023;
+}
+
+/**
+ * Function: buffer_space
+ * 
+ * Returns the number of samples that can be queued before the write
+ * pointer would catch up with the read pointer. Safe to call while an
+ * interrupt service routine is dequeueing samples.
+ *
+ * Returns: Free space in samples (0 to 1023)
+ */
+uint16_t buffer_space() {
+	uint16_t level;
+	uint8_t sreg = SREG;
+	
+	cli();				// Pointers are shared with the consumer ISR
+	level = buffer_level();
+	SREG = sreg;
+	
+	return 1023 - level;
+}
+
+/**
+ * Function: buffer_put
+ * 
+ * Queues a block of samples from application code while an interrupt
+ * service routine dequeues them. The samples are copied first and the
+ * write pointer is then published in one atomic update, so the
+ * consumer never sees a partially advanced pointer. Callbacks are
+ * never generated from this function call. The caller must not queue
+ * more than buffer_space() samples.
+ *
+ * Parameters:
+ *    data - Samples to queue.
+ *    count - Number of samples.
+ */
+void buffer_put(const uint8_t* data, uint16_t count) {
+	uint8_t* head = (uint8_t*)pHead;
+	uint8_t sreg;
+	
+	while (count--) {
+		*(head++) = *(data++);
+		if (head == pEnd) head = pPage0;
+	}
+	
+	sreg = SREG;
+	cli();
+	pHead = head;
+	SREG = sreg;
 }
\ No newline at end of file
@@ -22,5 +22,9 @@ void buffer_queue(uint8_t word);	// Writes a sample to the buffer and advances t
 uint8_t buffer_dequeue();			// Reads a sample from the buffer and advances the read pointer
 uint8_t* buffer_readPage();			// Allows user code to read a full page from the buffer
 uint8_t* buffer_writePage();		// Allows user code to write a full page to the buffer
+uint8_t* buffer_block();			// Allows user code to use both pages as one 1024 byte block
+uint16_t buffer_level();			// Returns the number of samples queued in the buffer
+uint16_t buffer_space();			// Returns the free space in the buffer (safe with an ISR consumer)
+void buffer_put(const uint8_t* data, uint16_t count);	// Queues a block of samples for an ISR consumer
 
 #endif /* BUFFER_H_ */
\ No newline at end of file
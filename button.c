@@ -0,0 +1,151 @@
+/**
+ * button.c - EGB240DVR Library, Button module
+ *
+ * Debounces the push buttons in the background and queues press,
+ * release and long press events, so application code never waits
+ * for a button. The PORTF button pins have no pin change interrupt
+ * on the ATmega32U4, so they are scanned from the Timer0 interrupt
+ * every ~1 ms. A change is accepted once the input has been stable
+ * for BUTTON_DEBOUNCE_MS consecutive scans.
+ *
+ * Each queued event posts the control task (TASK_CONTROL). If the
+ * queue is full, new events are discarded.
+ *
+ * Requires:
+ *   sched - Scheduler, events post the control task
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "sched.h"
+#include "button.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define BUTTON_QUEUE_SIZE	8		// Queued events (power of 2)
+#define BUTTON_QUEUE_MASK	(BUTTON_QUEUE_SIZE - 1)
+#define BUTTON_COUNT		3		// Buttons scanned (PF4 to PF6)
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static uint8_t stable = 0;					// Debounced state (bit set = pressed)
+static uint8_t debounce[BUTTON_COUNT];		// Scans the input has differed from stable
+static uint16_t held[BUTTON_COUNT];			// Scans the button has been held
+static uint8_t queue[BUTTON_QUEUE_SIZE];	// Event queue
+static volatile uint8_t queueHead = 0;		// Write index (scan)
+static volatile uint8_t queueTail = 0;		// Read index (button_get)
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+/**
+ * Function: button_queue
+ *
+ * Queues an event and wakes the main loop. Called from button_scan.
+ */
+static void button_queue(uint8_t event) {
+	uint8_t next = (queueHead + 1) & BUTTON_QUEUE_MASK;
+	
+	if (next != queueTail) {
+		queue[queueHead] = event;
+		queueHead = next;
+	}
+	sched_post(TASK_CONTROL);
+}
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: button_init
+ * 
+ * Configures the button pins as inputs.
+ */
+void button_init() {
+	DDRF &= ~BUTTON_MASK;		// Buttons are inputs
+}
+
+/**
+ * Function: button_scan
+ * 
+ * Samples the buttons, debounces them and queues events. Must be
+ * called every ~1 ms with interrupts disabled (from the Timer0 ISR).
+ */
+void button_scan() {
+	uint8_t pressed = ~PINF & BUTTON_MASK;		// Active low
+	uint8_t i, bit;
+	
+	for (i = 0; i < BUTTON_COUNT; i++) {
+		bit = 1 << (BUTTON_PLAY + i);
+		
+		if ((pressed ^ stable) & bit) {
+			if (++debounce[i] >= BUTTON_DEBOUNCE_MS) {	// Stable long enough, accept change
+				debounce[i] = 0;
+				stable ^= bit;
+				held[i] = 0;
+				button_queue(((stable & bit) ? BUTTON_PRESS : BUTTON_RELEASE) | (BUTTON_PLAY + i));
+			}
+		} else {
+			debounce[i] = 0;
+			if ((stable & bit) && held[i] < BUTTON_LONG_MS && ++held[i] == BUTTON_LONG_MS) {
+				button_queue(BUTTON_LONG | (BUTTON_PLAY + i));
+			}
+		}
+	}
+}
+
+/**
+ * Function: button_resync
+ * 
+ * Accepts the current inputs as the debounced state without queueing
+ * events, e.g. after the scan has been stopped by power-down sleep.
+ * A button held at this point reports neither a press nor a long press.
+ */
+void button_resync() {
+	uint8_t sreg = SREG;
+	uint8_t i;
+	
+	cli();
+	stable = ~PINF & BUTTON_MASK;				// Active low
+	for (i = 0; i < BUTTON_COUNT; i++) {
+		debounce[i] = 0;
+		held[i] = BUTTON_LONG_MS;				// Long press already "reported"
+	}
+	SREG = sreg;
+}
+
+/**
+ * Function: button_get
+ * 
+ * Removes the oldest event from the queue. If more events are
+ * waiting, TASK_CONTROL is posted again so they are handled on
+ * the next run.
+ *
+ * Returns: The event (type | button), or 0 if the queue is empty.
+ */
+uint8_t button_get() {
+	uint8_t event = 0;
+	uint8_t sreg = SREG;
+	
+	cli();
+	if (queueTail != queueHead) {
+		event = queue[queueTail];
+		queueTail = (queueTail + 1) & BUTTON_QUEUE_MASK;
+		if (queueTail != queueHead) sched_post(TASK_CONTROL);
+	}
+	SREG = sreg;
+	
+	return event;
+}
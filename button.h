@@ -0,0 +1,37 @@
+/**
+ * button.h - EGB240DVR Library, Button module header
+ *
+ * Debounced button events for the TeensyBOBv2 push buttons.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef BUTTON_H_
+#define BUTTON_H_
+
+// Buttons (bit number on PORTF, active low)
+#define BUTTON_PLAY		4		// PF4
+#define BUTTON_RECORD	5		// PF5
+#define BUTTON_STOP		6		// PF6
+#define BUTTON_MASK		((1<<BUTTON_PLAY) | (1<<BUTTON_RECORD) | (1<<BUTTON_STOP))
+
+// Event types
+#define BUTTON_PRESS	0x10	// Button pressed (debounced)
+#define BUTTON_RELEASE	0x20	// Button released (debounced)
+#define BUTTON_LONG		0x30	// Button held for BUTTON_LONG_MS
+
+// An event is a type combined with a button, e.g. BUTTON_PRESS | BUTTON_STOP
+#define BUTTON_TYPE(event)	((event) & 0xF0)
+#define BUTTON_ID(event)	((event) & 0x0F)
+
+#define BUTTON_DEBOUNCE_MS	10		// Input must be stable this long
+#define BUTTON_LONG_MS		1000	// Hold time for a long press
+
+void button_init();			// Configures the button inputs
+void button_scan();			// Samples the buttons, call every ~1 ms (from Timer0 ISR)
+void button_resync();		// Takes the current inputs as debounced state, no events
+uint8_t button_get();		// Returns the oldest queued event, or 0 if none
+
+#endif /* BUTTON_H_ */
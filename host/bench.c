@@ -0,0 +1,188 @@
+/**
+ * bench.c - EGB240DVR host build, microbenchmarks
+ *
+ * Times the hardware independent parts of the record/playback path on
+ * the host, so algorithmic changes can be compared in seconds:
+ *   - circular buffer: byte-wise queue and dequeue, as done by the ADC
+ *     and PWM interrupts, including the page callbacks
+ *   - WAVE header handling: create/close and sync of a file
+ *   - f_write throughput through wave_write on a FAT formatted disk
+ *     image, for several write sizes
+ * Besides host time, each file system operation is reported as disk
+ * calls and sectors per operation, which carry over to the target
+ * (every sector costs roughly 1 ms of SPI transfer and card time).
+ *
+ * Usage: bench_dvr [image]   (default bench.img, created and formatted)
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "../buffer.h"
+#include "../wave.h"
+#include "hal.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define IMAGE_SECTORS	131072UL	// 64 MB disk image
+#define BUFFER_SAMPLES	(64UL << 20)	// Samples through the buffer
+#define HEADER_FILES	200			// Files created/closed
+#define WRITE_BYTES		(16UL << 20)	// Bytes written per write size
+#define PAGE			512			// Buffer page size
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static volatile uint32_t pagesFull;		// Page full callbacks
+static volatile uint32_t pagesEmpty;	// Page empty callbacks
+static uint8_t block[4096];				// Samples for the write benchmark
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+static double now() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void page_full() {
+	pagesFull++;
+}
+
+static void page_empty() {
+	pagesEmpty++;
+}
+
+/**
+ * Function: bench_buffer
+ *
+ * Circular buffer: byte-wise producer (record) and byte-wise consumer
+ * (playback), each run over the buffer many times.
+ */
+static void bench_buffer() {
+	uint32_t i;
+	double start, queue, dequeue;
+
+	buffer_init(page_full, page_empty);
+
+	start = now();
+	for (i = 0; i < BUFFER_SAMPLES; i++) {
+		buffer_queue(i);
+	}
+	queue = now() - start;
+
+	buffer_reset();
+	start = now();
+	for (i = 0; i < BUFFER_SAMPLES; i++) {
+		buffer_dequeue();
+	}
+	dequeue = now() - start;
+
+	printf("buffer_queue           %8.2f ns/sample  (%u page full callbacks)\n", queue * 1e9 / BUFFER_SAMPLES, pagesFull);
+	printf("buffer_dequeue         %8.2f ns/sample  (%u page empty callbacks)\n", dequeue * 1e9 / BUFFER_SAMPLES, pagesEmpty);
+}
+
+/**
+ * Function: bench_header
+ *
+ * WAVE header handling: creating a file (directory entry and header
+ * write) and closing it (header finalisation), then syncing an open
+ * file as done when a recording is paused.
+ */
+static void bench_header() {
+	uint32_t i;
+	double start, elapsed;
+
+	wave_init();
+
+	hal_disk_clear();
+	start = now();
+	for (i = 0; i < HEADER_FILES; i++) {
+		wave_create();
+		wave_write(block, PAGE);
+		wave_close();
+	}
+	elapsed = now() - start;
+	printf("wave_create+close      %8.2f us/file    %5.2f reads %5.2f writes %5.2f sectors\n",
+		elapsed * 1e6 / HEADER_FILES, (double)halDisk.reads / HEADER_FILES,
+		(double)halDisk.writes / HEADER_FILES, (double)halDisk.sectorsWritten / HEADER_FILES);
+
+	wave_create();
+	hal_disk_clear();
+	start = now();
+	for (i = 0; i < HEADER_FILES; i++) {
+		wave_write(block, PAGE);
+		wave_sync();
+	}
+	elapsed = now() - start;
+	wave_close();
+	printf("wave_write+sync        %8.2f us/page    %5.2f reads %5.2f writes %5.2f sectors\n",
+		elapsed * 1e6 / HEADER_FILES, (double)halDisk.reads / HEADER_FILES,
+		(double)halDisk.writes / HEADER_FILES, (double)halDisk.sectorsWritten / HEADER_FILES);
+}
+
+/**
+ * Function: bench_write
+ *
+ * Sequential wave_write throughput for one write size.
+ */
+static void bench_write(uint16_t size) {
+	uint32_t i, calls = WRITE_BYTES / size;
+	double start, elapsed;
+
+	wave_create();
+	hal_disk_clear();
+	start = now();
+	for (i = 0; i < calls; i++) {
+		if (wave_write(block, size)) break;
+	}
+	wave_close();
+	elapsed = now() - start;
+
+	printf("wave_write %4u bytes   %8.2f MB/s      %5.2f reads %5.2f writes %5.2f sectors per KB\n",
+		size, WRITE_BYTES / elapsed / 1e6, halDisk.reads * 1024.0 / WRITE_BYTES,
+		halDisk.writes * 1024.0 / WRITE_BYTES, halDisk.sectorsWritten * 1024.0 / WRITE_BYTES);
+}
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+int main(int argc, char* argv[]) {
+	const char* path = argc > 1 ? argv[1] : "bench.img";
+	uint16_t i;
+
+	for (i = 0; i < sizeof(block); i++) block[i] = i * 7;
+
+	if (hal_disk_attach(path, IMAGE_SECTORS) || hal_disk_format()) {
+		fprintf(stderr, "bench: cannot create disk image %s\n", path);
+		return 1;
+	}
+	hal_log_verbose(1);
+
+	bench_buffer();
+	bench_header();
+	bench_write(64);
+	bench_write(PAGE);
+	bench_write(2 * PAGE);
+	bench_write(4096);
+
+	hal_disk_detach();
+	if (hal_log_count()) {
+		fprintf(stderr, "bench: %u errors logged\n", hal_log_count());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,44 @@
+/**
+ * check.h - EGB240DVR host build, test assertions
+ *
+ * Minimal assertions for the host unit tests: a failed CHECK prints
+ * the expression and its location and is counted, and the test exits
+ * with CHECK_STATUS (1 if any check failed).
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <stdio.h>
+
+static unsigned checkCount;		// Checks made
+static unsigned checkFailed;	// Checks failed
+
+#define CHECK(expr) do { \
+		checkCount++; \
+		if (!(expr)) { \
+			checkFailed++; \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+		} \
+	} while (0)
+
+// Compares two integers, printing both values on failure
+#define CHECK_EQUAL(actual, expected) do { \
+		long long checkActual = (actual), checkExpected = (expected); \
+		checkCount++; \
+		if (checkActual != checkExpected) { \
+			checkFailed++; \
+			printf("%s:%d: check failed: %s is %lld, expected %lld\n", __FILE__, __LINE__, \
+				#actual, checkActual, checkExpected); \
+		} \
+	} while (0)
+
+// Prints the totals; evaluates to the exit status
+#define CHECK_STATUS() \
+	(printf("%u checks, %u failed\n", checkCount, checkFailed), checkFailed ? 1 : 0)
+
+#endif /* CHECK_H_ */
@@ -0,0 +1,532 @@
+/**
+ * golden.c - EGB240DVR host build, golden-signal audio regression suite
+ *
+ * Pushes known signals through the record and playback paths of the
+ * firmware modules and compares the measured quality with the stored
+ * baselines in golden.txt:
+ *
+ *   capture  - ADC model -> buffer_queue -> page full -> wave_write,
+ *              measured on the samples read back from the WAVE file
+ *   playback - wave_read -> buffer pages -> buffer_dequeue ->
+ *              playback_step, measured on the PWM duty cycle stream
+ *              (62.5 kHz, unfiltered) of the recorded file
+ *
+ * Signals:
+ *   sweep    - stepped sine, 100 Hz to 7 kHz: gain, SNR and THD per tone
+ *   multi    - five simultaneous tones: SNR and flatness
+ *   speech   - synthetic voiced speech (pulse train through formant
+ *              resonators): SNR against the source, and the playback
+ *              latency in PWM periods
+ *
+ * Tones are measured by a least squares fit of the fundamental, its
+ * harmonics (below Nyquist) and DC: SNR compares the fundamental with
+ * the residual, THD the harmonics with the fundamental, gain the
+ * fundamental with the ideal ADC code amplitude.
+ *
+ * Usage: golden [-u] [baseline]   (default golden.txt)
+ *   -u   Write the measured values as the new baseline
+ *
+ * The exit status is 1 if any value is outside the tolerance of its
+ * baseline or missing from it.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../buffer.h"
+#include "../playback.h"
+#include "../wave.h"
+#include "hal.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define FS				15625.0		// Sample rate (Hz)
+#define PWM_FS			(FS * PLAYBACK_PWM_PER_SAMPLE)	// PWM rate (Hz)
+#define PAGE			512			// Buffer page size
+#define IMAGE_SECTORS	16384UL		// 8 MB disk image
+
+// ADC model: input centred on VCC/2 with a 2 V peak for full scale,
+// 10 bit conversion, ADCH holds the top 8 bits (left adjusted)
+#define VCC_MV			5000.0
+#define SWING_MV		2000.0
+#define CODES_PER_UNIT	(SWING_MV * 1024 / VCC_MV / 4)	// ADCH codes per unit input
+
+#define TONE_SAMPLES	4096		// Samples per sweep step
+#define TONE_MARGIN		256			// Samples skipped at each end of a step
+#define TONE_AMPLITUDE	0.8
+#define HARMONICS		5			// Highest harmonic measured for THD
+#define MULTI_SAMPLES	16384
+#define SPEECH_SAMPLES	16384
+#define MAX_BASIS		(1 + 2 * HARMONICS)	// DC and sin/cos per frequency
+#define LATENCY_MAX		64			// Playback latency searched (PWM periods)
+
+#define RESULTS_MAX		128
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static const double sweep[] = { 100, 250, 500, 1000, 2000, 3000, 4000, 5000, 6000, 7000 };
+static const double multi[] = { 300, 800, 1700, 2900, 4300 };
+#define SWEEP_TONES	(sizeof(sweep) / sizeof(sweep[0]))
+#define MULTI_TONES	(sizeof(multi) / sizeof(multi[0]))
+
+typedef struct {
+	char key[48];		// path.signal.metric
+	double value;
+	double tolerance;	// Allowed deviation from the baseline
+} RESULT;
+
+static RESULT results[RESULTS_MAX];
+static uint16_t resultCount;
+
+static uint32_t playbackAmount;	// PWM periods left to play (data_amount in main.c)
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+static void result(const char* path, const char* signal, const char* metric, double value, double tolerance) {
+	RESULT* r = &results[resultCount++];
+
+	snprintf(r->key, sizeof(r->key), "%s.%s.%s", path, signal, metric);
+	r->value = value;
+	r->tolerance = tolerance;
+}
+
+static double db(double ratio) {
+	return ratio > 1e-12 ? 10 * log10(ratio) : -120.0;
+}
+
+/**
+ * Function: solve
+ *
+ * Solves the n x n linear system a x = b in place (Gaussian elimination
+ * with partial pivoting). The solution is left in b.
+ */
+static void solve(double a[MAX_BASIS * MAX_BASIS], double* b, int n) {
+	int i, j, k, p;
+
+	for (i = 0; i < n; i++) {
+		for (p = i, j = i + 1; j < n; j++) {
+			if (fabs(a[j * n + i]) > fabs(a[p * n + i])) p = j;
+		}
+		for (k = 0; k < n; k++) {
+			double t = a[i * n + k]; a[i * n + k] = a[p * n + k]; a[p * n + k] = t;
+		}
+		double t = b[i]; b[i] = b[p]; b[p] = t;
+		for (j = i + 1; j < n; j++) {
+			double f = a[j * n + i] / a[i * n + i];
+			for (k = i; k < n; k++) a[j * n + k] -= f * a[i * n + k];
+			b[j] -= f * b[i];
+		}
+	}
+	for (i = n - 1; i >= 0; i--) {
+		for (k = i + 1; k < n; k++) b[i] -= a[i * n + k] * b[k];
+		b[i] /= a[i * n + i];
+	}
+}
+
+/**
+ * Function: fit
+ *
+ * Least squares fit of DC plus a sine of each given frequency.
+ *
+ * Parameters:
+ *    y - Signal, n samples at rate fs.
+ *    freqs - Frequencies to fit (Hz), count of them.
+ *    power - Receives the power (A^2/2) of each frequency.
+ *
+ * Returns: The power of the residual.
+ */
+static double fit(const double* y, uint32_t n, double fs, const double* freqs, int count, double* power) {
+	double a[MAX_BASIS * MAX_BASIS] = { 0 }, b[MAX_BASIS] = { 0 }, basis[MAX_BASIS];
+	double residual = 0;
+	int size = 1 + 2 * count, i, j, k;
+	uint32_t m;
+
+	for (m = 0; m < n; m++) {
+		basis[0] = 1;
+		for (k = 0; k < count; k++) {
+			basis[1 + 2 * k] = cos(2 * M_PI * freqs[k] * m / fs);
+			basis[2 + 2 * k] = sin(2 * M_PI * freqs[k] * m / fs);
+		}
+		for (i = 0; i < size; i++) {
+			b[i] += basis[i] * y[m];
+			for (j = 0; j < size; j++) a[i * size + j] += basis[i] * basis[j];
+		}
+	}
+	solve(a, b, size);
+
+	for (k = 0; k < count; k++) {
+		power[k] = (b[1 + 2 * k] * b[1 + 2 * k] + b[2 + 2 * k] * b[2 + 2 * k]) / 2;
+	}
+	for (m = 0; m < n; m++) {
+		double model = b[0];
+		for (k = 0; k < count; k++) {
+			model += b[1 + 2 * k] * cos(2 * M_PI * freqs[k] * m / fs) + b[2 + 2 * k] * sin(2 * M_PI * freqs[k] * m / fs);
+		}
+		residual += (y[m] - model) * (y[m] - model);
+	}
+	return residual / n;
+}
+
+/**
+ * Function: measure_tone
+ *
+ * Gain, SNR and THD of one tone of amplitude TONE_AMPLITUDE.
+ */
+static void measure_tone(const char* path, double f, const double* y, uint32_t n, double fs) {
+	double freqs[HARMONICS] = { 0 }, power[HARMONICS], harmonics = 0, noise, ideal;
+	char name[16];
+	int count = 0, k;
+
+	for (k = 1; k <= HARMONICS && k * f < fs / 2 - 50; k++) freqs[count++] = k * f;
+	noise = fit(y, n, fs, freqs, count, power);
+	for (k = 1; k < count; k++) harmonics += power[k];
+	ideal = TONE_AMPLITUDE * CODES_PER_UNIT;
+
+	snprintf(name, sizeof(name), "sweep%.0f", f);
+	result(path, name, "gain_db", db(power[0] / (ideal * ideal / 2)), 0.1);
+	result(path, name, "snr_db", db(power[0] / noise), 0.5);
+	result(path, name, "thd_db", db(harmonics / power[0]), 1.0);
+}
+
+/**
+ * Function: speech
+ *
+ * Synthetic voiced speech at the PWM rate: a glottal pulse train with
+ * a gliding pitch through three formant resonators and a syllable
+ * envelope, scaled to a peak of TONE_AMPLITUDE.
+ */
+static void speech(double* x, uint32_t n) {
+	static const double formant[3] = { 730, 1090, 2440 }, bandwidth[3] = { 90, 110, 170 };
+	double y1[3] = { 0 }, y2[3] = { 0 }, phase = 0, peak = 0;
+	uint32_t m;
+	int k;
+
+	for (m = 0; m < n; m++) {
+		double t = m / PWM_FS;
+		double pitch = 110 + 30 * sin(2 * M_PI * 1.5 * t);
+		double v;
+
+		phase += pitch / PWM_FS;
+		v = phase >= 1 ? 1 : 0;			// One pulse per pitch period
+		if (phase >= 1) phase -= 1;
+		for (k = 0; k < 3; k++) {		// Cascaded two-pole resonators
+			double r = exp(-M_PI * bandwidth[k] / PWM_FS);
+			double y = v + 2 * r * cos(2 * M_PI * formant[k] / PWM_FS) * y1[k] - r * r * y2[k];
+			y2[k] = y1[k];
+			y1[k] = y;
+			v = y * (1 - r);
+		}
+		x[m] = v * (0.6 + 0.4 * sin(2 * M_PI * 4 * t));
+	}
+	for (m = 0; m < n; m++) {
+		if (fabs(x[m]) > peak) peak = fabs(x[m]);
+	}
+	for (m = 0; m < n; m++) x[m] *= TONE_AMPLITUDE / peak;
+}
+
+/**
+ * Function: snr_against
+ *
+ * SNR of y against the reference x after the best gain and offset.
+ */
+static double snr_against(const double* x, const double* y, uint32_t n) {
+	double sx = 0, sy = 0, sxx = 0, sxy = 0, gain, offset, signal = 0, noise = 0;
+	uint32_t m;
+
+	for (m = 0; m < n; m++) {
+		sx += x[m]; sy += y[m]; sxx += x[m] * x[m]; sxy += x[m] * y[m];
+	}
+	gain = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+	offset = (sy - gain * sx) / n;
+	for (m = 0; m < n; m++) {
+		double e = y[m] - (gain * x[m] + offset);
+		signal += (gain * (x[m] - sx / n)) * (gain * (x[m] - sx / n));
+		noise += e * e;
+	}
+	return db(signal / noise);
+}
+
+/************************************************************************/
+/* RECORD AND PLAYBACK PATHS                                            */
+/************************************************************************/
+
+// Buffer callbacks, standing in for the SD tasks of main.c
+static void capture_page_full() {
+	wave_write(buffer_readPage(), PAGE);
+}
+
+static void playback_page_empty() {
+	if (playbackAmount > (6 * PAGE)) wave_read(buffer_writePage(), PAGE);
+}
+
+/**
+ * Function: capture
+ *
+ * Records a signal into a WAVE file as the ADC interrupt does, then
+ * reads the file back.
+ *
+ * Parameters:
+ *    name - File name.
+ *    x - Input (-1 to 1) at the sample rate, n samples (whole pages).
+ *    y - Receives the recorded samples.
+ *
+ * Returns: The number of samples in the recorded file.
+ */
+static uint32_t capture(const char* name, const double* x, double* y, uint32_t n) {
+	uint8_t page[PAGE];
+	uint32_t m, samples, i;
+
+	wave_select(name);
+	wave_create();
+	buffer_reset();
+	for (m = 0; m < n; m++) {
+		double mv = VCC_MV / 2 + SWING_MV * x[m];
+		int32_t code = (int32_t)(mv * 1024 / VCC_MV);
+		if (code < 0) code = 0;
+		if (code > 1023) code = 1023;
+		buffer_queue(code >> 2);		// ADCH, left adjusted
+	}
+	wave_close();
+
+	samples = wave_open();
+	for (m = 0; m < samples && m < n; m += PAGE) {
+		if (wave_read(page, PAGE)) break;
+		for (i = 0; i < PAGE; i++) y[m + i] = page[i];
+	}
+	wave_close();
+	return samples;
+}
+
+/**
+ * Function: playback
+ *
+ * Plays a WAVE file as dvr_play and the PWM interrupt do, recording the
+ * duty cycle of every PWM period.
+ *
+ * Returns: The number of PWM periods played.
+ */
+static uint32_t playback(const char* name, double* duty, uint32_t max) {
+	uint8_t current = 0x80, next;	// 50 % until the first sample (set_pwm)
+	uint32_t m = 0;
+
+	wave_select(name);
+	buffer_reset();
+	playbackAmount = wave_open() * PLAYBACK_PWM_PER_SAMPLE + 1;
+	wave_read(buffer_writePage(), PAGE);
+	wave_read(buffer_writePage(), PAGE);
+	playback_reset();
+	while (--playbackAmount > 0 && m < max) {
+		if (playback_step(&next)) current = next;
+		duty[m++] = current;
+	}
+	wave_close();
+	return m;
+}
+
+/**
+ * Function: run_sweep
+ */
+static void run_sweep(double* x, double* y, double* duty) {
+	uint32_t n = SWEEP_TONES * TONE_SAMPLES, m, pwm;
+	uint8_t i;
+
+	for (i = 0; i < SWEEP_TONES; i++) {
+		for (m = 0; m < TONE_SAMPLES; m++) {
+			x[i * TONE_SAMPLES + m] = TONE_AMPLITUDE * sin(2 * M_PI * sweep[i] * m / FS);
+		}
+	}
+	result("capture", "sweep", "samples", capture("SWEEP.WAV", x, y, n), 0);
+	pwm = playback("SWEEP.WAV", duty, n * PLAYBACK_PWM_PER_SAMPLE);
+	result("playback", "sweep", "periods", pwm, 0);
+
+	for (i = 0; i < SWEEP_TONES; i++) {
+		uint32_t start = i * TONE_SAMPLES + TONE_MARGIN, length = TONE_SAMPLES - 2 * TONE_MARGIN;
+		measure_tone("capture", sweep[i], y + start, length, FS);
+		measure_tone("playback", sweep[i], duty + start * PLAYBACK_PWM_PER_SAMPLE, length * PLAYBACK_PWM_PER_SAMPLE, PWM_FS);
+	}
+}
+
+/**
+ * Function: measure_multi
+ */
+static void measure_multi(const char* path, const double* y, uint32_t n, double fs) {
+	double power[MULTI_TONES], total = 0, noise, low = 1e9, high = 0;
+	uint8_t i;
+
+	noise = fit(y, n, fs, multi, MULTI_TONES, power);
+	for (i = 0; i < MULTI_TONES; i++) {
+		total += power[i];
+		if (power[i] < low) low = power[i];
+		if (power[i] > high) high = power[i];
+	}
+	result(path, "multi", "snr_db", db(total / noise), 0.5);
+	result(path, "multi", "flatness_db", db(high / low), 0.2);
+}
+
+static void run_multi(double* x, double* y, double* duty) {
+	uint32_t m, n = MULTI_SAMPLES;
+	uint8_t i;
+
+	for (m = 0; m < n; m++) {
+		x[m] = 0;
+		for (i = 0; i < MULTI_TONES; i++) x[m] += TONE_AMPLITUDE / MULTI_TONES * sin(2 * M_PI * multi[i] * m / FS + i);
+	}
+	capture("MULTI.WAV", x, y, n);
+	playback("MULTI.WAV", duty, n * PLAYBACK_PWM_PER_SAMPLE);
+	measure_multi("capture", y + TONE_MARGIN, n - 2 * TONE_MARGIN, FS);
+	measure_multi("playback", duty + TONE_MARGIN * PLAYBACK_PWM_PER_SAMPLE,
+		(n - 2 * TONE_MARGIN) * PLAYBACK_PWM_PER_SAMPLE, PWM_FS);
+}
+
+/**
+ * Function: run_speech
+ *
+ * The ADC samples every fourth point of the PWM rate source, so the
+ * playback output can be compared with the source directly.
+ */
+static void run_speech(double* x, double* y, double* duty) {
+	uint32_t n = SPEECH_SAMPLES, pwmN = n * PLAYBACK_PWM_PER_SAMPLE, m;
+	uint32_t start = TONE_MARGIN * PLAYBACK_PWM_PER_SAMPLE, length = pwmN - 2 * start;
+	double* source = malloc(pwmN * sizeof(double));
+	double best = -1e300, snr;
+	int lag, latency = 0;
+
+	speech(source, pwmN);
+	for (m = 0; m < n; m++) x[m] = source[m * PLAYBACK_PWM_PER_SAMPLE];
+	capture("SPEECH.WAV", x, y, n);
+	playback("SPEECH.WAV", duty, pwmN);
+
+	result("capture", "speech", "snr_db", snr_against(x + TONE_MARGIN, y + TONE_MARGIN, n - 2 * TONE_MARGIN), 0.5);
+
+	// Latency: lag of the duty stream behind the source with the best fit
+	for (lag = 0; lag <= LATENCY_MAX; lag++) {
+		snr = snr_against(source + start, duty + start + lag, length);
+		if (snr > best) {
+			best = snr;
+			latency = lag;
+		}
+	}
+	result("playback", "speech", "snr_db", best, 0.5);
+	result("playback", "speech", "latency_pwm", latency, 0);
+	free(source);
+}
+
+/**
+ * Function: compare
+ *
+ * Compares the results with a baseline file, or writes it.
+ *
+ * Returns: The number of failures.
+ */
+static int compare(const char* path, int update) {
+	char key[48];
+	double value, baseline[RESULTS_MAX];
+	uint8_t found[RESULTS_MAX] = { 0 };
+	int failures = 0;
+	uint16_t i;
+	FILE* f;
+
+	if (update) {
+		f = fopen(path, "w");
+		if (!f) return -1;
+		fprintf(f, "# Golden-signal baselines, written by `golden -u` (see golden.c)\n");
+		for (i = 0; i < resultCount; i++) fprintf(f, "%-36s %10.3f\n", results[i].key, results[i].value);
+		fclose(f);
+		printf("Baseline written to %s (%u values)\n", path, resultCount);
+		return 0;
+	}
+
+	f = fopen(path, "r");
+	if (f) {
+		char line[128];
+		while (fgets(line, sizeof(line), f)) {
+			if (line[0] == '#' || sscanf(line, "%47s %lf", key, &value) != 2) continue;
+			for (i = 0; i < resultCount; i++) {
+				if (!strcmp(results[i].key, key)) {
+					baseline[i] = value;
+					found[i] = 1;
+				}
+			}
+		}
+		fclose(f);
+	}
+
+	printf("%-36s %10s %10s\n", "measurement", "value", "baseline");
+	for (i = 0; i < resultCount; i++) {
+		const char* status = "ok";
+		if (!found[i]) {
+			status = "MISSING";
+			failures++;
+		} else if (fabs(results[i].value - baseline[i]) > results[i].tolerance + 1e-9) {
+			status = "FAIL";
+			failures++;
+		}
+		if (found[i]) {
+			printf("%-36s %10.3f %10.3f  %s\n", results[i].key, results[i].value, baseline[i], status);
+		} else {
+			printf("%-36s %10.3f %10s  %s\n", results[i].key, results[i].value, "-", status);
+		}
+	}
+	printf("%d of %u measurements outside tolerance\n", failures, resultCount);
+	return failures;
+}
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+int main(int argc, char* argv[]) {
+	uint32_t n = SWEEP_TONES * TONE_SAMPLES;
+	double *x, *y, *duty;
+	int update = 0, failures;
+	const char* path = "golden.txt";
+
+	if (argc > 1 && !strcmp(argv[1], "-u")) {
+		update = 1;
+		argc--;
+		argv++;
+	}
+	if (argc > 1) path = argv[1];
+
+	if (hal_disk_attach("golden.img", IMAGE_SECTORS) || hal_disk_format()) {
+		fprintf(stderr, "golden: cannot create disk image\n");
+		return 1;
+	}
+	hal_log_verbose(1);
+	buffer_init(capture_page_full, playback_page_empty);
+	wave_init();
+
+	x = malloc(n * sizeof(double));
+	y = calloc(n, sizeof(double));
+	duty = malloc(n * PLAYBACK_PWM_PER_SAMPLE * sizeof(double));
+
+	run_sweep(x, y, duty);
+	run_multi(x, y, duty);
+	run_speech(x, y, duty);
+
+	free(x);
+	free(y);
+	free(duty);
+	hal_disk_detach();
+
+	if (hal_log_count()) {
+		fprintf(stderr, "golden: %u errors logged\n", hal_log_count());
+		return 1;
+	}
+	failures = compare(path, update);
+	return failures ? 1 : 0;
+}
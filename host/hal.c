@@ -0,0 +1,206 @@
+/**
+ * hal.c - EGB240DVR host build, hardware abstraction
+ *
+ * Host implementations of the hardware dependencies of buffer.c,
+ * wave.c and the FatFs core:
+ *   - the FatFs disk interface (diskio.h) on a disk image file, with
+ *     counters of the sector traffic each operation generates
+ *   - log_write (log.h), recording the last message in memory
+ *   - the status register used by buffer.c for atomic sections, and
+ *     the PWM output register written by loopback.c
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <avr/io.h>
+
+#include "../lib/fatfs/ff.h"
+#include "../lib/fatfs/diskio.h"
+
+#include "../log.h"
+#include "hal.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define SECTOR_SIZE		512
+#define ERASE_BLOCK		128		// Erase block size in sectors (64 KB, as reported by SD cards)
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+volatile uint8_t SREG;
+volatile uint8_t OCR4B;
+
+HAL_DISK_STATS halDisk;
+
+int image = -1;					// Disk image file descriptor
+uint32_t imageSectors;			// Disk image size in sectors
+DSTATUS imageStatus = STA_NOINIT;
+
+uint16_t logCount;
+uint8_t logLast;
+uint8_t logVerbose;
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: hal_disk_attach
+ *
+ * Opens (creating if needed) a disk image of the given size, which
+ * then stands in for the SD card. The counters are cleared.
+ *
+ * Parameters:
+ *    path - Image file name.
+ *    sectors - Image size in 512 byte sectors.
+ *
+ * Returns: 0 on success, -1 on error.
+ */
+int hal_disk_attach(const char* path, uint32_t sectors) {
+	hal_disk_detach();
+	image = open(path, O_RDWR | O_CREAT, 0644);
+	if (image < 0 || ftruncate(image, (off_t)sectors * SECTOR_SIZE)) return -1;
+	imageSectors = sectors;
+	imageStatus = STA_NOINIT;
+	hal_disk_clear();
+	return 0;
+}
+
+/**
+ * Function: hal_disk_format
+ *
+ * Creates a FAT file system over the whole image (no partition table,
+ * as a freshly formatted SD card mounted by FatFs).
+ *
+ * Returns: 0 on success, or a FatFs error code.
+ */
+int hal_disk_format() {
+	FATFS fs;
+	FRESULT result;
+
+	result = f_mount(&fs, "/", 0);
+	if (!result) result = f_mkfs("/", 1, 0);
+	f_mount(NULL, "/", 0);
+	return result;
+}
+
+/**
+ * Function: hal_disk_clear
+ *
+ * Clears the disk access counters.
+ */
+void hal_disk_clear() {
+	memset(&halDisk, 0, sizeof(halDisk));
+}
+
+/**
+ * Function: hal_disk_detach
+ *
+ * Closes the disk image.
+ */
+void hal_disk_detach() {
+	if (image >= 0) close(image);
+	image = -1;
+	imageStatus = STA_NOINIT;
+}
+
+uint16_t hal_log_count() {
+	return logCount;
+}
+
+uint8_t hal_log_last() {
+	return logLast;
+}
+
+void hal_log_verbose(uint8_t on) {
+	logVerbose = on;
+}
+
+/************************************************************************/
+/* FATFS DISK INTERFACE (diskio.h)                                      */
+/************************************************************************/
+
+DSTATUS disk_initialize(BYTE pdrv) {
+	if (pdrv || image < 0) return STA_NOINIT | STA_NODISK;
+	imageStatus = 0;
+	return imageStatus;
+}
+
+DSTATUS disk_status(BYTE pdrv) {
+	if (pdrv || image < 0) return STA_NOINIT | STA_NODISK;
+	return imageStatus;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count) {
+	if (pdrv || !count) return RES_PARERR;
+	if (imageStatus & STA_NOINIT) return RES_NOTRDY;
+	if (sector + count > imageSectors) return RES_PARERR;
+	if (pread(image, buff, count * SECTOR_SIZE, (off_t)sector * SECTOR_SIZE) != (ssize_t)(count * SECTOR_SIZE)) return RES_ERROR;
+	halDisk.reads++;
+	halDisk.sectorsRead += count;
+	return RES_OK;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count) {
+	if (pdrv || !count) return RES_PARERR;
+	if (imageStatus & STA_NOINIT) return RES_NOTRDY;
+	if (sector + count > imageSectors) return RES_PARERR;
+	if (pwrite(image, buff, count * SECTOR_SIZE, (off_t)sector * SECTOR_SIZE) != (ssize_t)(count * SECTOR_SIZE)) return RES_ERROR;
+	halDisk.writes++;
+	halDisk.sectorsWritten += count;
+	return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* buff) {
+	if (pdrv) return RES_PARERR;
+	if (imageStatus & STA_NOINIT) return RES_NOTRDY;
+
+	switch (cmd) {
+		case CTRL_SYNC:
+			halDisk.syncs++;
+			return RES_OK;
+		case GET_SECTOR_COUNT:
+			*(DWORD*)buff = imageSectors;
+			return RES_OK;
+		case GET_SECTOR_SIZE:
+			*(WORD*)buff = SECTOR_SIZE;
+			return RES_OK;
+		case GET_BLOCK_SIZE:
+			*(DWORD*)buff = ERASE_BLOCK;
+			return RES_OK;
+		default:
+			return RES_PARERR;
+	}
+}
+
+void disk_timerproc() {
+}
+
+/************************************************************************/
+/* DEFERRED LOG (log.h)                                                 */
+/************************************************************************/
+
+void log_write(uint8_t id, int16_t a, int16_t b) {
+	logCount++;
+	logLast = id;
+	if (logVerbose) fprintf(stderr, "log: message %u (%d, %d)\n", id, a, b);
+}
+
+void log_flush() {
+}
+
+uint16_t log_dropped() {
+	return 0;
+}
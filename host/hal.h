@@ -0,0 +1,39 @@
+/**
+ * hal.h - EGB240DVR host build, hardware abstraction header
+ *
+ * Replaces the hardware the audio modules depend on when they are
+ * built for the host: the SD card (lib/fatfs/mmc_avr.c) becomes a
+ * disk image file, and the deferred log (log.c) records messages in
+ * memory.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef HAL_H_
+#define HAL_H_
+
+#include <stdint.h>
+
+// Disk image access counters (reset by hal_disk_attach and hal_disk_clear)
+typedef struct {
+	uint32_t reads;				// disk_read calls
+	uint32_t writes;			// disk_write calls
+	uint32_t sectorsRead;
+	uint32_t sectorsWritten;
+	uint32_t syncs;				// CTRL_SYNC requests
+} HAL_DISK_STATS;
+
+extern HAL_DISK_STATS halDisk;
+
+int hal_disk_attach(const char* path, uint32_t sectors);	// Creates/opens a disk image, returns 0 on success
+int hal_disk_format();										// Formats the image (FAT, no partition table)
+void hal_disk_clear();										// Clears the access counters
+void hal_disk_detach();										// Closes the disk image
+
+uint16_t hal_log_count();			// Messages logged since start-up
+uint8_t hal_log_last();				// ID of the last message logged
+void hal_log_verbose(uint8_t on);	// Print messages to stderr as they are logged
+
+#endif /* HAL_H_ */
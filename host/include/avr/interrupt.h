@@ -0,0 +1,22 @@
+/**
+ * avr/interrupt.h - EGB240DVR host build, interrupt control shim
+ *
+ * The host build is single threaded; interrupt service routines are
+ * called directly by the harness, so interrupts never need masking.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H_
+#define HOST_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define cli()
+#define sei()
+
+#define ISR(vector)	void vector(void)
+
+#endif /* HOST_AVR_INTERRUPT_H_ */
@@ -0,0 +1,53 @@
+/**
+ * avr/io.h - EGB240DVR host build, AVR register shim
+ *
+ * Stands in for avr-libc's <avr/io.h> when the hardware independent
+ * modules (buffer, wave, FatFs), the diagnostic modules and the USB
+ * mass storage module are built for the host. Only the registers those
+ * modules touch are provided, as plain variables; the USB registers
+ * whose value depends on the host (endpoint status, byte count and
+ * FIFO, frame number) are read and written through usb_register,
+ * which the simulated host in test_msc.c provides.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef HOST_AVR_IO_H_
+#define HOST_AVR_IO_H_
+
+#include <stdint.h>
+
+extern volatile uint8_t SREG;	// Status register (interrupt flag is not modelled)
+extern volatile uint8_t OCR4B;	// PWM output compare (loopback.c output sample)
+
+// USB controller (usb_msc.c)
+extern volatile uint8_t UHWCON, USBCON, PLLCSR, UDCON, UDINT, UDIEN, UDADDR;
+extern volatile uint8_t UENUM, UERST, UECONX, UECFG0X, UECFG1X, UEIENX;
+
+volatile uint8_t* usb_register(uint8_t address);	// Register at an I/O address
+
+#define UDFNUML		(*usb_register(0xE4))
+#define UEINTX		(*usb_register(0xE8))
+#define UEDATX		(*usb_register(0xF1))
+#define UEBCLX		(*usb_register(0xF2))
+
+#define PLOCK		0		// PLLCSR
+#define FRZCLK		5		// USBCON
+#define OTGPADE		4
+#define USBE		7
+#define EORSTI		3		// UDINT
+#define EORSTE		3		// UDIEN
+#define ADDEN		7		// UDADDR
+#define EPEN		0		// UECONX
+#define RSTDT		3
+#define STALLRQC	4
+#define STALLRQ		5
+#define TXINI		0		// UEINTX
+#define RXOUTI		2
+#define RXSTPI		3
+#define RWAL		5
+#define RXSTPE		3		// UEIENX
+
+#endif /* HOST_AVR_IO_H_ */
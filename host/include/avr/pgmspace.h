@@ -0,0 +1,24 @@
+/**
+ * avr/pgmspace.h - EGB240DVR host build, program memory shim
+ *
+ * The host has one address space, so tables placed in flash on the
+ * target are ordinary constants and are read directly.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H_
+#define HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+
+#define pgm_read_byte(address)	(*(const uint8_t*)(address))
+#define pgm_read_word(address)	(*(const uint16_t*)(address))
+#define memcpy_P				memcpy
+
+#endif /* HOST_AVR_PGMSPACE_H_ */
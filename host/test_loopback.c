@@ -0,0 +1,166 @@
+/**
+ * test_loopback.c - EGB240DVR host build, loopback self-test test
+ *
+ * Runs the loopback self-test (loopback.c) against a model of the
+ * analogue chain whose response is known exactly: the PWM output
+ * through two first order low pass sections (3 kHz each), a gain of
+ * 0.8, and the ADC sampling the filter output one sample after the
+ * output was set. The latency, the impulse peak and the gain and
+ * phase of every tone reported are checked against the response of
+ * the model
+ *
+ *   H(z) = 0.8 (1 - a)^2 z^-1 / (1 - a z^-1)^2,  a = exp(-2 pi 3000 / fs)
+ *
+ * at two sample rates. The console ring is only free on every other
+ * poll, so results also have to wait for room.
+ *
+ * Usage: test_loopback
+ *
+ * The exit status is 1 if any check failed.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../loopback.h"
+#include "../sched.h"
+#include "check.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define CHAIN_CORNER	3000.0		// Corner of each low pass section (Hz)
+#define CHAIN_GAIN		0.8			// Gain of the chain at DC
+#define SAMPLES_MAX		100000L		// Test must finish within this many samples
+
+#define GAIN_TOLERANCE	0.01		// Absolute
+#define PHASE_TOLERANCE	1.0			// Degrees
+#define LATENCY_TOLERANCE	3		// 1/100ths of a sample
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static uint8_t consoleFree;			// Console ring has room on this poll
+static uint16_t controlPosts;		// TASK_CONTROL posts
+
+static uint16_t impulses;			// TLM_LOOPBACK frames
+static int16_t latency, peak;
+static uint16_t reportedRate;
+
+static uint16_t responses;			// TLM_RESPONSE frames
+static uint16_t frequency[LOOPBACK_TONES];
+static double gain[LOOPBACK_TONES];
+static double phase[LOOPBACK_TONES];	// Degrees
+
+/************************************************************************/
+/* FIRMWARE DEPENDENCIES                                                */
+/************************************************************************/
+
+uint8_t serial_free() {
+	return consoleFree ? 63 : 0;
+}
+
+void sched_post(uint8_t id) {
+	if (id == TASK_CONTROL) controlPosts++;
+}
+
+void telemetry_loopback(int16_t l, int16_t p, uint16_t rate) {
+	impulses++;
+	latency = l;
+	peak = p;
+	reportedRate = rate;
+}
+
+void telemetry_response(uint16_t f, int32_t inPhase, int32_t quadrature) {
+	double amplitude = LOOPBACK_AMPLITUDE * 127.0 / 128 * 127 * LOOPBACK_MEASURE / 2;	// Of the sums at unity gain
+
+	if (responses < LOOPBACK_TONES) {
+		frequency[responses] = f;
+		gain[responses] = hypot(inPhase, quadrature) / amplitude;
+		phase[responses] = atan2(inPhase, quadrature) * 180 / M_PI;
+	}
+	responses++;
+}
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+// Impulse response of the model, n samples after the output was set
+static double chain_impulse(double a, int n) {
+	return CHAIN_GAIN * (1 - a) * (1 - a) * n * pow(a, n - 1);
+}
+
+// Runs the test at a sample rate through the model of the chain
+static void run(uint16_t rate) {
+	double a = exp(-2 * M_PI * CHAIN_CORNER / rate);
+	double y1 = 0x80, y2 = 0x80;		// Filter sections
+	double expectGain, expectPhase, w;
+	double before, at, after;
+	long n;
+	int input, i, bin;
+
+	consoleFree = 0;
+	controlPosts = 0;
+	impulses = 0;
+	responses = 0;
+
+	loopback_start(rate);
+	for (n = 0; n < SAMPLES_MAX && !loopback_done(); n++) {
+		input = (int)lround(0x80 + CHAIN_GAIN * (y2 - 0x80));	// ADC samples the chain
+		loopback_sample(input < 0 ? 0 : input > 255 ? 255 : input);
+		y1 = a * y1 + (1 - a) * OCR4B;							// Output held for a sample period
+		y2 = a * y2 + (1 - a) * y1;
+		loopback_poll();
+		consoleFree = !consoleFree;
+	}
+
+	CHECK(loopback_done());
+	CHECK_EQUAL(controlPosts, 1);
+	CHECK_EQUAL(OCR4B, 0x80);							// Output back to mid scale
+	CHECK_EQUAL(impulses, 1);
+	CHECK_EQUAL(responses, LOOPBACK_TONES);
+	CHECK_EQUAL(reportedRate, rate);
+
+	// Impulse response of the model peaks one sample after the impulse
+	before = chain_impulse(a, 0);
+	at = chain_impulse(a, 1);
+	after = chain_impulse(a, 2);
+	CHECK(fabs(latency - 100 * (1 + (before - after) / (2 * (before - 2 * at + after)))) <= LATENCY_TOLERANCE);
+	CHECK(fabs(peak - LOOPBACK_REPEATS * 127 * at) <= 0.02 * LOOPBACK_REPEATS * 127 * at);
+
+	for (i = 0; i < LOOPBACK_TONES && i < responses; i++) {
+		bin = (int)lround((double)frequency[i] * LOOPBACK_MEASURE / rate);	// Cycles in the measurement
+		w = 2 * M_PI * bin / LOOPBACK_MEASURE;
+		expectGain = CHAIN_GAIN * (1 - a) * (1 - a) / (1 - 2 * a * cos(w) + a * a);
+		expectPhase = (-w - 2 * atan2(a * sin(w), 1 - a * cos(w))) * 180 / M_PI;
+		expectPhase = remainder(expectPhase, 360);		// -180 to 180 degrees
+
+		printf("%5u Hz: gain %.3f (model %.3f), phase %6.1f (model %6.1f)\n",
+			frequency[i], gain[i], expectGain, phase[i], expectPhase);
+		CHECK(i == 0 || frequency[i] > frequency[i - 1]);
+		CHECK(fabs(gain[i] - expectGain) <= GAIN_TOLERANCE);
+		CHECK(fabs(remainder(phase[i] - expectPhase, 360)) <= PHASE_TOLERANCE);
+	}
+	printf("%u Hz: latency %.2f samples, peak %d\n", rate, latency / 100.0, peak);
+}
+
+/************************************************************************/
+/* MAIN                                                                 */
+/************************************************************************/
+int main() {
+	run(15625);
+	run(8000);
+
+	return CHECK_STATUS();
+}
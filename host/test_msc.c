@@ -0,0 +1,519 @@
+/**
+ * test_msc.c - EGB240DVR host build, USB mass storage test
+ *
+ * Runs the USB mass storage module (lib/usb_msc) against a simulated
+ * USB host and a RAM disk. The simulated controller provides the
+ * endpoint registers usb_msc.c polls (see include/avr/io.h): the host
+ * queues OUT packets (a command block wrapper, then the data stage),
+ * usb_msc_task serves the command, and the IN packets released by the
+ * module are collected as the data stage followed by the command
+ * status wrapper. The frame number advances on every read, so a host
+ * that stops sending data times out. Timer0 ticks only advance while
+ * the RAM disk moves sectors, SECTOR_TICKS per sector.
+ *
+ * Checks:
+ *   enumerate  - bus reset, SET_CONFIGURATION and GET_MAX_LUN on the
+ *                control endpoint
+ *   not ready  - without the card, commands fail with NOT READY
+ *   medium     - the medium appears as changed once, and INQUIRY,
+ *                READ CAPACITY and MODE SENSE report the RAM disk
+ *   read write - sectors written reach the disk and read back, over
+ *                several disk transfers, and a longer data stage than
+ *                the command needs is padded
+ *   statistics - the vendor STATISTICS command reports the bytes and
+ *                ticks of the READ(10) and WRITE(10) commands since the
+ *                last one, including the part of a failed transfer
+ *                before the disk error, and clears them
+ *   errors     - a data stage in the wrong direction, a transfer
+ *                longer than the data stage, an unknown command and
+ *                disk errors fail with the matching sense data; the
+ *                data stage is always completed and a status wrapper
+ *                follows, also after the host stops sending
+ *
+ * Usage: test_msc
+ *
+ * The exit status is 1 if any check failed.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../lib/fatfs/diskio.h"
+#include "../lib/usb_msc/usb_msc.h"
+#include "check.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define DISK_SECTORS	64			// RAM disk size (512 byte sectors)
+#define DISK_OK			0xFFFFFFFF	// No failing sector
+#define SECTOR_TICKS	3			// Ticks per sector read or written
+
+#define ENDPOINTS		3			// Control, bulk IN, bulk OUT
+#define TX_ENDPOINT		1			// Bulk IN (device to host)
+#define RX_ENDPOINT		2			// Bulk OUT (host to device)
+#define PACKET_SIZE		64			// Bulk endpoint size
+#define STREAM_MAX		8192		// Bytes in either direction per command
+#define PACKETS_MAX		(STREAM_MAX / PACKET_SIZE + 1)
+#define FIFOCON			7			// UEINTX: bank free (IN) or full (OUT)
+
+#define CBW_SIZE		31
+#define CSW_SIZE		13
+#define DIR_IN			0x80		// CBW flags: data stage device to host
+
+#define SCSI_TEST_UNIT_READY	0x00
+#define SCSI_REQUEST_SENSE		0x03
+#define SCSI_INQUIRY			0x12
+#define SCSI_MODE_SENSE_6		0x1A
+#define SCSI_READ_CAPACITY_10	0x25
+#define SCSI_READ_10			0x28
+#define SCSI_WRITE_10			0x2A
+#define SCSI_STATISTICS			0xC0
+
+// Sense key and additional sense code as reported by sense()
+#define SENSE(key, asc)			(((key) << 8) | (asc))
+#define SENSE_NONE				SENSE(0x00, 0x00)
+#define SENSE_NOT_PRESENT		SENSE(0x02, 0x3A)
+#define SENSE_READ_ERROR		SENSE(0x03, 0x11)
+#define SENSE_WRITE_FAULT		SENSE(0x03, 0x03)
+#define SENSE_ILLEGAL			SENSE(0x05, 0x20)
+#define SENSE_CHANGED			SENSE(0x06, 0x28)
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+volatile uint8_t SREG;
+volatile uint8_t UHWCON, USBCON, PLLCSR, UDCON, UDINT, UDIEN, UDADDR;
+volatile uint8_t UENUM, UERST, UECONX, UECFG0X, UECFG1X, UEIENX;
+
+// Simulated controller
+static volatile uint8_t ueintx[ENDPOINTS];	// UEINTX of each endpoint
+static uint8_t ueintxRead[ENDPOINTS];		// Value last read (differs once written)
+static volatile uint8_t uebclx;				// UEBCLX as last read
+static volatile uint8_t frame;				// UDFNUML, advances on every read
+static volatile uint8_t unused;				// FIFO of an endpoint not modelled
+
+static volatile uint8_t setup[8];			// Control endpoint SETUP packet
+static uint8_t setupRead;					// Bytes of it read (8: none pending)
+static volatile uint8_t control[64];		// Control endpoint IN data
+static uint8_t controlLength;
+
+static volatile uint8_t txBank[PACKET_SIZE];	// IN bank being filled
+static uint8_t txCount;
+
+// Simulated host
+static uint8_t in[STREAM_MAX];				// IN data received by the host
+static uint16_t inLength;
+static volatile uint8_t out[STREAM_MAX];	// OUT packets queued by the host
+static uint16_t outEnd[PACKETS_MAX];		// End of each packet in out[]
+static uint16_t outPackets, outCurrent;		// Packets queued, packet in the bank
+static uint16_t outRead;					// Position in out[] of the next byte read
+static uint32_t tag;						// Tag of the last command
+
+static uint32_t residue;					// CSW of the last command
+static uint16_t dataLength;					// Data stage received (bytes at in[0])
+
+// RAM disk
+static uint8_t disk[DISK_SECTORS][512];
+static uint8_t diskStatus;
+static uint32_t diskFail = DISK_OK;			// Sector whose transfers fail
+static uint32_t sectorsRead, sectorsWritten;
+static uint32_t ticks;						// Timer0 tick count
+
+static uint8_t block[1024];					// Scratch block for usb_msc_task
+static uint8_t pattern[STREAM_MAX];
+
+void USB_GEN_vect(void);
+void USB_COM_vect(void);
+
+/************************************************************************/
+/* FIRMWARE DEPENDENCIES                                                */
+/************************************************************************/
+
+uint32_t timer_ticks() {
+	return ticks;
+}
+
+DSTATUS disk_status(BYTE pdrv) {
+	return diskStatus;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count) {
+	CHECK(sector + count <= DISK_SECTORS);
+	if (diskFail >= sector && diskFail < sector + count) return RES_ERROR;
+	memcpy(buff, disk[sector], count * 512);
+	sectorsRead += count;
+	ticks += count * SECTOR_TICKS;
+	return RES_OK;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count) {
+	CHECK(sector + count <= DISK_SECTORS);
+	if (diskFail >= sector && diskFail < sector + count) return RES_ERROR;
+	memcpy(disk[sector], buff, count * 512);
+	sectorsWritten += count;
+	ticks += count * SECTOR_TICKS;
+	return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* buff) {
+	if (cmd != GET_SECTOR_COUNT) return RES_PARERR;
+	*(DWORD*)buff = DISK_SECTORS;
+	return RES_OK;
+}
+
+/************************************************************************/
+/* SIMULATED CONTROLLER                                                 */
+/************************************************************************/
+
+// Start of the OUT packet in the bank
+static uint16_t out_start() {
+	return outCurrent ? outEnd[outCurrent - 1] : 0;
+}
+
+// Applies the bank releases written to UEINTX since it was last read
+static void usb_update() {
+	if (ueintx[TX_ENDPOINT] != ueintxRead[TX_ENDPOINT]) {
+		ueintxRead[TX_ENDPOINT] = ueintx[TX_ENDPOINT];
+		if (!(ueintx[TX_ENDPOINT] & (1<<FIFOCON))) {	// IN packet sent
+			CHECK(inLength + txCount <= STREAM_MAX);
+			if (inLength + txCount <= STREAM_MAX) memcpy(in + inLength, (const uint8_t*)txBank, txCount);
+			inLength += txCount;
+			txCount = 0;
+		}
+	}
+	if (ueintx[RX_ENDPOINT] != ueintxRead[RX_ENDPOINT]) {
+		ueintxRead[RX_ENDPOINT] = ueintx[RX_ENDPOINT];
+		if (!(ueintx[RX_ENDPOINT] & (1<<FIFOCON)) && outCurrent < outPackets) {	// OUT bank released
+			outCurrent++;
+			outRead = out_start();
+		}
+	}
+}
+
+// Endpoint status as the module reads it
+static uint8_t usb_status(uint8_t endpoint) {
+	switch (endpoint) {
+		case 0:
+			return (setupRead < 8 ? (1<<RXSTPI) : 0) | (1<<TXINI);
+		case TX_ENDPOINT:
+			return (1<<FIFOCON) | (1<<TXINI) | (txCount < PACKET_SIZE ? (1<<RWAL) : 0);
+		case RX_ENDPOINT:
+			if (outCurrent >= outPackets) return 0;
+			return (1<<FIFOCON) | (1<<RXOUTI) | (outRead < outEnd[outCurrent] ? (1<<RWAL) : 0);
+	}
+	return 0;
+}
+
+volatile uint8_t* usb_register(uint8_t address) {
+	uint8_t endpoint = UENUM;
+
+	usb_update();
+	switch (address) {
+		case 0xE4:										// UDFNUML
+			frame++;
+			return &frame;
+		case 0xE8:										// UEINTX
+			if (endpoint >= ENDPOINTS) return &unused;
+			ueintx[endpoint] = ueintxRead[endpoint] = usb_status(endpoint);
+			return &ueintx[endpoint];
+		case 0xF2:										// UEBCLX
+			uebclx = 0;
+			if (endpoint == TX_ENDPOINT) uebclx = txCount;
+			if (endpoint == RX_ENDPOINT && outCurrent < outPackets) uebclx = outEnd[outCurrent] - outRead;
+			return &uebclx;
+		case 0xF1:										// UEDATX
+			if (endpoint == 0) {
+				if (setupRead < 8) return &setup[setupRead++];
+				CHECK(controlLength < sizeof(control));
+				return controlLength < sizeof(control) ? &control[controlLength++] : &unused;
+			}
+			if (endpoint == TX_ENDPOINT) {
+				CHECK(txCount < PACKET_SIZE);			// Written only while RWAL
+				return txCount < PACKET_SIZE ? &txBank[txCount++] : &unused;
+			}
+			if (endpoint == RX_ENDPOINT) {
+				CHECK(outCurrent < outPackets && outRead < outEnd[outCurrent]);
+				return (outCurrent < outPackets && outRead < outEnd[outCurrent]) ? &out[outRead++] : &unused;
+			}
+			break;
+	}
+	CHECK(0);											// Register not modelled
+	return &unused;
+}
+
+/************************************************************************/
+/* SIMULATED HOST                                                       */
+/************************************************************************/
+
+static void put32(uint8_t* p, uint32_t n) {
+	p[0] = n;
+	p[1] = n >> 8;
+	p[2] = n >> 16;
+	p[3] = n >> 24;
+}
+
+static uint32_t get32(const uint8_t* p) {
+	return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Queues bytes on the OUT endpoint as packets of up to PACKET_SIZE
+static void host_out(const uint8_t* data, uint16_t length) {
+	uint16_t end = outPackets ? outEnd[outPackets - 1] : 0, n;
+
+	do {
+		n = length < PACKET_SIZE ? length : PACKET_SIZE;
+		memcpy((uint8_t*)out + end, data, n);
+		data += n;
+		length -= n;
+		end += n;
+		outEnd[outPackets++] = end;
+	} while (length);
+}
+
+// Runs a control request through the endpoint interrupt
+static void host_control(uint8_t requestType, uint8_t request, uint16_t value, uint16_t length) {
+	setup[0] = requestType;
+	setup[1] = request;
+	setup[2] = value;
+	setup[3] = value >> 8;
+	setup[4] = setup[5] = 0;
+	setup[6] = length;
+	setup[7] = length >> 8;
+	setupRead = 0;
+	controlLength = 0;
+	USB_COM_vect();
+	CHECK_EQUAL(setupRead, 8);
+}
+
+// Sends a command with length bytes of data stage (IN if flags has
+// DIR_IN, otherwise taken from data) and returns the CSW status. The
+// IN data stage is left at in[0], dataLength bytes
+static uint8_t host_command(const uint8_t* cb, uint8_t cbLength, uint8_t flags, uint32_t length, const uint8_t* data, uint8_t* medium) {
+	uint8_t cbw[CBW_SIZE] = { 'U', 'S', 'B', 'C' };
+	const uint8_t* csw;
+
+	put32(cbw + 4, ++tag);
+	put32(cbw + 8, length);
+	cbw[12] = flags;
+	cbw[14] = cbLength;
+	memcpy(cbw + 15, cb, cbLength);
+
+	inLength = 0;
+	outPackets = outCurrent = outRead = 0;
+	host_out(cbw, CBW_SIZE);
+	if (!(flags & DIR_IN) && data) host_out(data, length);
+	usb_msc_task(medium);
+	usb_update();
+
+	CHECK_EQUAL(outCurrent, outPackets);				// Whole OUT stage taken
+	CHECK(inLength >= CSW_SIZE);
+	if (inLength < CSW_SIZE) return 0xFF;
+	dataLength = inLength - CSW_SIZE;
+	csw = in + dataLength;
+	CHECK(memcmp(csw, "USBS", 4) == 0);
+	CHECK_EQUAL(get32(csw + 4), tag);
+	CHECK_EQUAL(dataLength, (flags & DIR_IN) ? length : 0);	// IN stage always completed
+	residue = get32(csw + 8);
+	return csw[12];
+}
+
+// Commands with a ten byte command block addressing sectors
+static uint8_t host_transfer(uint8_t opcode, uint32_t lba, uint16_t count, uint8_t flags, uint32_t length, const uint8_t* data) {
+	uint8_t cb[10] = { opcode, 0, lba >> 24, lba >> 16, lba >> 8, lba, 0, count >> 8, count, 0 };
+
+	return host_command(cb, sizeof(cb), flags, length, data, block);
+}
+
+// Sense data of the last failed command
+static uint16_t sense(uint8_t* medium) {
+	uint8_t cb[6] = { SCSI_REQUEST_SENSE, 0, 0, 0, 18, 0 };
+
+	CHECK_EQUAL(host_command(cb, sizeof(cb), DIR_IN, 18, 0, medium), 0);
+	CHECK_EQUAL(in[0], 0x70);
+	return SENSE(in[2], in[12]);
+}
+
+// Transfer statistics since the last call: bytes and ticks of READ(10)
+// in stats[0] and [1], of WRITE(10) in stats[2] and [3]
+static void statistics(uint32_t* stats) {
+	uint8_t cb[6] = { SCSI_STATISTICS, 0, 0, 0, 16, 0 };
+	uint8_t i;
+
+	CHECK_EQUAL(host_command(cb, sizeof(cb), DIR_IN, 16, 0, block), 0);
+	for (i = 0; i < 4; i++) {
+		stats[i] = ((uint32_t)in[4 * i] << 24) | ((uint32_t)in[4 * i + 1] << 16) | (in[4 * i + 2] << 8) | in[4 * i + 3];
+	}
+}
+
+/************************************************************************/
+/* TESTS                                                                */
+/************************************************************************/
+
+static void test_enumerate() {
+	UDINT = (1<<EORSTI);								// Bus reset
+	USB_GEN_vect();
+	CHECK_EQUAL(usb_msc_configured(), 0);
+
+	host_control(0x00, 9, 1, 0);						// SET_CONFIGURATION 1
+	CHECK_EQUAL(usb_msc_configured(), 1);
+	host_control(0xA1, 0xFE, 0, 1);						// GET_MAX_LUN
+	CHECK_EQUAL(controlLength, 1);
+	CHECK_EQUAL(control[0], 0);
+}
+
+static void test_not_ready() {
+	uint8_t unitReady[6] = { SCSI_TEST_UNIT_READY };
+	uint8_t capacity[10] = { SCSI_READ_CAPACITY_10 };
+
+	CHECK_EQUAL(host_command(unitReady, sizeof(unitReady), 0, 0, 0, 0), 1);
+	CHECK_EQUAL(sense(0), SENSE_NOT_PRESENT);
+	CHECK_EQUAL(host_command(capacity, sizeof(capacity), DIR_IN, 8, 0, 0), 1);
+	CHECK_EQUAL(residue, 8);							// Padded
+	CHECK_EQUAL(sense(0), SENSE_NOT_PRESENT);
+}
+
+static void test_medium() {
+	uint8_t unitReady[6] = { SCSI_TEST_UNIT_READY };
+	uint8_t inquiry[6] = { SCSI_INQUIRY, 0, 0, 0, 36, 0 };
+	uint8_t capacity[10] = { SCSI_READ_CAPACITY_10 };
+	uint8_t modeSense[6] = { SCSI_MODE_SENSE_6, 0, 0x3F, 0, 4, 0 };
+
+	CHECK_EQUAL(host_command(unitReady, sizeof(unitReady), 0, 0, 0, block), 1);
+	CHECK_EQUAL(sense(block), SENSE_CHANGED);
+	CHECK_EQUAL(host_command(unitReady, sizeof(unitReady), 0, 0, 0, block), 0);
+	CHECK_EQUAL(sense(block), SENSE_NONE);
+
+	CHECK_EQUAL(host_command(inquiry, sizeof(inquiry), DIR_IN, 36, 0, block), 0);
+	CHECK_EQUAL(residue, 0);
+	CHECK_EQUAL(in[0], 0x00);							// Direct access block device
+	CHECK_EQUAL(in[1], 0x80);							// Removable
+	CHECK(memcmp(in + 8, "EGB240  Recorder", 16) == 0);
+
+	CHECK_EQUAL(host_command(capacity, sizeof(capacity), DIR_IN, 8, 0, block), 0);
+	CHECK_EQUAL(in[3] | (in[2] << 8), DISK_SECTORS - 1);	// Last logical block
+	CHECK_EQUAL(in[6] << 8 | in[7], 512);
+
+	CHECK_EQUAL(host_command(modeSense, sizeof(modeSense), DIR_IN, 4, 0, block), 0);
+	CHECK_EQUAL(in[2], 0x00);
+	diskStatus = STA_PROTECT;
+	CHECK_EQUAL(host_command(modeSense, sizeof(modeSense), DIR_IN, 4, 0, block), 0);
+	CHECK_EQUAL(in[2], 0x80);							// Write protected
+	diskStatus = 0;
+}
+
+static void test_read_write() {
+	uint16_t i;
+
+	for (i = 0; i < sizeof(pattern); i++) {
+		pattern[i] = i * 7 + (i >> 9);
+	}
+	sectorsRead = sectorsWritten = 0;
+
+	CHECK_EQUAL(host_transfer(SCSI_WRITE_10, 3, 5, 0, 5 * 512, pattern), 0);
+	CHECK_EQUAL(residue, 0);
+	CHECK_EQUAL(sectorsWritten, 5);
+	CHECK(memcmp(disk[3], pattern, 5 * 512) == 0);
+	CHECK_EQUAL(usb_msc_changed(), 1);					// Once per write
+	CHECK_EQUAL(usb_msc_changed(), 0);
+
+	CHECK_EQUAL(host_transfer(SCSI_READ_10, 3, 5, DIR_IN, 5 * 512, 0), 0);
+	CHECK_EQUAL(residue, 0);
+	CHECK_EQUAL(sectorsRead, 5);
+	CHECK(memcmp(in, pattern, 5 * 512) == 0);
+
+	CHECK_EQUAL(host_transfer(SCSI_READ_10, 4, 1, DIR_IN, 1024, 0), 0);	// Host expects more
+	CHECK_EQUAL(residue, 512);
+	CHECK(memcmp(in, pattern + 512, 512) == 0);
+	CHECK_EQUAL(in[512], 0);							// Padding
+	CHECK_EQUAL(in[1023], 0);
+	CHECK_EQUAL(usb_msc_changed(), 0);
+}
+
+static void test_statistics() {
+	uint32_t stats[4], delivered;
+
+	statistics(stats);									// Clear the earlier tests
+	CHECK_EQUAL(host_transfer(SCSI_WRITE_10, 30, 6, 0, 6 * 512, pattern), 0);
+	CHECK_EQUAL(host_transfer(SCSI_READ_10, 30, 6, DIR_IN, 6 * 512, 0), 0);
+	CHECK_EQUAL(host_transfer(SCSI_READ_10, 31, 1, DIR_IN, 512, 0), 0);
+	statistics(stats);
+	CHECK_EQUAL(stats[0], 7 * 512);
+	CHECK_EQUAL(stats[1], 7 * SECTOR_TICKS);
+	CHECK_EQUAL(stats[2], 6 * 512);
+	CHECK_EQUAL(stats[3], 6 * SECTOR_TICKS);
+
+	statistics(stats);									// Cleared by the last call
+	CHECK_EQUAL(stats[0] | stats[1] | stats[2] | stats[3], 0);
+
+	diskFail = 33;										// Fails in the second disk transfer
+	CHECK_EQUAL(host_transfer(SCSI_READ_10, 30, 6, DIR_IN, 6 * 512, 0), 1);
+	delivered = 6 * 512 - residue;
+	CHECK_EQUAL(sense(block), SENSE_READ_ERROR);
+	diskFail = DISK_OK;
+	statistics(stats);
+	CHECK_EQUAL(stats[0], delivered);
+	CHECK(delivered < 6 * 512);
+	CHECK_EQUAL(stats[1], stats[0] / 512 * SECTOR_TICKS);
+}
+
+static void test_errors() {
+	uint8_t inquiry[6] = { SCSI_INQUIRY, 0, 0, 0, 36, 0 };
+	uint8_t unknown[6] = { 0x55 };
+	uint8_t unitReady[6] = { SCSI_TEST_UNIT_READY };
+	uint32_t delivered;
+
+	memset(disk[10], 0xA5, 512);
+	CHECK_EQUAL(host_transfer(SCSI_WRITE_10, 10, 1, DIR_IN, 512, 0), 1);	// Data stage in the wrong direction
+	CHECK_EQUAL(residue, 512);
+	CHECK_EQUAL(disk[10][0], 0xA5);
+	CHECK_EQUAL(sense(block), SENSE_ILLEGAL);
+	CHECK_EQUAL(host_transfer(SCSI_READ_10, 10, 1, 0, 512, pattern), 1);
+	CHECK_EQUAL(residue, 512);
+	CHECK_EQUAL(sense(block), SENSE_ILLEGAL);
+	CHECK_EQUAL(host_command(inquiry, sizeof(inquiry), 0, 36, pattern, block), 1);
+	CHECK_EQUAL(sense(block), SENSE_ILLEGAL);
+
+	CHECK_EQUAL(host_transfer(SCSI_READ_10, 10, 2, DIR_IN, 512, 0), 1);	// Longer than the data stage
+	CHECK_EQUAL(sense(block), SENSE_ILLEGAL);
+	CHECK_EQUAL(host_command(unknown, sizeof(unknown), 0, 0, 0, block), 1);
+	CHECK_EQUAL(sense(block), SENSE_ILLEGAL);
+	CHECK_EQUAL(sense(block), SENSE_NONE);				// Reported once
+
+	diskFail = 6;
+	CHECK_EQUAL(host_transfer(SCSI_READ_10, 3, 4, DIR_IN, 4 * 512, 0), 1);
+	delivered = 4 * 512 - residue;						// Sectors before the failing transfer
+	CHECK_EQUAL(delivered % 512, 0);
+	CHECK(delivered < (6 - 3 + 1) * 512);
+	CHECK(memcmp(in, pattern, delivered) == 0);
+	CHECK_EQUAL(sense(block), SENSE_READ_ERROR);
+	CHECK_EQUAL(host_transfer(SCSI_WRITE_10, 6, 1, 0, 512, pattern), 1);
+	CHECK_EQUAL(sense(block), SENSE_WRITE_FAULT);
+	diskFail = DISK_OK;
+
+	CHECK_EQUAL(host_transfer(SCSI_WRITE_10, 20, 2, 0, 1024, 0), 1);	// Host sends no data
+	CHECK_EQUAL(host_command(unitReady, sizeof(unitReady), 0, 0, 0, block), 0);	// and recovers
+}
+
+/************************************************************************/
+/* MAIN                                                                 */
+/************************************************************************/
+int main() {
+	test_enumerate();
+	test_not_ready();
+	test_medium();
+	test_read_write();
+	test_statistics();
+	test_errors();
+
+	return CHECK_STATUS();
+}
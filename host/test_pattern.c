@@ -0,0 +1,176 @@
+/**
+ * test_pattern.c - EGB240DVR host build, test pattern verifier test
+ *
+ * Builds takes from the test pattern sequence with known faults (gaps
+ * inside a page, across a page boundary and at the last sample of a
+ * page, a repeated page, a gap too long to measure), feeds them to
+ * pattern_check a page at a time as dvr_write_page does, and checks
+ * the breaks, lost samples, unresolved breaks and first break page
+ * reported.
+ *
+ * Usage: test_pattern
+ *
+ * The exit status is 1 if any check failed.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <stdint.h>
+#include <string.h>
+
+#include "../pattern.h"
+#include "check.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define PAGE			512			// Page size of the recorder
+#define PERIOD			65535UL		// Sequence length
+#define TAKE_MAX		32768		// Longest take built (samples)
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static uint8_t sequence[PERIOD];	// The sequence from the start of a take
+static uint8_t take[TAKE_MAX];		// Samples of the take being built
+static uint16_t takeLength;
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+// Generates the sequence as adc_pattern produces it
+static void sequence_init() {
+	uint8_t last = PATTERN_SEED, before = 0;
+	uint32_t i;
+
+	for (i = 0; i < PERIOD; i++) {
+		sequence[i] = PATTERN_NEXT(last, before);
+		before = last;
+		last = sequence[i];
+	}
+}
+
+// Appends count samples of the sequence from position start to the take
+static void append(uint32_t start, uint16_t count) {
+	while (count--) {
+		take[takeLength++] = sequence[start++ % PERIOD];
+	}
+}
+
+// Checks the take a page at a time from a fresh start
+static const PATTERN_RESULT* verify(uint16_t page) {
+	uint16_t i;
+
+	pattern_reset();
+	for (i = 0; i < takeLength; i += page) {
+		pattern_check(take + i, (takeLength - i < page) ? takeLength - i : page);
+	}
+	takeLength = 0;
+	return pattern_result();
+}
+
+/************************************************************************/
+/* TESTS                                                                */
+/************************************************************************/
+
+static void test_clean() {
+	const PATTERN_RESULT* result;
+
+	append(0, 20 * PAGE);
+	result = verify(PAGE);
+	CHECK_EQUAL(result->pages, 20);
+	CHECK_EQUAL(result->breaks, 0);
+	CHECK_EQUAL(result->lost, 0);
+	CHECK_EQUAL(result->unresolved, 0);
+	CHECK_EQUAL(result->first, PATTERN_NONE);
+}
+
+static void test_gaps() {
+	const PATTERN_RESULT* result;
+
+	append(0, 1000);							// 37 samples lost inside page 1
+	append(1037, 1048);
+	append(1037 + 1048 + PAGE, 1024);			// A page lost between pages 3 and 4
+	append(1037 + 1048 + PAGE + 1024 + 40, 1024 + 511);	// 40 lost before the first sample of page 6
+	append(1037 + 1048 + PAGE + 1024 + 40 + 1024 + 511 + 20, 1);	// 20 lost before the last sample of page 8
+	append(1037 + 1048 + PAGE + 1024 + 40 + 1024 + 511 + 20 + 1, PAGE);
+	result = verify(PAGE);
+	CHECK_EQUAL(result->pages, 10);
+	CHECK_EQUAL(result->breaks, 4);
+	CHECK_EQUAL(result->lost, 37 + PAGE + 40 + 20);
+	CHECK_EQUAL(result->unresolved, 0);
+	CHECK_EQUAL(result->first, 1);
+}
+
+static void test_repeat() {
+	const PATTERN_RESULT* result;
+
+	append(0, 3 * PAGE);
+	append(2 * PAGE, PAGE);						// Page 2 written twice
+	append(3 * PAGE, 2 * PAGE);
+	result = verify(PAGE);
+	CHECK_EQUAL(result->pages, 6);
+	CHECK_EQUAL(result->breaks, 1);				// The sequence continues after the copy
+	CHECK_EQUAL(result->lost, 0);
+	CHECK_EQUAL(result->unresolved, 1);
+	CHECK_EQUAL(result->first, 3);
+}
+
+static void test_long_gap() {
+	const PATTERN_RESULT* result;
+
+	append(0, 2 * PAGE);
+	append(2 * PAGE + PATTERN_SEARCH_MAX + 1000, 2 * PAGE);	// Too long to measure
+	result = verify(PAGE);
+	CHECK_EQUAL(result->breaks, 1);
+	CHECK_EQUAL(result->lost, 0);
+	CHECK_EQUAL(result->unresolved, 1);
+	CHECK_EQUAL(result->first, 2);
+}
+
+static void test_page_size() {
+	const PATTERN_RESULT* result;
+
+	append(0, 700);								// Short pages: the break is in page 5
+	append(900, 1300);
+	result = verify(128);
+	CHECK_EQUAL(result->pages, 16);
+	CHECK_EQUAL(result->breaks, 1);
+	CHECK_EQUAL(result->lost, 200);
+	CHECK_EQUAL(result->first, 5);
+}
+
+static void test_reset() {
+	const PATTERN_RESULT* result;
+
+	append(0, PAGE);							// A faulty take, then a clean one
+	append(PAGE + 10, PAGE);
+	verify(PAGE);
+	append(5000, 4 * PAGE);						// Starts anywhere in the sequence
+	result = verify(PAGE);
+	CHECK_EQUAL(result->pages, 4);
+	CHECK_EQUAL(result->breaks, 0);
+	CHECK_EQUAL(result->first, PATTERN_NONE);
+}
+
+/************************************************************************/
+/* MAIN                                                                 */
+/************************************************************************/
+int main() {
+	sequence_init();
+
+	test_clean();
+	test_gaps();
+	test_repeat();
+	test_long_gap();
+	test_page_size();
+	test_reset();
+
+	return CHECK_STATUS();
+}
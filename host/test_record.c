@@ -0,0 +1,173 @@
+/**
+ * test_record.c - EGB240DVR host build, record page path test
+ *
+ * Records takes through the page write path of the SD write task
+ * (record.c): samples are queued in the circular buffer as the ADC
+ * interrupt does, and every full page is handed to record_page, which
+ * writes it to a WAVE file on a disk image and, in test pattern mode,
+ * checks it first. The file is read back and compared with the samples
+ * queued, and the verifier results with the faults put in the take.
+ *
+ * Checks:
+ *   pattern - a clean pattern take reaches the file unchanged and every
+ *             page is verified without a break
+ *   plain   - outside pattern mode the file is the same and nothing is
+ *             verified
+ *   gap     - samples left out of a pattern take are found in the page
+ *             they were left out of, and the file holds what was queued
+ *
+ * Usage: test_record
+ *
+ * The exit status is 1 if any check failed.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../buffer.h"
+#include "../pattern.h"
+#include "../record.h"
+#include "../wave.h"
+#include "check.h"
+#include "hal.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define PAGE			512			// Page size of the recorder
+#define PERIOD			65535UL		// Sequence length
+#define TAKE_MAX		(40 * PAGE)	// Longest take (samples)
+#define IMAGE_SECTORS	4096UL		// 2 MB disk image
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static uint8_t sequence[PERIOD];	// The sequence from the start of a take
+static uint8_t take[TAKE_MAX];		// Samples queued in the take
+static uint32_t takeLength;
+static uint8_t check;				// Pattern mode of the take
+static uint16_t writeErrors;		// record_page failures
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+// Buffer callbacks, standing in for the SD write task of main.c
+static void page_full() {
+	if (record_page(PAGE, check)) writeErrors++;
+}
+
+static void page_empty() {
+}
+
+// Generates the sequence as adc_pattern produces it
+static void sequence_init() {
+	uint8_t last = PATTERN_SEED, before = 0;
+	uint32_t i;
+
+	for (i = 0; i < PERIOD; i++) {
+		sequence[i] = PATTERN_NEXT(last, before);
+		before = last;
+		last = sequence[i];
+	}
+}
+
+// Appends count samples of the sequence from position start to the take
+static void append(uint32_t start, uint32_t count) {
+	while (count--) {
+		take[takeLength++] = sequence[start++ % PERIOD];
+	}
+}
+
+// Records the take (whole pages) through the page write path, then
+// checks that the file holds exactly the samples queued
+static void record(uint8_t pattern) {
+	uint8_t page[PAGE];
+	uint32_t i, samples;
+
+	check = pattern;
+	writeErrors = 0;
+	wave_select("RECORD.WAV");
+	wave_create();
+	buffer_reset();
+	pattern_reset();
+	for (i = 0; i < takeLength; i++) {
+		buffer_queue(take[i]);				// As the ADC interrupt
+	}
+	wave_close();
+	CHECK_EQUAL(writeErrors, 0);
+
+	samples = wave_open();
+	CHECK_EQUAL(samples, takeLength);
+	for (i = 0; i < samples && i < takeLength; i += PAGE) {
+		CHECK_EQUAL(wave_read(page, PAGE), 0);
+		CHECK(memcmp(page, take + i, PAGE) == 0);
+	}
+	wave_close();
+	takeLength = 0;
+}
+
+/************************************************************************/
+/* TESTS                                                                */
+/************************************************************************/
+
+static void test_pattern() {
+	const PATTERN_RESULT* result;
+
+	append(0, 20 * PAGE);
+	record(1);
+	result = pattern_result();
+	CHECK_EQUAL(result->pages, 20);
+	CHECK_EQUAL(result->breaks, 0);
+	CHECK_EQUAL(result->lost, 0);
+	CHECK_EQUAL(result->first, PATTERN_NONE);
+}
+
+static void test_plain() {
+	append(1000, 8 * PAGE);
+	record(0);
+	CHECK_EQUAL(pattern_result()->pages, 0);
+}
+
+static void test_gap() {
+	const PATTERN_RESULT* result;
+
+	append(0, 3 * PAGE + 100);				// 100 samples lost in page 3
+	append(3 * PAGE + 200, 7 * PAGE - 100);
+	record(1);
+	result = pattern_result();
+	CHECK_EQUAL(result->pages, 10);
+	CHECK_EQUAL(result->breaks, 1);
+	CHECK_EQUAL(result->lost, 100);
+	CHECK_EQUAL(result->first, 3);
+}
+
+/************************************************************************/
+/* MAIN                                                                 */
+/************************************************************************/
+int main() {
+	if (hal_disk_attach("record.img", IMAGE_SECTORS) || hal_disk_format()) {
+		fprintf(stderr, "test_record: cannot create disk image\n");
+		return 1;
+	}
+	buffer_init(page_full, page_empty);
+	wave_init();
+	sequence_init();
+
+	test_pattern();
+	test_plain();
+	test_gap();
+
+	hal_disk_detach();
+	CHECK_EQUAL(hal_log_count(), 0);
+
+	return CHECK_STATUS();
+}
@@ -0,0 +1,262 @@
+/**
+ * test_throughput.c - EGB240DVR host build, record path benchmark test
+ *
+ * Runs the throughput benchmark (throughput.c) against a model of the
+ * SD card in place of wave.c and a simulated Timer0 tick count. Each
+ * wave_write takes a fixed overhead plus a time per sector touched,
+ * and a stalled card also pauses for CARD_STALL ticks whenever the
+ * file crosses a 64 KB erase block, as slow cards do.
+ *
+ * Checks:
+ *   stalled  - every row is reported in order; each rate is within
+ *              the bisection step below the highest rate at which the
+ *              stall fits in the free part of the buffer, and the stall
+ *              shows in the worst write time and fits within the buffer
+ *              deadline at that rate
+ *   fast     - without stalls every row sustains a higher rate than
+ *              the stall allows
+ *   error    - a card error ends the row it occurs in, and the other
+ *              rows are still measured
+ *   stop     - stopping part way closes the scratch file and restores
+ *              the selected file
+ * The console ring is only free on every other poll.
+ *
+ * Usage: test_throughput
+ *
+ * The exit status is 1 if any check failed.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../throughput.h"
+#include "../timer.h"
+#include "check.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define ROWS			6			// Rows of the benchmark table
+#define TASK_TICKS		16			// SD write task period when not posted (~1 ms)
+#define POLLS_MAX		10000000L	// Benchmark must finish within this many polls
+
+#define CARD_OVERHEAD	1			// Ticks per wave_write
+#define CARD_SECTOR		3			// Ticks per sector touched
+#define CARD_STALL		600			// Ticks lost crossing an erase block (~38 ms)
+#define CARD_BLOCK		65536UL		// Erase block size (bytes)
+
+#define STALL_RATE		((uint32_t)THROUGHPUT_BUFFER * TIMER_TICKS_PER_SEC / CARD_STALL)	// Bytes/s at which the whole buffer fills during a stall
+#define RATE_STEP		(THROUGHPUT_RATE_START >> THROUGHPUT_BISECT)	// Resolution of the rates found (first miss at most 2 x THROUGHPUT_RATE_START)
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+typedef struct {
+	uint16_t page;
+	uint8_t batch, depth, aligned;
+	uint32_t rate;
+	uint16_t worst;
+} ROW;
+
+static const ROW expected[ROWS] = {		// Table configurations in order
+	{ 512, 1, 2, 0 }, { 512, 1, 2, 1 }, { 256, 1, 4, 0 },
+	{ 256, 2, 4, 0 }, { 256, 2, 4, 1 }, { 128, 4, 8, 1 }
+};
+
+static ROW rows[ROWS];				// Rows reported
+static uint16_t rowCount;
+
+static uint32_t now;				// Tick count
+static uint8_t posted;				// SD write task posted by the benchmark
+static uint8_t consoleFree;			// Console ring has room on this poll
+
+static char selected[13] = "EGB240.WAV";
+static uint8_t fileOpen;			// Scratch file open
+static uint16_t creates;			// wave_create calls
+static uint32_t position;			// Scratch file position (bytes)
+static uint8_t stalls;				// Model erase block stalls
+static uint32_t failAt;				// Writes fail from this position (0: never)
+
+static uint8_t block[THROUGHPUT_BUFFER];
+
+/************************************************************************/
+/* FIRMWARE DEPENDENCIES                                                */
+/************************************************************************/
+
+uint8_t* buffer_block() {
+	return block;
+}
+
+uint32_t timer_ticks() {
+	return now;
+}
+
+void sched_post(uint8_t id) {
+	posted = 1;
+}
+
+uint8_t serial_free() {
+	return consoleFree ? 63 : 0;
+}
+
+void wave_select(const char* name) {
+	strcpy(selected, name);
+}
+
+const char* wave_selected() {
+	return selected;
+}
+
+void wave_create() {
+	CHECK(!fileOpen);
+	CHECK(strcmp(selected, THROUGHPUT_NAME) == 0);
+	fileOpen = 1;
+	creates++;
+	position = 44;						// After the WAVE header
+}
+
+uint8_t wave_write(uint8_t* pSamples, uint16_t count) {
+	uint32_t first = position / 512, last = (position + count - 1) / 512;
+
+	CHECK(fileOpen);
+	if (failAt && position + count > failAt) return 1;
+	now += CARD_OVERHEAD + CARD_SECTOR * (last - first + 1);
+	if (stalls && (position + count) / CARD_BLOCK != position / CARD_BLOCK) now += CARD_STALL;
+	position += count;
+	return 0;
+}
+
+void wave_close() {
+	CHECK(fileOpen);
+	fileOpen = 0;
+}
+
+void telemetry_throughput(uint16_t page, uint8_t batch, uint8_t depth, uint8_t aligned, uint32_t rate, uint16_t worst) {
+	ROW* row = &rows[rowCount < ROWS ? rowCount : ROWS - 1];
+
+	row->page = page;
+	row->batch = batch;
+	row->depth = depth;
+	row->aligned = aligned;
+	row->rate = rate;
+	row->worst = worst;
+	rowCount++;
+}
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+// Runs the benchmark as the SD write task would, up to a number of polls
+static uint8_t run(long polls) {
+	long i;
+
+	rowCount = 0;
+	creates = 0;
+	consoleFree = 0;
+	strcpy(selected, "EGB240.WAV");
+	throughput_start();
+	for (i = 0; i < polls; i++) {
+		posted = 0;
+		if (throughput_poll()) break;
+		if (!posted) now += TASK_TICKS;			// Next tick of the task
+		consoleFree = !consoleFree;
+	}
+	throughput_stop();
+	CHECK(!fileOpen);
+	CHECK(strcmp(selected, "EGB240.WAV") == 0);	// Selection restored
+	return i < polls;
+}
+
+// Checks that the rows reported are the table configurations in order
+static void check_rows() {
+	uint8_t i;
+
+	CHECK_EQUAL(rowCount, ROWS);
+	CHECK_EQUAL(creates, ROWS);
+	for (i = 0; i < ROWS && i < rowCount; i++) {
+		CHECK_EQUAL(rows[i].page, expected[i].page);
+		CHECK_EQUAL(rows[i].batch, expected[i].batch);
+		CHECK_EQUAL(rows[i].depth, expected[i].depth);
+		CHECK_EQUAL(rows[i].aligned, expected[i].aligned);
+	}
+}
+
+/************************************************************************/
+/* TESTS                                                                */
+/************************************************************************/
+
+static void test_stalled() {
+	uint32_t budget, bytes;
+	uint8_t i;
+
+	stalls = 1;
+	failAt = 0;
+	CHECK(run(POLLS_MAX));
+	check_rows();
+	for (i = 0; i < rowCount && i < ROWS; i++) {
+		bytes = (uint32_t)(rows[i].depth - rows[i].batch) * rows[i].page;	// Produced while a batch is written
+		budget = bytes * TIMER_TICKS_PER_SEC / rows[i].rate;
+		printf("stalled %3u x%u %s: %6u B/s, worst %u ticks (budget %u)\n", rows[i].page, rows[i].batch,
+			rows[i].aligned ? "aligned  " : "unaligned", rows[i].rate, rows[i].worst, budget);
+		CHECK(rows[i].rate <= bytes * TIMER_TICKS_PER_SEC / CARD_STALL);	// A stall longer than the deadline cannot pass
+		CHECK(rows[i].rate + RATE_STEP >= bytes * TIMER_TICKS_PER_SEC / (CARD_STALL + 2 * TASK_TICKS));	// Late start and write time
+		CHECK(rows[i].worst >= CARD_STALL);					// The trial saw a stall
+		CHECK(rows[i].worst <= budget + 1);					// and it fitted within the buffer deadline
+	}
+}
+
+static void test_fast() {
+	uint8_t i;
+
+	stalls = 0;
+	failAt = 0;
+	CHECK(run(POLLS_MAX));
+	check_rows();
+	for (i = 0; i < rowCount && i < ROWS; i++) {
+		printf("fast    %3u x%u %s: %6u B/s, worst %u ticks\n", rows[i].page, rows[i].batch,
+			rows[i].aligned ? "aligned  " : "unaligned", rows[i].rate, rows[i].worst);
+		CHECK(rows[i].rate > STALL_RATE);
+		CHECK(rows[i].worst < CARD_STALL);
+	}
+}
+
+static void test_error() {
+	uint8_t i;
+
+	stalls = 0;
+	failAt = 20000;								// Every row fails after 20000 bytes
+	CHECK(run(POLLS_MAX));
+	check_rows();
+	for (i = 0; i < rowCount && i < ROWS; i++) {
+		CHECK_EQUAL(rows[i].rate, 0);			// No trial completed
+	}
+}
+
+static void test_stop() {
+	stalls = 1;
+	failAt = 0;
+	CHECK(!run(20000));							// Stopped in the first row
+	CHECK_EQUAL(rowCount, 0);
+	CHECK_EQUAL(creates, 1);
+}
+
+/************************************************************************/
+/* MAIN                                                                 */
+/************************************************************************/
+int main() {
+	test_stalled();
+	test_fast();
+	test_error();
+	test_stop();
+
+	return CHECK_STATUS();
+}
@@ -0,0 +1,396 @@
+/**
+ * test_transfer.c - EGB240DVR host build, USB file transfer test
+ *
+ * Runs the file transfer module (transfer.c) against a simulated host
+ * on the USB serial port and a FAT formatted disk image. The host
+ * queues a command frame (the sync byte has already been taken by the
+ * shell), transfer_frame serves it, and the bytes written to the port
+ * are parsed as response frames. Upload data is only released to the
+ * device a credited block at a time, when the device flushes a credit
+ * frame. Time is a simulated Timer0 tick count: every write to the
+ * port costs a tick plus a tick per full 64 byte packet, every read a
+ * tick, and every poll that finds no input a tick.
+ *
+ * Checks:
+ *   list     - one frame per file with its size and 8.3 name, ended by
+ *              an empty frame carrying the status
+ *   get      - the header carries the file size, the file follows
+ *              unchanged, and the trailer reports the bytes sent and
+ *              the ticks from the header to the trailer; a missing file
+ *              is answered with the FatFs status alone
+ *   put      - credits of at most 1024 bytes cover the file exactly, it
+ *              reaches the disk unchanged, and the trailer reports the
+ *              bytes and ticks; a host that stops sending times out
+ *              with XFER_ERR_USB after the blocks it sent
+ *   errors   - unknown commands, truncated and short frames, and frames
+ *              received while busy are answered with their error frame
+ *
+ * Usage: test_transfer
+ *
+ * The exit status is 1 if any check failed.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../lib/fatfs/ff.h"
+#include "../transfer.h"
+#include "../wave.h"
+#include "check.h"
+#include "hal.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define PACKET_SIZE		64			// Bulk endpoint size
+#define STREAM_MAX		16384		// Bytes in either direction per command
+#define HEADER_SIZE		7			// Response frame header
+#define BLOCK			1024		// Transfer block (XFER_BLOCK)
+#define TIMEOUT			1563		// Command byte timeout (XFER_TIMEOUT)
+#define RX_TIMEOUT		7813		// Upload data timeout (XFER_RX_TIMEOUT)
+#define IMAGE_SECTORS	4096UL		// 2 MB disk image
+
+// Ticks taken by a write of count bytes to the port
+#define WRITE_TICKS(count)	(1 + (count) / PACKET_SIZE)
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static uint32_t now;				// Tick count
+
+static uint8_t rx[STREAM_MAX];		// Host to device
+static uint32_t rxLength;			// Bytes queued by the host
+static uint32_t rxGranted;			// Bytes the device may receive so far
+static uint32_t rxPos;				// Bytes received by the device
+
+static uint8_t tx[STREAM_MAX];		// Device to host
+static uint32_t txLength;			// Bytes written by the device
+static uint32_t txFlushed;			// Bytes flushed to the host
+static uint32_t txPos;				// Bytes parsed by the host
+
+static uint8_t data[8192];			// File contents
+static uint8_t readBack[8192];
+
+/************************************************************************/
+/* FIRMWARE DEPENDENCIES                                                */
+/************************************************************************/
+
+uint32_t timer_ticks() {
+	return now;
+}
+
+int16_t usb_serial_getchar() {
+	if (rxPos < rxGranted) return rx[rxPos++];
+	now++;								// Polled while nothing arrives
+	return -1;
+}
+
+uint16_t usb_serial_read(uint8_t* buffer, uint16_t size) {
+	uint32_t count = rxGranted - rxPos;
+
+	if (count > PACKET_SIZE) count = PACKET_SIZE;
+	if (count > size) count = size;
+	memcpy(buffer, rx + rxPos, count);
+	rxPos += count;
+	now++;
+	return count;
+}
+
+void usb_serial_flush_input() {
+	rxPos = rxGranted;					// Data not yet released is still to come
+}
+
+int8_t usb_serial_write(const uint8_t* buffer, uint16_t size) {
+	CHECK(txLength + size <= STREAM_MAX);
+	if (txLength + size > STREAM_MAX) return -1;
+	memcpy(tx + txLength, buffer, size);
+	txLength += size;
+	now += WRITE_TICKS(size);
+	return 0;
+}
+
+// The host answers a credit frame, the last thing flushed, with the
+// bytes granted
+void usb_serial_flush_output() {
+	const uint8_t* header = tx + txLength - HEADER_SIZE;
+	uint32_t length;
+
+	if (txLength - txFlushed >= HEADER_SIZE && header[0] == XFER_SYNC && header[1] == XFER_CMD_CREDIT) {
+		memcpy(&length, header + 3, 4);
+		rxGranted += length;
+		if (rxGranted > rxLength) rxGranted = rxLength;	// Host stopped sending
+	}
+	txFlushed = txLength;
+}
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+// Clears both directions of the port
+static void host_reset() {
+	rxLength = rxGranted = rxPos = 0;
+	txLength = txFlushed = txPos = 0;
+}
+
+// Queues a command frame (after the sync byte) and releases it
+static void host_command(uint8_t cmd, const void* payload, uint8_t length) {
+	rx[rxLength++] = cmd;
+	rx[rxLength++] = length;
+	memcpy(rx + rxLength, payload, length);
+	rxLength += length;
+	rxGranted = rxLength;
+}
+
+// Queues upload data, released as the device grants credit
+static void host_data(const uint8_t* bytes, uint32_t count) {
+	memcpy(rx + rxLength, bytes, count);
+	rxLength += count;
+}
+
+// Parses the next response header, checking the command
+// Returns: The status, and the payload length in length
+static uint8_t host_response(uint8_t cmd, uint32_t* length) {
+	const uint8_t* header = tx + txPos;
+
+	*length = 0;
+	CHECK(txPos + HEADER_SIZE <= txLength);
+	if (txPos + HEADER_SIZE > txLength) return 0xFF;
+	CHECK_EQUAL(header[0], XFER_SYNC);
+	CHECK_EQUAL(header[1], cmd);
+	memcpy(length, header + 3, 4);
+	txPos += HEADER_SIZE;
+	return header[2];
+}
+
+// Parses a trailer frame
+// Returns: The status, and the bytes and ticks reported
+static uint8_t host_trailer(uint32_t* bytes, uint32_t* ticks) {
+	uint32_t length;
+	uint8_t status = host_response(XFER_CMD_DONE, &length);
+
+	CHECK_EQUAL(length, 8);
+	memcpy(bytes, tx + txPos, 4);
+	memcpy(ticks, tx + txPos + 4, 4);
+	txPos += 8;
+	return status;
+}
+
+// Fills count bytes of file contents (as tools/transfer.py bench)
+static void fill(uint32_t count, uint8_t seed) {
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		data[i] = i * 7 + (i >> 9) + seed;
+	}
+}
+
+// Writes a file to the disk image
+static void card_write(const char* name, uint32_t count) {
+	FIL f;
+	UINT bw;
+
+	CHECK_EQUAL(f_open(&f, name, FA_CREATE_ALWAYS | FA_WRITE), FR_OK);
+	CHECK_EQUAL(f_write(&f, data, count, &bw), FR_OK);
+	CHECK_EQUAL(bw, count);
+	CHECK_EQUAL(f_close(&f), FR_OK);
+}
+
+// Reads a file from the disk image into readBack
+// Returns: The file size
+static uint32_t card_read(const char* name) {
+	FIL f;
+	UINT br = 0;
+
+	CHECK_EQUAL(f_open(&f, name, FA_READ), FR_OK);
+	CHECK_EQUAL(f_read(&f, readBack, sizeof(readBack), &br), FR_OK);
+	f_close(&f);
+	return br;
+}
+
+// Uploads count bytes of data, of which the host sends only sent
+// Returns: The trailer status, and the bytes and ticks reported
+static uint8_t put(const char* name, uint32_t count, uint32_t sent, uint32_t* bytes, uint32_t* ticks) {
+	uint8_t payload[4 + 12];
+	uint32_t length, credited = 0;
+
+	memcpy(payload, &count, 4);
+	memcpy(payload + 4, name, strlen(name));
+	host_reset();
+	host_command(XFER_CMD_PUT, payload, 4 + strlen(name));
+	host_data(data, sent);
+	transfer_frame();
+
+	CHECK_EQUAL(host_response(XFER_CMD_PUT, &length), FR_OK);
+	CHECK_EQUAL(length, 0);
+	while (txPos < txLength && tx[txPos + 1] == XFER_CMD_CREDIT) {
+		CHECK_EQUAL(host_response(XFER_CMD_CREDIT, &length), XFER_OK);
+		CHECK(length > 0 && length <= BLOCK);
+		credited += length;
+	}
+	CHECK(credited <= count);
+	return host_trailer(bytes, ticks);
+}
+
+/************************************************************************/
+/* TESTS                                                                */
+/************************************************************************/
+
+static void test_list() {
+	uint32_t length;
+
+	// Empty card: only the end frame
+	host_reset();
+	host_command(XFER_CMD_LIST, "", 0);
+	transfer_frame();
+	CHECK_EQUAL(host_response(XFER_CMD_LIST, &length), FR_OK);
+	CHECK_EQUAL(length, 0);
+	CHECK_EQUAL(txPos, txLength);
+
+	fill(1000, 0);
+	card_write("A.WAV", 1000);
+	fill(3000, 1);
+	card_write("B.BIN", 3000);
+
+	host_reset();
+	host_command(XFER_CMD_LIST, "", 0);
+	transfer_frame();
+	CHECK_EQUAL(host_response(XFER_CMD_LIST, &length), FR_OK);
+	CHECK_EQUAL(length, 4 + 13);
+	CHECK_EQUAL(tx[txPos] | tx[txPos + 1] << 8, 1000);
+	CHECK(strcmp((char*)tx + txPos + 4, "A.WAV") == 0);
+	txPos += length;
+	CHECK_EQUAL(host_response(XFER_CMD_LIST, &length), FR_OK);
+	CHECK_EQUAL(length, 4 + 13);
+	CHECK_EQUAL(tx[txPos] | tx[txPos + 1] << 8, 3000);
+	CHECK(strcmp((char*)tx + txPos + 4, "B.BIN") == 0);
+	txPos += length;
+	CHECK_EQUAL(host_response(XFER_CMD_LIST, &length), FR_OK);
+	CHECK_EQUAL(length, 0);
+	CHECK_EQUAL(txPos, txLength);
+}
+
+static void test_get() {
+	uint32_t length, bytes, ticks, expected, i;
+
+	fill(5000, 2);
+	card_write("GET.BIN", 5000);
+
+	host_reset();
+	host_command(XFER_CMD_GET, "GET.BIN", 7);
+	transfer_frame();
+	CHECK_EQUAL(host_response(XFER_CMD_GET, &length), FR_OK);
+	CHECK_EQUAL(length, 5000);
+	CHECK(memcmp(tx + txPos, data, 5000) == 0);
+	txPos += 5000;
+	CHECK_EQUAL(host_trailer(&bytes, &ticks), XFER_OK);
+	CHECK_EQUAL(bytes, 5000);
+	CHECK_EQUAL(txPos, txLength);
+
+	// Header, then the file a block at a time
+	expected = WRITE_TICKS(HEADER_SIZE);
+	for (i = 0; i < 5000; i += BLOCK) {
+		expected += WRITE_TICKS(5000 - i < BLOCK ? 5000 - i : BLOCK);
+	}
+	CHECK_EQUAL(ticks, expected);
+
+	// Missing file: status only, no data or trailer
+	host_reset();
+	host_command(XFER_CMD_GET, "NONE.BIN", 8);
+	transfer_frame();
+	CHECK_EQUAL(host_response(XFER_CMD_GET, &length), FR_NO_FILE);
+	CHECK_EQUAL(length, 0);
+	CHECK_EQUAL(txPos, txLength);
+}
+
+static void test_put() {
+	uint32_t bytes, ticks, expected, want, i;
+
+	fill(2500, 3);
+	CHECK_EQUAL(put("PUT.BIN", 2500, 2500, &bytes, &ticks), XFER_OK);
+	CHECK_EQUAL(bytes, 2500);
+	CHECK_EQUAL(txPos, txLength);
+	CHECK_EQUAL(rxPos, rxLength);
+	CHECK_EQUAL(card_read("PUT.BIN"), 2500);
+	CHECK(memcmp(readBack, data, 2500) == 0);
+
+	// A credit frame, then a read per packet of the block
+	expected = 0;
+	for (i = 0; i < 2500; i += want) {
+		want = 2500 - i < BLOCK ? 2500 - i : BLOCK;
+		expected += WRITE_TICKS(HEADER_SIZE) + (want + PACKET_SIZE - 1) / PACKET_SIZE;
+	}
+	CHECK_EQUAL(ticks, expected);
+
+	// Host stops after the first block
+	fill(2500, 4);
+	CHECK_EQUAL(put("STOP.BIN", 2500, BLOCK, &bytes, &ticks), XFER_ERR_USB);
+	CHECK_EQUAL(bytes, BLOCK);
+	CHECK(ticks >= RX_TIMEOUT);
+	CHECK_EQUAL(txPos, txLength);
+	CHECK_EQUAL(card_read("STOP.BIN"), BLOCK);
+	CHECK(memcmp(readBack, data, BLOCK) == 0);
+}
+
+static void test_errors() {
+	uint32_t length, start;
+
+	host_reset();
+	host_command('X', "", 0);
+	transfer_frame();
+	CHECK_EQUAL(host_response('X', &length), XFER_ERR_CMD);
+	CHECK_EQUAL(txPos, txLength);
+
+	// Frame ends after the command byte
+	host_reset();
+	rx[rxLength++] = XFER_CMD_LIST;
+	rxGranted = rxLength;
+	start = now;
+	transfer_frame();
+	CHECK_EQUAL(host_response(XFER_SYNC, &length), XFER_ERR_FRAME);
+	CHECK(now - start >= TIMEOUT);
+	CHECK_EQUAL(txPos, txLength);
+
+	// PUT without a name
+	host_reset();
+	host_command(XFER_CMD_PUT, "\0\0\0\0", 4);
+	transfer_frame();
+	CHECK_EQUAL(host_response(XFER_SYNC, &length), XFER_ERR_FRAME);
+	CHECK_EQUAL(txPos, txLength);
+
+	host_reset();
+	host_command(XFER_CMD_LIST, "", 0);
+	transfer_busy();
+	CHECK_EQUAL(host_response(XFER_SYNC, &length), XFER_ERR_BUSY);
+	CHECK_EQUAL(rxPos, rxLength);
+	CHECK_EQUAL(txPos, txLength);
+}
+
+/************************************************************************/
+/* MAIN                                                                 */
+/************************************************************************/
+int main() {
+	if (hal_disk_attach("transfer.img", IMAGE_SECTORS) || hal_disk_format()) {
+		fprintf(stderr, "test_transfer: cannot create disk image\n");
+		return 1;
+	}
+	wave_init();
+
+	test_list();
+	test_get();
+	test_put();
+	test_errors();
+
+	hal_disk_detach();
+	CHECK_EQUAL(hal_log_count(), 0);
+
+	return CHECK_STATUS();
+}
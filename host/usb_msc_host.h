@@ -0,0 +1,23 @@
+/**
+ * usb_msc_host.h - EGB240DVR host build, USB module compatibility
+ *
+ * Included ahead of lib/usb_msc/usb_msc.c in the host build. The
+ * string descriptors are int16_t arrays initialised from wide strings,
+ * which match the 16 bit signed wchar_t of the target. The host build
+ * uses -fshort-wchar, whose wchar_t is 16 bits but unsigned, so
+ * int16_t is mapped onto it for this module only.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef USB_MSC_HOST_H_
+#define USB_MSC_HOST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define int16_t wchar_t
+
+#endif /* USB_MSC_HOST_H_ */
@@ -11,7 +11,9 @@
 #include <windows.h>
 #include <tchar.h>
 
-#else			/* Embedded platform */
+#else			/* Embedded platform (and the host build, see host/) */
+
+#include <stdint.h>
 
 /* This type MUST be 8 bit */
 typedef unsigned char	BYTE;
@@ -26,8 +28,8 @@ typedef int				INT;
 typedef unsigned int	UINT;
 
 /* These types MUST be 32 bit */
-typedef long			LONG;
-typedef unsigned long	DWORD;
+typedef int32_t			LONG;
+typedef uint32_t		DWORD;
 
 #endif
 
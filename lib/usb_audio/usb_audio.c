@@ -0,0 +1,628 @@
+/* USB Audio Class Microphone for Teensy USB Development Board
+ * Based on the USB Serial Example, http://www.pjrc.com/teensy/usb_serial.html
+ * Copyright (c) 2008,2010,2011 PJRC.COM, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Version 1.0: Audio Class 1.0 microphone, isochronous IN fed from the
+//              capture ring with rate matching on the 1 ms frame
+// Version 1.1: endpoint 0 requests serviced with interrupts enabled
+
+#ifdef USB_AUDIO_MODE
+
+#define USB_SERIAL_PRIVATE_INCLUDE
+#include "../usb_serial/usb_serial.h"
+#include "usb_audio.h"
+#include "../../profile.h"
+
+
+/**************************************************************************
+ *
+ *  Configurable Options
+ *
+ **************************************************************************/
+
+#define STR_MANUFACTURER	L"Group 420"
+#define STR_PRODUCT		L"EGB240 Microphone"
+#define STR_SERIAL_NUMBER	L"12345"
+
+#define VENDOR_ID		0x16C0
+#define PRODUCT_ID		0x047C
+
+// Rate matching.  The Timer0 sample clock and the host's 1 ms frame
+// clock are independent, so the number of samples sent per frame
+// follows the nominal rate (15.625 samples/frame = 15 + 5/8) and is
+// trimmed by one whenever the capture ring fill level strays outside
+// the window around the target.  The target sets the latency.
+#define AUDIO_TARGET_LEVEL	128	/* samples, ~8 ms */
+#define AUDIO_LEVEL_WINDOW	32	/* samples */
+#define AUDIO_BASE_SAMPLES	15	/* whole samples per frame */
+#define AUDIO_FRAC_NUM		5	/* fractional samples per frame ... */
+#define AUDIO_FRAC_DEN		8	/* ... = 5/8 */
+
+
+/**************************************************************************
+ *
+ *  Endpoint Buffer Configuration
+ *
+ **************************************************************************/
+
+#define ENDPOINT0_SIZE		16
+#define AUDIO_TX_ENDPOINT	1
+#define AUDIO_TX_PACKET		(AUDIO_BASE_SAMPLES + 2)	/* largest packet */
+#define AUDIO_TX_SIZE		32
+#define AUDIO_TX_BUFFER		EP_DOUBLE_BUFFER
+
+static const uint8_t PROGMEM endpoint_config_table[] = {
+	1, EP_TYPE_ISOCHRONOUS_IN, EP_SIZE(AUDIO_TX_SIZE) | AUDIO_TX_BUFFER,
+	0,
+	0,
+	0
+};
+
+
+/**************************************************************************
+ *
+ *  Descriptor Data
+ *
+ **************************************************************************/
+
+static const uint8_t PROGMEM device_descriptor[] = {
+	18,					// bLength
+	1,					// bDescriptorType
+	0x00, 0x02,				// bcdUSB
+	0,					// bDeviceClass (defined by interface)
+	0,					// bDeviceSubClass
+	0,					// bDeviceProtocol
+	ENDPOINT0_SIZE,				// bMaxPacketSize0
+	LSB(VENDOR_ID), MSB(VENDOR_ID),		// idVendor
+	LSB(PRODUCT_ID), MSB(PRODUCT_ID),	// idProduct
+	0x00, 0x01,				// bcdDevice
+	1,					// iManufacturer
+	2,					// iProduct
+	3,					// iSerialNumber
+	1					// bNumConfigurations
+};
+
+#define AC_DESC_SIZE (9+12+9)
+#define CONFIG1_DESC_SIZE (9+9+AC_DESC_SIZE+9+9+7+11+9+7)
+static const uint8_t PROGMEM config1_descriptor[CONFIG1_DESC_SIZE] = {
+	// configuration descriptor, USB spec 9.6.3, page 264-266, Table 9-10
+	9, 					// bLength;
+	2,					// bDescriptorType;
+	LSB(CONFIG1_DESC_SIZE),			// wTotalLength
+	MSB(CONFIG1_DESC_SIZE),
+	2,					// bNumInterfaces
+	1,					// bConfigurationValue
+	0,					// iConfiguration
+	0x80,					// bmAttributes
+	50,					// bMaxPower
+	// interface descriptor, Audio spec 4.3.1, Table 4-1 (AudioControl)
+	9,					// bLength
+	4,					// bDescriptorType
+	0,					// bInterfaceNumber
+	0,					// bAlternateSetting
+	0,					// bNumEndpoints
+	0x01,					// bInterfaceClass (Audio)
+	0x01,					// bInterfaceSubClass (AudioControl)
+	0x00,					// bInterfaceProtocol
+	0,					// iInterface
+	// class-specific AC interface header, Audio spec 4.3.2, Table 4-2
+	9,					// bLength
+	0x24,					// bDescriptorType (CS_INTERFACE)
+	0x01,					// bDescriptorSubtype (HEADER)
+	0x00, 0x01,				// bcdADC
+	LSB(AC_DESC_SIZE), MSB(AC_DESC_SIZE),	// wTotalLength
+	1,					// bInCollection
+	1,					// baInterfaceNr(1)
+	// input terminal, Audio spec 4.3.2.1, Table 4-3
+	12,					// bLength
+	0x24,					// bDescriptorType (CS_INTERFACE)
+	0x02,					// bDescriptorSubtype (INPUT_TERMINAL)
+	1,					// bTerminalID
+	0x01, 0x02,				// wTerminalType (microphone)
+	0,					// bAssocTerminal
+	1,					// bNrChannels
+	0x00, 0x00,				// wChannelConfig (mono)
+	0,					// iChannelNames
+	0,					// iTerminal
+	// output terminal, Audio spec 4.3.2.2, Table 4-4
+	9,					// bLength
+	0x24,					// bDescriptorType (CS_INTERFACE)
+	0x03,					// bDescriptorSubtype (OUTPUT_TERMINAL)
+	2,					// bTerminalID
+	0x01, 0x01,				// wTerminalType (USB streaming)
+	0,					// bAssocTerminal
+	1,					// bSourceID
+	0,					// iTerminal
+	// interface descriptor, Audio spec 4.5.1, Table 4-18 (zero bandwidth)
+	9,					// bLength
+	4,					// bDescriptorType
+	1,					// bInterfaceNumber
+	0,					// bAlternateSetting
+	0,					// bNumEndpoints
+	0x01,					// bInterfaceClass (Audio)
+	0x02,					// bInterfaceSubClass (AudioStreaming)
+	0x00,					// bInterfaceProtocol
+	0,					// iInterface
+	// interface descriptor, Audio spec 4.5.1, Table 4-19 (streaming)
+	9,					// bLength
+	4,					// bDescriptorType
+	1,					// bInterfaceNumber
+	1,					// bAlternateSetting
+	1,					// bNumEndpoints
+	0x01,					// bInterfaceClass (Audio)
+	0x02,					// bInterfaceSubClass (AudioStreaming)
+	0x00,					// bInterfaceProtocol
+	0,					// iInterface
+	// class-specific AS general, Audio spec 4.5.2, Table 4-20
+	7,					// bLength
+	0x24,					// bDescriptorType (CS_INTERFACE)
+	0x01,					// bDescriptorSubtype (AS_GENERAL)
+	2,					// bTerminalLink
+	1,					// bDelay
+	0x02, 0x00,				// wFormatTag (PCM8, unsigned)
+	// type I format, Audio Formats spec 2.2.5, Table 2-1
+	11,					// bLength
+	0x24,					// bDescriptorType (CS_INTERFACE)
+	0x02,					// bDescriptorSubtype (FORMAT_TYPE)
+	0x01,					// bFormatType (TYPE_I)
+	1,					// bNrChannels
+	1,					// bSubframeSize
+	8,					// bBitResolution
+	1,					// bSamFreqType (one discrete rate)
+	LSB(USB_AUDIO_SAMPLE_RATE),		// tSamFreq
+	MSB(USB_AUDIO_SAMPLE_RATE),
+	0,
+	// endpoint descriptor, Audio spec 4.6.1.1, Table 4-20
+	9,					// bLength
+	5,					// bDescriptorType
+	AUDIO_TX_ENDPOINT | 0x80,		// bEndpointAddress
+	0x05,					// bmAttributes (isochronous, asynchronous)
+	AUDIO_TX_PACKET, 0,			// wMaxPacketSize
+	1,					// bInterval (1 ms)
+	0,					// bRefresh
+	0,					// bSynchAddress
+	// class-specific iso endpoint, Audio spec 4.6.1.2, Table 4-21
+	7,					// bLength
+	0x25,					// bDescriptorType (CS_ENDPOINT)
+	0x01,					// bDescriptorSubtype (EP_GENERAL)
+	0x00,					// bmAttributes (no controls)
+	0,					// bLockDelayUnits
+	0, 0					// wLockDelay
+};
+
+struct usb_string_descriptor_struct {
+	uint8_t bLength;
+	uint8_t bDescriptorType;
+	int16_t wString[];
+};
+static const struct usb_string_descriptor_struct PROGMEM string0 = {
+	4,
+	3,
+	{0x0409}
+};
+static const struct usb_string_descriptor_struct PROGMEM string1 = {
+	sizeof(STR_MANUFACTURER),
+	3,
+	STR_MANUFACTURER
+};
+static const struct usb_string_descriptor_struct PROGMEM string2 = {
+	sizeof(STR_PRODUCT),
+	3,
+	STR_PRODUCT
+};
+static const struct usb_string_descriptor_struct PROGMEM string3 = {
+	sizeof(STR_SERIAL_NUMBER),
+	3,
+	STR_SERIAL_NUMBER
+};
+
+static const struct descriptor_list_struct {
+	uint16_t	wValue;
+	uint16_t	wIndex;
+	const uint8_t	*addr;
+	uint8_t		length;
+} PROGMEM descriptor_list[] = {
+	{0x0100, 0x0000, device_descriptor, sizeof(device_descriptor)},
+	{0x0200, 0x0000, config1_descriptor, sizeof(config1_descriptor)},
+	{0x0300, 0x0000, (const uint8_t *)&string0, 4},
+	{0x0301, 0x0409, (const uint8_t *)&string1, sizeof(STR_MANUFACTURER)},
+	{0x0302, 0x0409, (const uint8_t *)&string2, sizeof(STR_PRODUCT)},
+	{0x0303, 0x0409, (const uint8_t *)&string3, sizeof(STR_SERIAL_NUMBER)}
+};
+#define NUM_DESC_LIST (sizeof(descriptor_list)/sizeof(struct descriptor_list_struct))
+
+// audio class specific requests
+#define AUDIO_SET_CUR		0x01
+#define AUDIO_GET_CUR		0x81
+
+
+/**************************************************************************
+ *
+ *  Variables - these are the only non-stack RAM usage
+ *
+ **************************************************************************/
+
+// zero when we are not configured, non-zero when enumerated
+static volatile uint8_t usb_configuration=0;
+
+// alternate setting of the streaming interface (1 = streaming)
+static volatile uint8_t stream_alt=0;
+
+// set once the capture ring has filled to the target level
+static uint8_t stream_primed=0;
+
+// accumulated fractional samples per frame
+static uint8_t stream_frac=0;
+
+static volatile uint16_t stream_underruns=0;
+
+// sample source
+static uint16_t (*source_available)(void);
+static uint8_t (*source_read)(void);
+
+
+/**************************************************************************
+ *
+ *  Public Functions - these are the API intended for the user
+ *
+ **************************************************************************/
+
+// initialize USB audio
+void usb_audio_init(void)
+{
+	HW_CONFIG();
+        USB_FREEZE();				// enable USB
+        PLL_CONFIG();				// config PLL, 16 MHz xtal
+        while (!(PLLCSR & (1<<PLOCK))) ;	// wait for PLL lock
+        USB_CONFIG();				// start USB clock
+        UDCON = 0;				// enable attach resistor
+	usb_configuration = 0;
+	stream_alt = 0;
+        UDIEN = (1<<EORSTE)|(1<<SOFE);
+	sei();
+}
+
+// return 0 if the USB is not configured, or the configuration
+// number selected by the HOST
+uint8_t usb_audio_configured(void)
+{
+	return usb_configuration;
+}
+
+void usb_audio_source(uint16_t (*available)(void), uint8_t (*read)(void))
+{
+	uint8_t intr_state;
+
+	intr_state = SREG;
+	cli();
+	source_available = available;
+	source_read = read;
+	stream_primed = 0;
+	SREG = intr_state;
+}
+
+uint8_t usb_audio_streaming(void)
+{
+	return usb_configuration && stream_alt;
+}
+
+uint16_t usb_audio_underruns(void)
+{
+	uint16_t n;
+	uint8_t intr_state;
+
+	intr_state = SREG;
+	cli();
+	n = stream_underruns;
+	SREG = intr_state;
+	return n;
+}
+
+
+
+/**************************************************************************
+ *
+ *  Private Functions - not intended for general user consumption....
+ *
+ **************************************************************************/
+
+// fill one isochronous IN packet from the sample source
+static inline void usb_audio_frame(void)
+{
+	uint16_t level;
+	uint8_t n;
+
+	UENUM = AUDIO_TX_ENDPOINT;
+	if (!(UEINTX & (1<<RWAL))) return;	// both banks still queued
+
+	// nominal samples for this frame
+	n = AUDIO_BASE_SAMPLES;
+	stream_frac += AUDIO_FRAC_NUM;
+	if (stream_frac >= AUDIO_FRAC_DEN) {
+		stream_frac -= AUDIO_FRAC_DEN;
+		n++;
+	}
+
+	// rate matching on the capture ring fill level
+	level = source_available ? source_available() : 0;
+	if (!stream_primed) {
+		// hold off (send empty packets) until latency target reached
+		if (level >= AUDIO_TARGET_LEVEL) stream_primed = 1;
+		n = 0;
+	} else if (level > AUDIO_TARGET_LEVEL + AUDIO_LEVEL_WINDOW) {
+		n++;
+	} else if (level < AUDIO_TARGET_LEVEL - AUDIO_LEVEL_WINDOW) {
+		n--;
+	}
+	if (n > level) {
+		stream_underruns++;
+		n = level;
+		stream_primed = 0;
+	}
+
+	while (n--) {
+		UEDATX = source_read();
+	}
+	UEINTX = 0x3A;	// release the bank, sent on the next IN token
+}
+
+// USB Device Interrupt - handle all device-level events
+// the isochronous packets are filled on the start of frame
+//
+ISR(USB_GEN_vect)
+{
+	uint8_t intbits;
+	PROFILE_ENTER();
+
+        intbits = UDINT;
+        UDINT = 0;
+        if (intbits & (1<<EORSTI)) {
+		UENUM = 0;
+		UECONX = 1;
+		UECFG0X = EP_TYPE_CONTROL;
+		UECFG1X = EP_SIZE(ENDPOINT0_SIZE) | EP_SINGLE_BUFFER;
+		UEIENX = (1<<RXSTPE);
+		usb_configuration = 0;
+		stream_alt = 0;
+        }
+	if (intbits & (1<<SOFI)) {
+		if (usb_configuration && stream_alt) {
+			usb_audio_frame();
+		}
+	}
+	PROFILE_EXIT(PROFILE_USB_GEN);
+}
+
+
+// Misc functions to wait for ready and send/receive packets
+static inline void usb_wait_in_ready(void)
+{
+	while (!(UEINTX & (1<<TXINI))) ;
+}
+static inline void usb_send_in(void)
+{
+	UEINTX = ~(1<<TXINI);
+}
+static inline void usb_wait_receive_out(void)
+{
+	while (!(UEINTX & (1<<RXOUTI))) ;
+}
+static inline void usb_ack_out(void)
+{
+	UEINTX = ~(1<<RXOUTI);
+}
+
+
+
+// Endpoint 0 request handler, called from the endpoint interrupt
+// with interrupts enabled.  The isochronous endpoint is serviced by
+// the start of frame interrupt.
+static void usb_control(void)
+{
+        uint8_t intbits;
+	const uint8_t *list;
+        const uint8_t *cfg;
+	uint8_t i, n, len, en;
+	uint8_t bmRequestType;
+	uint8_t bRequest;
+	uint16_t wValue;
+	uint16_t wIndex;
+	uint16_t wLength;
+	uint16_t desc_val;
+	const uint8_t *desc_addr;
+	uint8_t	desc_length;
+
+        UENUM = 0;
+        intbits = UEINTX;
+        if (intbits & (1<<RXSTPI)) {
+                bmRequestType = UEDATX;
+                bRequest = UEDATX;
+                wValue = UEDATX;
+                wValue |= (UEDATX << 8);
+                wIndex = UEDATX;
+                wIndex |= (UEDATX << 8);
+                wLength = UEDATX;
+                wLength |= (UEDATX << 8);
+                UEINTX = ~((1<<RXSTPI) | (1<<RXOUTI) | (1<<TXINI));
+                if (bRequest == GET_DESCRIPTOR) {
+			list = (const uint8_t *)descriptor_list;
+			for (i=0; ; i++) {
+				if (i >= NUM_DESC_LIST) {
+					UECONX = (1<<STALLRQ)|(1<<EPEN);  //stall
+					return;
+				}
+				desc_val = pgm_read_word(list);
+				if (desc_val != wValue) {
+					list += sizeof(struct descriptor_list_struct);
+					continue;
+				}
+				list += 2;
+				desc_val = pgm_read_word(list);
+				if (desc_val != wIndex) {
+					list += sizeof(struct descriptor_list_struct)-2;
+					continue;
+				}
+				list += 2;
+				desc_addr = (const uint8_t *)pgm_read_word(list);
+				list += 2;
+				desc_length = pgm_read_byte(list);
+				break;
+			}
+			len = (wLength < 256) ? wLength : 255;
+			if (len > desc_length) len = desc_length;
+			do {
+				// wait for host ready for IN packet
+				do {
+					i = UEINTX;
+				} while (!(i & ((1<<TXINI)|(1<<RXOUTI))));
+				if (i & (1<<RXOUTI)) return;	// abort
+				// send IN packet
+				n = len < ENDPOINT0_SIZE ? len : ENDPOINT0_SIZE;
+				for (i = n; i; i--) {
+					UEDATX = pgm_read_byte(desc_addr++);
+				}
+				len -= n;
+				usb_send_in();
+			} while (len || n == ENDPOINT0_SIZE);
+			return;
+                }
+		if (bRequest == SET_ADDRESS) {
+			usb_send_in();
+			usb_wait_in_ready();
+			UDADDR = wValue | (1<<ADDEN);
+			return;
+		}
+		if (bRequest == SET_CONFIGURATION && bmRequestType == 0) {
+			usb_configuration = wValue;
+			stream_alt = 0;
+			usb_send_in();
+			cfg = endpoint_config_table;
+			for (i=1; i<5; i++) {
+				UENUM = i;
+				en = pgm_read_byte(cfg++);
+				UECONX = en;
+				if (en) {
+					UECFG0X = pgm_read_byte(cfg++);
+					UECFG1X = pgm_read_byte(cfg++);
+				}
+			}
+        		UERST = 0x1E;
+        		UERST = 0;
+			return;
+		}
+		if (bRequest == GET_CONFIGURATION && bmRequestType == 0x80) {
+			usb_wait_in_ready();
+			UEDATX = usb_configuration;
+			usb_send_in();
+			return;
+		}
+		if (bRequest == SET_INTERFACE && bmRequestType == 0x01) {
+			if (wIndex == 1) {
+				stream_alt = wValue;
+				stream_primed = 0;
+				UENUM = AUDIO_TX_ENDPOINT;
+				UERST = (1<<AUDIO_TX_ENDPOINT);	// discard stale packets
+				UERST = 0;
+				UENUM = 0;
+			}
+			usb_send_in();
+			return;
+		}
+		if (bRequest == GET_INTERFACE && bmRequestType == 0x81) {
+			usb_wait_in_ready();
+			UEDATX = (wIndex == 1) ? stream_alt : 0;
+			usb_send_in();
+			return;
+		}
+		if (bRequest == AUDIO_SET_CUR && bmRequestType == 0x22) {
+			// sampling frequency is fixed, accept and ignore
+			usb_wait_receive_out();
+			usb_ack_out();
+			usb_send_in();
+			return;
+		}
+		if (bRequest == AUDIO_GET_CUR && bmRequestType == 0xA2) {
+			usb_wait_in_ready();
+			UEDATX = LSB(USB_AUDIO_SAMPLE_RATE);
+			UEDATX = MSB(USB_AUDIO_SAMPLE_RATE);
+			UEDATX = 0;
+			usb_send_in();
+			return;
+		}
+		if (bRequest == GET_STATUS) {
+			usb_wait_in_ready();
+			i = 0;
+			if (bmRequestType == 0x82) {
+				UENUM = wIndex;
+				if (UECONX & (1<<STALLRQ)) i = 1;
+				UENUM = 0;
+			}
+			UEDATX = i;
+			UEDATX = 0;
+			usb_send_in();
+			return;
+		}
+		if ((bRequest == CLEAR_FEATURE || bRequest == SET_FEATURE)
+		  && bmRequestType == 0x02 && wValue == 0) {
+			i = wIndex & 0x7F;
+			if (i >= 1 && i <= MAX_ENDPOINT) {
+				usb_send_in();
+				UENUM = i;
+				if (bRequest == SET_FEATURE) {
+					UECONX = (1<<STALLRQ)|(1<<EPEN);
+				} else {
+					UECONX = (1<<STALLRQC)|(1<<RSTDT)|(1<<EPEN);
+					UERST = (1 << i);
+					UERST = 0;
+				}
+				return;
+			}
+		}
+        }
+	UECONX = (1<<STALLRQ) | (1<<EPEN);	// stall
+}
+
+
+// USB Endpoint Interrupt - the USB interrupt sources are masked and
+// interrupts re-enabled while the endpoint 0 request is serviced, so
+// the ADC and PWM interrupts are not held off by enumeration (see
+// usb_serial.c, version 1.9).
+//
+ISR(USB_COM_vect)
+{
+	uint8_t udien;
+	PROFILE_ENTER();
+
+	UENUM = 0;
+	UEIENX = 0;			// mask endpoint 0 setup interrupt
+	udien = UDIEN;
+	UDIEN = 0;			// mask device interrupts (bus reset, start of frame)
+	sei();
+	usb_control();
+	cli();
+	UENUM = 0;
+	UEIENX = (1<<RXSTPE);
+	UDIEN = udien;
+	PROFILE_EXIT(PROFILE_USB_COM);
+}
+
+#endif // USB_AUDIO_MODE
@@ -0,0 +1,31 @@
+#ifndef usb_audio_h__
+#define usb_audio_h__
+
+#include <stdint.h>
+
+// USB Audio Class 1.0 microphone (one 8-bit channel, isochronous IN)
+// alternative to usb_serial.  Only one USB personality can be linked
+// into the firmware: define USB_AUDIO_MODE for the whole project to
+// build this module instead of usb_serial.
+
+// nominal sample rate reported to the host (Timer0 sample clock)
+#define USB_AUDIO_SAMPLE_RATE	15625
+
+// setup
+void usb_audio_init(void);		// initialize everything
+uint8_t usb_audio_configured(void);	// is the USB port configured
+
+// sample source, called from the start of frame interrupt to fill
+// each 1 ms isochronous packet.  available returns the number of
+// samples waiting, read removes and returns the oldest one.
+void usb_audio_source(uint16_t (*available)(void), uint8_t (*read)(void));
+
+// non-zero while the host has the streaming interface active
+// (i.e. an application is capturing from the microphone)
+uint8_t usb_audio_streaming(void);
+
+// number of frames in which fewer samples were waiting than the
+// rate matching asked for (capture ring underrun)
+uint16_t usb_audio_underruns(void);
+
+#endif
@@ -0,0 +1,885 @@
+/* USB Mass Storage for Teensy USB Development Board
+ * Based on the USB Serial Example, http://www.pjrc.com/teensy/usb_serial.html
+ * Copyright (c) 2008,2010,2011 PJRC.COM, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Version 1.0: Bulk-Only Mass Storage with SCSI READ(10)/WRITE(10)
+//              mapped onto disk_read/disk_write multi-block transfers
+// Version 1.1: endpoint 0 requests serviced with interrupts enabled and bulk
+//              FIFO copies limited to FIFO_CHUNK bytes per critical section
+// Version 1.2: data stage in the wrong direction reported as ILLEGAL REQUEST
+// Version 1.3: bytes and Timer0 ticks of READ(10)/WRITE(10) counted and
+//              reported by a vendor specific STATISTICS command (0xC0)
+
+#ifdef USB_MSC_MODE
+
+#define USB_SERIAL_PRIVATE_INCLUDE
+#include "../usb_serial/usb_serial.h"
+#include "../fatfs/diskio.h"
+#include "usb_msc.h"
+#include "../../profile.h"
+#include "../../timer.h"
+
+
+/**************************************************************************
+ *
+ *  Configurable Options
+ *
+ **************************************************************************/
+
+#define STR_MANUFACTURER	L"Group 420"
+#define STR_PRODUCT		L"EGB240 Recorder"
+#define STR_SERIAL_NUMBER	L"12345"
+
+#define VENDOR_ID		0x16C0
+#define PRODUCT_ID		0x0478
+
+// If the host stops servicing the bulk endpoints for this long, the
+// current command is abandoned.
+#define MSC_TIMEOUT		250   /* in milliseconds */
+
+// Bytes copied to or from a bulk FIFO per critical section, so the
+// audio interrupts are held off for at most a few microseconds
+#define FIFO_CHUNK		16
+
+// Sectors per disk_read/disk_write call (limited by the scratch block)
+#define MSC_BLOCK_SECTORS	2
+
+
+/**************************************************************************
+ *
+ *  Endpoint Buffer Configuration
+ *
+ **************************************************************************/
+
+#define ENDPOINT0_SIZE		16
+#define MSC_TX_ENDPOINT		1
+#define MSC_RX_ENDPOINT		2
+#define MSC_TX_SIZE		64
+#define MSC_TX_BUFFER		EP_DOUBLE_BUFFER
+#define MSC_RX_SIZE		64
+#define MSC_RX_BUFFER		EP_DOUBLE_BUFFER
+
+static const uint8_t PROGMEM endpoint_config_table[] = {
+	1, EP_TYPE_BULK_IN,       EP_SIZE(MSC_TX_SIZE) | MSC_TX_BUFFER,
+	1, EP_TYPE_BULK_OUT,      EP_SIZE(MSC_RX_SIZE) | MSC_RX_BUFFER,
+	0,
+	0
+};
+
+
+/**************************************************************************
+ *
+ *  Descriptor Data
+ *
+ **************************************************************************/
+
+static const uint8_t PROGMEM device_descriptor[] = {
+	18,					// bLength
+	1,					// bDescriptorType
+	0x00, 0x02,				// bcdUSB
+	0,					// bDeviceClass (defined by interface)
+	0,					// bDeviceSubClass
+	0,					// bDeviceProtocol
+	ENDPOINT0_SIZE,				// bMaxPacketSize0
+	LSB(VENDOR_ID), MSB(VENDOR_ID),		// idVendor
+	LSB(PRODUCT_ID), MSB(PRODUCT_ID),	// idProduct
+	0x00, 0x01,				// bcdDevice
+	1,					// iManufacturer
+	2,					// iProduct
+	3,					// iSerialNumber
+	1					// bNumConfigurations
+};
+
+#define CONFIG1_DESC_SIZE (9+9+7+7)
+static const uint8_t PROGMEM config1_descriptor[CONFIG1_DESC_SIZE] = {
+	// configuration descriptor, USB spec 9.6.3, page 264-266, Table 9-10
+	9, 					// bLength;
+	2,					// bDescriptorType;
+	LSB(CONFIG1_DESC_SIZE),			// wTotalLength
+	MSB(CONFIG1_DESC_SIZE),
+	1,					// bNumInterfaces
+	1,					// bConfigurationValue
+	0,					// iConfiguration
+	0xC0,					// bmAttributes
+	50,					// bMaxPower
+	// interface descriptor, USB spec 9.6.5, page 267-269, Table 9-12
+	9,					// bLength
+	4,					// bDescriptorType
+	0,					// bInterfaceNumber
+	0,					// bAlternateSetting
+	2,					// bNumEndpoints
+	0x08,					// bInterfaceClass (Mass Storage)
+	0x06,					// bInterfaceSubClass (SCSI transparent)
+	0x50,					// bInterfaceProtocol (Bulk-Only)
+	0,					// iInterface
+	// endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+	7,					// bLength
+	5,					// bDescriptorType
+	MSC_TX_ENDPOINT | 0x80,			// bEndpointAddress
+	0x02,					// bmAttributes (0x02=bulk)
+	MSC_TX_SIZE, 0,				// wMaxPacketSize
+	0,					// bInterval
+	// endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+	7,					// bLength
+	5,					// bDescriptorType
+	MSC_RX_ENDPOINT,			// bEndpointAddress
+	0x02,					// bmAttributes (0x02=bulk)
+	MSC_RX_SIZE, 0,				// wMaxPacketSize
+	0					// bInterval
+};
+
+struct usb_string_descriptor_struct {
+	uint8_t bLength;
+	uint8_t bDescriptorType;
+	int16_t wString[];
+};
+static const struct usb_string_descriptor_struct PROGMEM string0 = {
+	4,
+	3,
+	{0x0409}
+};
+static const struct usb_string_descriptor_struct PROGMEM string1 = {
+	sizeof(STR_MANUFACTURER),
+	3,
+	STR_MANUFACTURER
+};
+static const struct usb_string_descriptor_struct PROGMEM string2 = {
+	sizeof(STR_PRODUCT),
+	3,
+	STR_PRODUCT
+};
+static const struct usb_string_descriptor_struct PROGMEM string3 = {
+	sizeof(STR_SERIAL_NUMBER),
+	3,
+	STR_SERIAL_NUMBER
+};
+
+static const struct descriptor_list_struct {
+	uint16_t	wValue;
+	uint16_t	wIndex;
+	const uint8_t	*addr;
+	uint8_t		length;
+} PROGMEM descriptor_list[] = {
+	{0x0100, 0x0000, device_descriptor, sizeof(device_descriptor)},
+	{0x0200, 0x0000, config1_descriptor, sizeof(config1_descriptor)},
+	{0x0300, 0x0000, (const uint8_t *)&string0, 4},
+	{0x0301, 0x0409, (const uint8_t *)&string1, sizeof(STR_MANUFACTURER)},
+	{0x0302, 0x0409, (const uint8_t *)&string2, sizeof(STR_PRODUCT)},
+	{0x0303, 0x0409, (const uint8_t *)&string3, sizeof(STR_SERIAL_NUMBER)}
+};
+#define NUM_DESC_LIST (sizeof(descriptor_list)/sizeof(struct descriptor_list_struct))
+
+// SCSI INQUIRY response (36 bytes, SPC-2)
+static const uint8_t PROGMEM inquiry_data[36] = {
+	0x00,					// direct access block device
+	0x80,					// removable medium
+	0x04,					// SPC-2
+	0x02,					// response data format
+	31,					// additional length
+	0, 0, 0,
+	'E','G','B','2','4','0',' ',' ',	// vendor (8)
+	'R','e','c','o','r','d','e','r',	// product (16)
+	' ',' ',' ',' ',' ',' ',' ',' ',
+	'1','.','0','0'				// revision (4)
+};
+
+
+/**************************************************************************
+ *
+ *  Bulk-Only Transport / SCSI definitions
+ *
+ **************************************************************************/
+
+#define CBW_SIGNATURE		0x43425355
+#define CSW_SIGNATURE		0x53425355
+#define CBW_SIZE		31
+#define CSW_SIZE		13	// without the padding of struct csw_struct
+#define CBW_DIR_IN		0x80
+
+// class specific control requests
+#define MSC_GET_MAX_LUN		0xFE
+#define MSC_BULK_ONLY_RESET	0xFF
+
+// SCSI operation codes
+#define SCSI_TEST_UNIT_READY	0x00
+#define SCSI_REQUEST_SENSE	0x03
+#define SCSI_INQUIRY		0x12
+#define SCSI_MODE_SENSE_6	0x1A
+#define SCSI_START_STOP_UNIT	0x1B
+#define SCSI_PREVENT_ALLOW	0x1E
+#define SCSI_READ_FORMAT_CAP	0x23
+#define SCSI_READ_CAPACITY_10	0x25
+#define SCSI_READ_10		0x28
+#define SCSI_WRITE_10		0x2A
+#define SCSI_VERIFY_10		0x2F
+#define SCSI_STATISTICS		0xC0	// vendor specific, see scsi_statistics
+
+// SCSI sense keys and additional sense codes
+#define SENSE_NONE		0x00
+#define SENSE_NOT_READY		0x02
+#define SENSE_MEDIUM_ERROR	0x03
+#define SENSE_ILLEGAL_REQUEST	0x05
+#define SENSE_UNIT_ATTENTION	0x06
+#define ASC_WRITE_FAULT		0x03
+#define ASC_READ_ERROR		0x11
+#define ASC_INVALID_COMMAND	0x20
+#define ASC_LBA_OUT_OF_RANGE	0x21
+#define ASC_MEDIUM_CHANGED	0x28
+#define ASC_MEDIUM_NOT_PRESENT	0x3A
+
+struct cbw_struct {
+	uint32_t	dSignature;
+	uint32_t	dTag;
+	uint32_t	dDataTransferLength;
+	uint8_t		bmFlags;
+	uint8_t		bLUN;
+	uint8_t		bCBLength;
+	uint8_t		CB[16];
+};
+
+struct csw_struct {
+	uint32_t	dSignature;
+	uint32_t	dTag;
+	uint32_t	dDataResidue;
+	uint8_t		bStatus;
+};
+
+
+/**************************************************************************
+ *
+ *  Variables - these are the only non-stack RAM usage
+ *
+ **************************************************************************/
+
+// zero when we are not configured, non-zero when enumerated
+static volatile uint8_t usb_configuration=0;
+
+// current command block wrapper and the data bytes left in its data stage
+static struct cbw_struct cbw;
+static uint32_t data_remaining;
+
+// sense data reported by the next REQUEST SENSE
+static uint8_t sense_key, sense_asc;
+
+// medium state seen by the host
+static uint8_t medium_ready=0;
+static uint8_t medium_attention=0;
+static uint8_t medium_written=0;
+
+// bytes moved and Timer0 ticks spent by READ(10) [0] and WRITE(10) [1]
+// since the last STATISTICS command
+static uint32_t transfer_bytes[2], transfer_ticks[2];
+
+
+/**************************************************************************
+ *
+ *  Bulk endpoint helpers - called from the main program only
+ *
+ **************************************************************************/
+
+// send data on the bulk IN endpoint, a packet at a time.  When src is
+// 0, zeros are sent instead (used to pad a short data stage).  Any
+// partially filled packet is left for the next call or msc_send_flush.
+//  0 returned on success, -1 on error
+static int8_t msc_send(const uint8_t *src, uint16_t size, uint8_t progmem)
+{
+	uint8_t timeout, intr_state, n;
+
+	while (size) {
+		timeout = UDFNUML + MSC_TIMEOUT;
+		while (1) {
+			if (!usb_configuration) return -1;
+			intr_state = SREG;
+			cli();
+			UENUM = MSC_TX_ENDPOINT;
+			if (UEINTX & (1<<RWAL)) break;
+			SREG = intr_state;
+			if (UDFNUML == timeout) return -1;
+		}
+		n = MSC_TX_SIZE - UEBCLX;
+		if (n > size) n = size;
+		if (n > FIFO_CHUNK) n = FIFO_CHUNK;	// keep critical section short
+		size -= n;
+		while (n--) {
+			if (!src) UEDATX = 0;
+			else if (progmem) UEDATX = pgm_read_byte(src++);
+			else UEDATX = *src++;
+		}
+		// if this completed a packet, transmit it now!
+		if (!(UEINTX & (1<<RWAL))) UEINTX = 0x3A;
+		SREG = intr_state;
+	}
+	return 0;
+}
+
+// release a partially filled IN packet (short packet ends the transfer)
+static void msc_send_flush(void)
+{
+	uint8_t intr_state;
+
+	intr_state = SREG;
+	cli();
+	UENUM = MSC_TX_ENDPOINT;
+	if (UEBCLX) UEINTX = 0x3A;
+	SREG = intr_state;
+}
+
+// receive data from the bulk OUT endpoint.  When dst is 0 the data
+// is discarded (used to drain an unwanted data stage).
+//  0 returned on success, -1 on error
+static int8_t msc_receive(uint8_t *dst, uint16_t size)
+{
+	uint8_t timeout, intr_state, c, n;
+
+	while (size) {
+		timeout = UDFNUML + MSC_TIMEOUT;
+		while (1) {
+			if (!usb_configuration) return -1;
+			intr_state = SREG;
+			cli();
+			UENUM = MSC_RX_ENDPOINT;
+			c = UEINTX;
+			if (c & (1<<RWAL)) break;
+			if (c & (1<<RXOUTI)) UEINTX = 0x6B;	// release empty bank
+			SREG = intr_state;
+			if (UDFNUML == timeout) return -1;
+		}
+		n = UEBCLX;
+		if (n > size) n = size;
+		if (n > FIFO_CHUNK) n = FIFO_CHUNK;	// keep critical section short
+		size -= n;
+		while (n--) {
+			c = UEDATX;
+			if (dst) *dst++ = c;
+		}
+		// if buffer completely used, release it
+		if (!(UEINTX & (1<<RWAL))) UEINTX = 0x6B;
+		SREG = intr_state;
+	}
+	return 0;
+}
+
+static uint8_t msc_fail(uint8_t key, uint8_t asc)
+{
+	sense_key = key;
+	sense_asc = asc;
+	return 1;	// CSW status: command failed
+}
+
+// data stage in (device to host), limited to the host's expectation.
+// A data stage in the other direction fails the command as an illegal
+// request, so the host sees why with REQUEST SENSE
+//  0 returned on success, -1 on error
+static int8_t msc_data_in(const uint8_t *src, uint16_t size, uint8_t progmem)
+{
+	if (!(cbw.bmFlags & CBW_DIR_IN)) {
+		msc_fail(SENSE_ILLEGAL_REQUEST, ASC_INVALID_COMMAND);
+		return -1;
+	}
+	if (size > data_remaining) size = data_remaining;
+	data_remaining -= size;
+	return msc_send(src, size, progmem);
+}
+
+// data stage out (host to device), limited to the host's expectation
+//  0 returned on success, -1 on error
+static int8_t msc_data_out(uint8_t *dst, uint16_t size)
+{
+	if ((cbw.bmFlags & CBW_DIR_IN) || size > data_remaining) {
+		msc_fail(SENSE_ILLEGAL_REQUEST, ASC_INVALID_COMMAND);
+		return -1;
+	}
+	data_remaining -= size;
+	return msc_receive(dst, size);
+}
+
+static uint32_t msc_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint16_t)p[2] << 8) | p[3];
+}
+
+static void msc_put_be32(uint8_t *p, uint32_t n)
+{
+	p[0] = n >> 24;
+	p[1] = n >> 16;
+	p[2] = n >> 8;
+	p[3] = n;
+}
+
+
+/**************************************************************************
+ *
+ *  SCSI command handlers - return the CSW status (0 = passed)
+ *
+ **************************************************************************/
+
+static uint8_t scsi_request_sense(void)
+{
+	uint8_t sense[18] = {0};
+
+	sense[0] = 0x70;	// current error, fixed format
+	sense[2] = sense_key;
+	sense[7] = 10;		// additional sense length
+	sense[12] = sense_asc;
+	if (msc_data_in(sense, (cbw.CB[4] < 18) ? cbw.CB[4] : 18, 0)) return 1;
+	sense_key = SENSE_NONE;
+	sense_asc = 0;
+	return 0;
+}
+
+static uint8_t scsi_capacity(uint8_t format_capacities)
+{
+	uint8_t data[12];
+	uint32_t sectors;
+
+	if (!medium_ready) return msc_fail(SENSE_NOT_READY, ASC_MEDIUM_NOT_PRESENT);
+	if (disk_ioctl(0, GET_SECTOR_COUNT, &sectors)) {
+		return msc_fail(SENSE_MEDIUM_ERROR, ASC_READ_ERROR);
+	}
+	if (format_capacities) {
+		// capacity list header + current/maximum capacity descriptor
+		data[0] = 0; data[1] = 0; data[2] = 0; data[3] = 8;
+		msc_put_be32(data + 4, sectors);
+		msc_put_be32(data + 8, 512);
+		data[8] = 0x02;		// formatted media
+		return msc_data_in(data, 12, 0) ? 1 : 0;
+	}
+	msc_put_be32(data, sectors - 1);	// last logical block
+	msc_put_be32(data + 4, 512);		// block length
+	return msc_data_in(data, 8, 0) ? 1 : 0;
+}
+
+// READ(10) and WRITE(10): blocks of up to MSC_BLOCK_SECTORS sectors are
+// moved between the endpoint and the card with multi-block commands
+static uint8_t scsi_transfer(uint8_t *block, uint8_t write)
+{
+	uint32_t lba;
+	uint16_t count;
+	uint8_t n;
+
+	if (!medium_ready) return msc_fail(SENSE_NOT_READY, ASC_MEDIUM_NOT_PRESENT);
+	lba = msc_be32(cbw.CB + 2);
+	count = ((uint16_t)cbw.CB[7] << 8) | cbw.CB[8];
+	if ((uint32_t)count * 512 > data_remaining) {
+		return msc_fail(SENSE_ILLEGAL_REQUEST, ASC_INVALID_COMMAND);
+	}
+	while (count) {
+		n = (count < MSC_BLOCK_SECTORS) ? count : MSC_BLOCK_SECTORS;
+		if (write) {
+			if (msc_data_out(block, n * 512)) return 1;
+			medium_written = 1;
+			if (disk_write(0, block, lba, n)) {
+				return msc_fail(SENSE_MEDIUM_ERROR, ASC_WRITE_FAULT);
+			}
+		} else {
+			if (disk_read(0, block, lba, n)) {
+				return msc_fail(SENSE_MEDIUM_ERROR, ASC_READ_ERROR);
+			}
+			if (msc_data_in(block, n * 512, 0)) return 1;
+		}
+		transfer_bytes[write] += n * 512;
+		lba += n;
+		count -= n;
+	}
+	return 0;
+}
+
+// times a READ(10) or WRITE(10) for the STATISTICS command
+static uint8_t scsi_read_write(uint8_t *block, uint8_t write)
+{
+	uint32_t start = timer_ticks();
+	uint8_t status = scsi_transfer(block, write);
+
+	transfer_ticks[write] += timer_ticks() - start;
+	return status;
+}
+
+// STATISTICS: bytes read, ticks reading, bytes written and ticks
+// writing (big endian, 64 us ticks) since the last call, which clears
+// them.  The sequential rate of a dd run is bytes / ticks.
+static uint8_t scsi_statistics(void)
+{
+	uint8_t data[16], i;
+
+	for (i = 0; i < 2; i++) {
+		msc_put_be32(data + 8 * i, transfer_bytes[i]);
+		msc_put_be32(data + 8 * i + 4, transfer_ticks[i]);
+	}
+	if (msc_data_in(data, (cbw.CB[4] < 16) ? cbw.CB[4] : 16, 0)) return 1;
+	for (i = 0; i < 2; i++) {
+		transfer_bytes[i] = 0;
+		transfer_ticks[i] = 0;
+	}
+	return 0;
+}
+
+static uint8_t scsi_command(uint8_t *block)
+{
+	uint8_t mode[4];
+
+	switch (cbw.CB[0]) {
+	  case SCSI_TEST_UNIT_READY:
+		if (!medium_ready) return msc_fail(SENSE_NOT_READY, ASC_MEDIUM_NOT_PRESENT);
+		if (medium_attention) {
+			medium_attention = 0;
+			return msc_fail(SENSE_UNIT_ATTENTION, ASC_MEDIUM_CHANGED);
+		}
+		return 0;
+	  case SCSI_REQUEST_SENSE:
+		return scsi_request_sense();
+	  case SCSI_INQUIRY:
+		return msc_data_in(inquiry_data, (cbw.CB[4] < 36) ? cbw.CB[4] : 36, 1) ? 1 : 0;
+	  case SCSI_MODE_SENSE_6:
+		mode[0] = 3;		// mode data length
+		mode[1] = 0;		// medium type
+		mode[2] = (disk_status(0) & STA_PROTECT) ? 0x80 : 0;
+		mode[3] = 0;		// block descriptor length
+		return msc_data_in(mode, (cbw.CB[4] < 4) ? cbw.CB[4] : 4, 0) ? 1 : 0;
+	  case SCSI_START_STOP_UNIT:
+	  case SCSI_PREVENT_ALLOW:
+	  case SCSI_VERIFY_10:
+		return 0;
+	  case SCSI_READ_FORMAT_CAP:
+		return scsi_capacity(1);
+	  case SCSI_READ_CAPACITY_10:
+		return scsi_capacity(0);
+	  case SCSI_READ_10:
+		return scsi_read_write(block, 0);
+	  case SCSI_WRITE_10:
+		return scsi_read_write(block, 1);
+	  case SCSI_STATISTICS:
+		return scsi_statistics();
+	  default:
+		return msc_fail(SENSE_ILLEGAL_REQUEST, ASC_INVALID_COMMAND);
+	}
+}
+
+
+/**************************************************************************
+ *
+ *  Public Functions - these are the API intended for the user
+ *
+ **************************************************************************/
+
+// initialize USB mass storage
+void usb_msc_init(void)
+{
+	HW_CONFIG();
+        USB_FREEZE();				// enable USB
+        PLL_CONFIG();				// config PLL, 16 MHz xtal
+        while (!(PLLCSR & (1<<PLOCK))) ;	// wait for PLL lock
+        USB_CONFIG();				// start USB clock
+        UDCON = 0;				// enable attach resistor
+	usb_configuration = 0;
+        UDIEN = (1<<EORSTE);
+	sei();
+}
+
+// return 0 if the USB is not configured, or the configuration
+// number selected by the HOST
+uint8_t usb_msc_configured(void)
+{
+	return usb_configuration;
+}
+
+// process at most one command from the host
+void usb_msc_task(uint8_t *block)
+{
+	struct csw_struct csw;
+	uint8_t intr_state, i, *p, ready;
+
+	// the medium "appears" when the recorder releases the card;
+	// report it as changed so the host drops any cached contents
+	ready = block && !(disk_status(0) & STA_NOINIT);
+	if (ready && !medium_ready) medium_attention = 1;
+	medium_ready = ready;
+
+	if (!usb_configuration) return;
+
+	// fetch a command block wrapper, if one has arrived
+	intr_state = SREG;
+	cli();
+	UENUM = MSC_RX_ENDPOINT;
+	i = UEINTX;
+	if (!(i & (1<<RWAL))) {
+		if (i & (1<<RXOUTI)) UEINTX = 0x6B;
+		SREG = intr_state;
+		return;
+	}
+	if (UEBCLX != CBW_SIZE) {
+		// not a valid CBW, discard it
+		UEINTX = 0x6B;
+		SREG = intr_state;
+		return;
+	}
+	p = (uint8_t *)&cbw;
+	for (i = 0; i < CBW_SIZE; i++) {
+		*p++ = UEDATX;
+	}
+	UEINTX = 0x6B;
+	SREG = intr_state;
+	if (cbw.dSignature != CBW_SIGNATURE) return;
+
+	// execute the command
+	data_remaining = cbw.dDataTransferLength;
+	if (cbw.bLUN) {
+		csw.bStatus = msc_fail(SENSE_ILLEGAL_REQUEST, ASC_INVALID_COMMAND);
+	} else {
+		csw.bStatus = scsi_command(block);
+	}
+
+	// pad or drain whatever part of the data stage was not used
+	csw.dDataResidue = data_remaining;
+	if (data_remaining) {
+		if (cbw.bmFlags & CBW_DIR_IN) msc_send(0, data_remaining, 0);
+		else msc_receive(0, data_remaining);
+	}
+	msc_send_flush();
+
+	// status stage
+	csw.dSignature = CSW_SIGNATURE;
+	csw.dTag = cbw.dTag;
+	msc_send((uint8_t *)&csw, CSW_SIZE, 0);
+	msc_send_flush();
+}
+
+uint8_t usb_msc_changed(void)
+{
+	uint8_t changed = medium_written;
+
+	medium_written = 0;
+	return changed;
+}
+
+
+
+/**************************************************************************
+ *
+ *  Private Functions - not intended for general user consumption....
+ *
+ **************************************************************************/
+
+
+// USB Device Interrupt - handle all device-level events
+ISR(USB_GEN_vect)
+{
+	uint8_t intbits;
+	PROFILE_ENTER();
+
+        intbits = UDINT;
+        UDINT = 0;
+        if (intbits & (1<<EORSTI)) {
+		UENUM = 0;
+		UECONX = 1;
+		UECFG0X = EP_TYPE_CONTROL;
+		UECFG1X = EP_SIZE(ENDPOINT0_SIZE) | EP_SINGLE_BUFFER;
+		UEIENX = (1<<RXSTPE);
+		usb_configuration = 0;
+        }
+	PROFILE_EXIT(PROFILE_USB_GEN);
+}
+
+
+// Misc functions to wait for ready and send/receive packets
+static inline void usb_wait_in_ready(void)
+{
+	while (!(UEINTX & (1<<TXINI))) ;
+}
+static inline void usb_send_in(void)
+{
+	UEINTX = ~(1<<TXINI);
+}
+
+
+
+// Endpoint 0 request handler, called from the endpoint interrupt
+// with interrupts enabled.  The bulk endpoints are serviced by
+// usb_msc_task().
+static void usb_control(void)
+{
+        uint8_t intbits;
+	const uint8_t *list;
+        const uint8_t *cfg;
+	uint8_t i, n, len, en;
+	uint8_t bmRequestType;
+	uint8_t bRequest;
+	uint16_t wValue;
+	uint16_t wIndex;
+	uint16_t wLength;
+	uint16_t desc_val;
+	const uint8_t *desc_addr;
+	uint8_t	desc_length;
+
+        UENUM = 0;
+        intbits = UEINTX;
+        if (intbits & (1<<RXSTPI)) {
+                bmRequestType = UEDATX;
+                bRequest = UEDATX;
+                wValue = UEDATX;
+                wValue |= (UEDATX << 8);
+                wIndex = UEDATX;
+                wIndex |= (UEDATX << 8);
+                wLength = UEDATX;
+                wLength |= (UEDATX << 8);
+                UEINTX = ~((1<<RXSTPI) | (1<<RXOUTI) | (1<<TXINI));
+                if (bRequest == GET_DESCRIPTOR) {
+			list = (const uint8_t *)descriptor_list;
+			for (i=0; ; i++) {
+				if (i >= NUM_DESC_LIST) {
+					UECONX = (1<<STALLRQ)|(1<<EPEN);  //stall
+					return;
+				}
+				desc_val = pgm_read_word(list);
+				if (desc_val != wValue) {
+					list += sizeof(struct descriptor_list_struct);
+					continue;
+				}
+				list += 2;
+				desc_val = pgm_read_word(list);
+				if (desc_val != wIndex) {
+					list += sizeof(struct descriptor_list_struct)-2;
+					continue;
+				}
+				list += 2;
+				desc_addr = (const uint8_t *)pgm_read_word(list);
+				list += 2;
+				desc_length = pgm_read_byte(list);
+				break;
+			}
+			len = (wLength < 256) ? wLength : 255;
+			if (len > desc_length) len = desc_length;
+			do {
+				// wait for host ready for IN packet
+				do {
+					i = UEINTX;
+				} while (!(i & ((1<<TXINI)|(1<<RXOUTI))));
+				if (i & (1<<RXOUTI)) return;	// abort
+				// send IN packet
+				n = len < ENDPOINT0_SIZE ? len : ENDPOINT0_SIZE;
+				for (i = n; i; i--) {
+					UEDATX = pgm_read_byte(desc_addr++);
+				}
+				len -= n;
+				usb_send_in();
+			} while (len || n == ENDPOINT0_SIZE);
+			return;
+                }
+		if (bRequest == SET_ADDRESS) {
+			usb_send_in();
+			usb_wait_in_ready();
+			UDADDR = wValue | (1<<ADDEN);
+			return;
+		}
+		if (bRequest == SET_CONFIGURATION && bmRequestType == 0) {
+			usb_configuration = wValue;
+			usb_send_in();
+			cfg = endpoint_config_table;
+			for (i=1; i<5; i++) {
+				UENUM = i;
+				en = pgm_read_byte(cfg++);
+				UECONX = en;
+				if (en) {
+					UECFG0X = pgm_read_byte(cfg++);
+					UECFG1X = pgm_read_byte(cfg++);
+				}
+			}
+        		UERST = 0x1E;
+        		UERST = 0;
+			return;
+		}
+		if (bRequest == GET_CONFIGURATION && bmRequestType == 0x80) {
+			usb_wait_in_ready();
+			UEDATX = usb_configuration;
+			usb_send_in();
+			return;
+		}
+		if (bRequest == MSC_GET_MAX_LUN && bmRequestType == 0xA1) {
+			usb_wait_in_ready();
+			UEDATX = 0;			// single logical unit
+			usb_send_in();
+			return;
+		}
+		if (bRequest == MSC_BULK_ONLY_RESET && bmRequestType == 0x21) {
+			UERST = (1<<MSC_TX_ENDPOINT)|(1<<MSC_RX_ENDPOINT);
+			UERST = 0;
+			usb_wait_in_ready();
+			usb_send_in();
+			return;
+		}
+		if (bRequest == GET_STATUS) {
+			usb_wait_in_ready();
+			i = 0;
+			if (bmRequestType == 0x82) {
+				UENUM = wIndex;
+				if (UECONX & (1<<STALLRQ)) i = 1;
+				UENUM = 0;
+			}
+			UEDATX = i;
+			UEDATX = 0;
+			usb_send_in();
+			return;
+		}
+		if ((bRequest == CLEAR_FEATURE || bRequest == SET_FEATURE)
+		  && bmRequestType == 0x02 && wValue == 0) {
+			i = wIndex & 0x7F;
+			if (i >= 1 && i <= MAX_ENDPOINT) {
+				usb_send_in();
+				UENUM = i;
+				if (bRequest == SET_FEATURE) {
+					UECONX = (1<<STALLRQ)|(1<<EPEN);
+				} else {
+					UECONX = (1<<STALLRQC)|(1<<RSTDT)|(1<<EPEN);
+					UERST = (1 << i);
+					UERST = 0;
+				}
+				return;
+			}
+		}
+        }
+	UECONX = (1<<STALLRQ) | (1<<EPEN);	// stall
+}
+
+
+// USB Endpoint Interrupt - the USB interrupt sources are masked and
+// interrupts re-enabled while the endpoint 0 request is serviced, so
+// the ADC and PWM interrupts are not held off by enumeration (see
+// usb_serial.c, version 1.9).
+//
+ISR(USB_COM_vect)
+{
+	uint8_t udien;
+	PROFILE_ENTER();
+
+	UENUM = 0;
+	UEIENX = 0;			// mask endpoint 0 setup interrupt
+	udien = UDIEN;
+	UDIEN = 0;			// mask device interrupts (bus reset)
+	sei();
+	usb_control();
+	cli();
+	UENUM = 0;
+	UEIENX = (1<<RXSTPE);
+	UDIEN = udien;
+	PROFILE_EXIT(PROFILE_USB_COM);
+}
+
+#endif // USB_MSC_MODE
@@ -0,0 +1,30 @@
+#ifndef usb_msc_h__
+#define usb_msc_h__
+
+#include <stdint.h>
+
+// USB Mass Storage (Bulk-Only Transport, SCSI transparent command set)
+// alternative to usb_serial.  Only one USB personality can be linked
+// into the firmware: define USB_MSC_MODE for the whole project to
+// build this module instead of usb_serial.
+
+// setup
+void usb_msc_init(void);		// initialize everything
+uint8_t usb_msc_configured(void);	// is the USB port configured
+
+// service the bulk endpoints, call regularly from the main loop.
+// block must point to 1024 bytes of scratch memory for sector
+// transfers, or be 0 to report the medium as not present (e.g.
+// while the card is in use by the recorder)
+void usb_msc_task(uint8_t *block);
+
+// returns non-zero (once) if the host has written to the card since
+// the last call, in which case any cached file system state is stale
+uint8_t usb_msc_changed(void);
+
+// The host reads the READ(10)/WRITE(10) transfer statistics with the
+// vendor specific command 0xC0 (allocation length 16 in byte 4): bytes
+// read, Timer0 ticks (64 us) reading, bytes written and ticks writing,
+// as big endian 32 bit counts since the previous 0xC0 command
+
+#endif
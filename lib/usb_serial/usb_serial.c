@@ -29,9 +29,18 @@
 // Version 1.5: add support for Teensy 2.0
 // Version 1.6: fix zero length packet bug
 // Version 1.7: fix usb_serial_set_control
+// Version 1.8: added usb_serial_read; excluded when building the
+//              mass storage or audio personalities (USB_MSC_MODE,
+//              USB_AUDIO_MODE, see lib/usb_msc and lib/usb_audio)
+// Version 1.9: bounded interrupt latency - endpoint FIFOs are copied
+//              in FIFO_CHUNK byte pieces with interrupts disabled, and
+//              endpoint 0 requests are serviced with interrupts enabled
+
+#if !defined(USB_MSC_MODE) && !defined(USB_AUDIO_MODE)
 
 #define USB_SERIAL_PRIVATE_INCLUDE
 #include "usb_serial.h"
+#include "../../profile.h"
 
 
 /**************************************************************************
@@ -86,6 +95,13 @@
 // use to know your data wasn't sent.
 #define TRANSMIT_TIMEOUT	25   /* in milliseconds */
 
+// The endpoint FIFOs must be accessed with interrupts disabled, as
+// the USB interrupts also select endpoints (UENUM).  Longer blocks
+// are copied in pieces of this many bytes, re-enabling interrupts
+// in between, so the audio interrupts (ADC, PWM) are held off for
+// at most a few microseconds by usb_serial_read/usb_serial_write.
+#define FIFO_CHUNK		16
+
 // USB devices are supposed to implment a halt feature, which is
 // rarely (if ever) used.  If you comment this line out, the halt
 // code will be removed, saving 116 bytes of space (gcc 4.3.0).
@@ -369,6 +385,50 @@ int16_t usb_serial_getchar(void)
 	return c;
 }
 
+// receive a buffer, without waiting for data.
+//  returns the number of bytes copied (0 if nothing received)
+// Packets are copied out of the endpoint FIFO with interrupts
+// disabled only for FIFO_CHUNK bytes at a time, so this is much
+// faster than calling usb_serial_getchar() for every byte.
+uint16_t usb_serial_read(uint8_t *buffer, uint16_t size)
+{
+	uint8_t c, n, intr_state;
+	uint16_t count = 0;
+
+	while (size) {
+		intr_state = SREG;
+		cli();
+		if (!usb_configuration) {
+			SREG = intr_state;
+			break;
+		}
+		UENUM = CDC_RX_ENDPOINT;
+		c = UEINTX;
+		if (!(c & (1<<RWAL))) {
+			// no data in buffer
+			if (c & (1<<RXOUTI)) {
+				UEINTX = 0x6B;
+				SREG = intr_state;
+				continue;
+			}
+			SREG = intr_state;
+			break;
+		}
+		// copy as much of this packet as will fit, one chunk
+		// at a time to keep interrupts enabled between chunks
+		n = UEBCLX;
+		if (n > size) n = size;
+		if (n > FIFO_CHUNK) n = FIFO_CHUNK;
+		size -= n;
+		count += n;
+		while (n--) *buffer++ = UEDATX;
+		// if buffer completely used, release it
+		if (!(UEINTX & (1<<RWAL))) UEINTX = 0x6B;
+		SREG = intr_state;
+	}
+	return count;
+}
+
 // number of bytes available in the receive buffer
 uint8_t usb_serial_available(void)
 {
@@ -510,11 +570,17 @@ int8_t usb_serial_write(const uint8_t *buffer, uint16_t size)
 		}
 		transmit_previous_timeout = 0;
 	}
-	// each iteration of this loop transmits a packet
+	SREG = intr_state;
+	// each iteration of this loop writes one chunk of a packet
 	while (size) {
 		// wait for the FIFO to be ready to accept data
 		timeout = UDFNUML + TRANSMIT_TIMEOUT;
 		while (1) {
+			// an interrupt may have selected another endpoint
+			// since the last chunk, so select ours again
+			intr_state = SREG;
+			cli();
+			UENUM = CDC_TX_ENDPOINT;
 			// are we ready to transmit?
 			if (UEINTX & (1<<RWAL)) break;
 			SREG = intr_state;
@@ -526,15 +592,13 @@ int8_t usb_serial_write(const uint8_t *buffer, uint16_t size)
 			}
 			// has the USB gone offline?
 			if (!usb_configuration) return -1;
-			// get ready to try checking again
-			intr_state = SREG;
-			cli();
-			UENUM = CDC_TX_ENDPOINT;
 		}
 
-		// compute how many bytes will fit into the next packet
+		// compute how many bytes will fit into the next packet,
+		// limited to one chunk with interrupts disabled
 		write_size = CDC_TX_SIZE - UEBCLX;
 		if (write_size > size) write_size = size;
+		if (write_size > FIFO_CHUNK) write_size = FIFO_CHUNK;
 		size -= write_size;
 
 		// write the packet
@@ -719,6 +783,7 @@ int8_t usb_serial_set_control(uint8_t signals)
 ISR(USB_GEN_vect)
 {
 	uint8_t intbits, t;
+	PROFILE_ENTER();
 
         intbits = UDINT;
         UDINT = 0;
@@ -743,6 +808,7 @@ ISR(USB_GEN_vect)
 			}
 		}
 	}
+	PROFILE_EXIT(PROFILE_USB_GEN);
 }
 
 
@@ -766,11 +832,11 @@ static inline void usb_ack_out(void)
 
 
 
-// USB Endpoint Interrupt - endpoint 0 is handled here.  The
-// other endpoints are manipulated by the user-callable
-// functions, and the start-of-frame interrupt.
-//
-ISR(USB_COM_vect)
+// Endpoint 0 request handler, called from the endpoint interrupt
+// with interrupts enabled.  Control transfers wait for the host
+// (descriptor packets, status stages), so this can take hundreds of
+// microseconds during enumeration.
+static void usb_control(void)
 {
         uint8_t intbits;
 	const uint8_t *list;
@@ -934,3 +1000,32 @@ ISR(USB_COM_vect)
 }
 
 
+// USB Endpoint Interrupt - endpoint 0 is handled here.  The
+// other endpoints are manipulated by the user-callable
+// functions, and the start-of-frame interrupt.
+//
+// The USB interrupt sources are masked and interrupts re-enabled
+// while the request is serviced, so the ADC and PWM interrupts are
+// not held off by enumeration.  The device interrupt is masked too,
+// as its start of frame flush selects another endpoint (UENUM).
+// The general interrupt (USB_GEN_vect) is short and stays atomic.
+//
+ISR(USB_COM_vect)
+{
+	uint8_t udien;
+	PROFILE_ENTER();
+
+	UENUM = 0;
+	UEIENX = 0;			// mask endpoint 0 setup interrupt
+	udien = UDIEN;
+	UDIEN = 0;			// mask device interrupts (start of frame)
+	sei();
+	usb_control();
+	cli();
+	UENUM = 0;
+	UEIENX = (1<<RXSTPE);
+	UDIEN = udien;
+	PROFILE_EXIT(PROFILE_USB_COM);
+}
+
+#endif // !USB_MSC_MODE && !USB_AUDIO_MODE
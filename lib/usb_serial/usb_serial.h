@@ -10,6 +10,7 @@ uint8_t usb_configured(void);		// is the USB port configured
 // receiving data
 int16_t usb_serial_getchar(void);	// receive a character (-1 if timeout/error)
 uint8_t usb_serial_available(void);	// number of bytes in receive buffer
+uint16_t usb_serial_read(uint8_t *buffer, uint16_t size); // receive a buffer (no waiting)
 void usb_serial_flush_input(void);	// discard any buffered input
 
 // transmitting data
@@ -0,0 +1,102 @@
+/**
+ * load.c - EGB240DVR Library, CPU load meter
+ *
+ * The ADC, Timer0 and Timer4 interrupt service routines add their own
+ * run time, read from the Timer3 cycle counter on entry and exit, to
+ * a per-source total (LOAD_ENTER/LOAD_EXIT). The scheduler subtracts
+ * the ISR time from the time it spends asleep, so idle time is the CPU
+ * genuinely unused. Whatever remains of each measurement interval is
+ * foreground work: the scheduler's tasks and the interrupts that are
+ * not accounted (USB, watchdog), plus all ISR prologues and epilogues.
+ *
+ * The totals only ever increase (the difference between two readings
+ * is used), so they are never written outside the ISRs.
+ *
+ * Requires:
+ *   timer - Timer0 tick count, used for the measurement interval
+ *   sched - Idle cycle count
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "timer.h"
+#include "sched.h"
+#include "load.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define LOAD_CYCLES_PER_TICK	1024	// CPU cycles per Timer0 tick (64 us)
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+volatile uint32_t loadCycles[LOAD_SOURCES];		// Cycles spent in each ISR (free running)
+
+static uint32_t isrMark[LOAD_SOURCES];			// ISR cycles at the start of the interval
+static uint32_t idleMark = 0;					// Idle cycles at the start of the interval
+static uint32_t windowStart = 0;				// Tick count at the start of the interval
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: load_isr_cycles
+ * 
+ * Returns: The total cycles spent in the accounted ISRs. Must be called
+ * with interrupts disabled.
+ */
+uint32_t load_isr_cycles() {
+	return loadCycles[LOAD_ADC] + loadCycles[LOAD_TIMER0] + loadCycles[LOAD_PWM];
+}
+
+/**
+ * Function: load_measure
+ * 
+ * Measures the CPU load since the last call and starts a new interval.
+ * Intervals must be shorter than ~4 minutes (32-bit cycle counts).
+ *
+ * Parameters:
+ *    permille - Receives LOAD_COUNT entries (LOAD_ADC .. LOAD_IDLE), each
+ *               in 1/1000ths of the interval.
+ */
+void load_measure(uint16_t* permille) {
+	uint32_t now = timer_ticks();
+	uint32_t scale = (now - windowStart) * LOAD_CYCLES_PER_TICK / 1000;	// Cycles per 1/1000th
+	uint32_t cycles[LOAD_SOURCES];
+	uint32_t delta, idle;
+	uint16_t used = 0;
+	uint8_t i;
+	
+	cli();
+	for (i = 0; i < LOAD_SOURCES; i++) {
+		cycles[i] = loadCycles[i];
+	}
+	idle = sched_idle_cycles();
+	sei();
+	
+	windowStart = now;
+	if (!scale) scale = 1;
+	
+	for (i = 0; i < LOAD_SOURCES; i++) {
+		delta = cycles[i] - isrMark[i];
+		isrMark[i] = cycles[i];
+		permille[i] = delta / scale;
+		used += permille[i];
+	}
+	delta = idle - idleMark;
+	idleMark = idle;
+	permille[LOAD_IDLE] = delta / scale;
+	used += permille[LOAD_IDLE];
+	
+	permille[LOAD_FOREGROUND] = used < 1000 ? 1000 - used : 0;
+}
@@ -0,0 +1,43 @@
+/**
+ * load.h - EGB240DVR Library, CPU load meter header
+ *
+ * Accounts the CPU cycles spent in the audio and timer interrupt
+ * service routines and splits the remaining time into foreground
+ * (task) work and idle time.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef LOAD_H_
+#define LOAD_H_
+
+#include "profile.h"
+
+// Load meter entries (interrupt sources first, numbered as in profile.h)
+#define LOAD_ADC		PROFILE_ADC		// ADC conversion complete ISR (sampling)
+#define LOAD_TIMER0		PROFILE_TIMER0	// Timer0 ISR (tick, FatFs timers, button scan)
+#define LOAD_PWM		PROFILE_PWM		// Timer4 overflow ISR (playback)
+#define LOAD_SOURCES	3		// Number of accounted interrupt sources
+#define LOAD_FOREGROUND	3		// Tasks and unaccounted interrupts
+#define LOAD_IDLE		4		// CPU asleep
+#define LOAD_COUNT		5
+
+extern volatile uint32_t loadCycles[LOAD_SOURCES];
+
+// Place at the start and end of an accounted ISR body. Timer3 counts
+// CPU cycles (see sched.c); the ISR prologue/epilogue is not included.
+// The same run time is recorded in the ISR profile, so accounted ISRs
+// need no PROFILE_ENTER/PROFILE_EXIT.
+#define LOAD_ENTER()		uint16_t loadStart = TCNT3
+#define LOAD_EXIT(source)	do { \
+		uint16_t loadRun = TCNT3 - loadStart; \
+		loadCycles[source] += loadRun; \
+		PROFILE_RUN(source, loadRun); \
+	} while (0)
+
+uint32_t load_isr_cycles();				// Total accounted ISR cycles (call with interrupts disabled)
+void load_measure(uint16_t* permille);	// Load since the last call, LOAD_COUNT entries in 1/1000ths
+
+#endif /* LOAD_H_ */
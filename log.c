@@ -0,0 +1,111 @@
+/**
+ * log.c - EGB240DVR Library, Deferred logging module
+ *
+ * Replaces on-device printf formatting of diagnostic messages. A call
+ * to log_write only copies a message ID and two arguments into a small
+ * RAM ring, with interrupts briefly disabled, so it is safe and cheap
+ * in the hot path and in interrupt service routines. log_flush, called
+ * from the main loop, sends pending records as TLM_LOG telemetry
+ * frames; the host resolves the IDs against log_msgs.h.
+ *
+ * Requires:
+ *   serial - USB serial interface (non-blocking transmit ring)
+ *   telemetry - Frame format shared with the telemetry module
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "serial.h"
+#include "telemetry.h"
+#include "log.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define LOG_SIZE	8			// Number of records held (power of 2)
+#define LOG_MASK	(LOG_SIZE - 1)
+
+/************************************************************************/
+/* TYPE DEFINITIONS                                                     */
+/************************************************************************/
+typedef struct {
+	uint8_t id;		// Message ID (index into log_msgs.h)
+	int16_t a;		// First argument
+	int16_t b;		// Second argument
+} LOG_RECORD;
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static LOG_RECORD logRing[LOG_SIZE];	// Pending records
+static volatile uint8_t logHead = 0;	// Write index
+static volatile uint8_t logTail = 0;	// Read index
+static volatile uint16_t logDropped = 0;	// Records lost while ring full
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: log_write
+ *
+ * Records a log message. Never blocks; if the ring is full the record
+ * is discarded and counted. May be called from any context.
+ *
+ * Parameters:
+ *    id - Message ID (LOG_* from log_msgs.h).
+ *    a - First format argument.
+ *    b - Second format argument (ignored if the format has one).
+ */
+void log_write(uint8_t id, int16_t a, int16_t b) {
+	uint8_t sreg = SREG;
+	uint8_t head;
+	
+	cli();
+	head = logHead;
+	if (((head + 1) & LOG_MASK) == logTail) {
+		logDropped++;
+	} else {
+		logRing[head].id = id;
+		logRing[head].a = a;
+		logRing[head].b = b;
+		logHead = (head + 1) & LOG_MASK;
+	}
+	SREG = sreg;
+}
+
+/**
+ * Function: log_flush
+ *
+ * Moves pending records into the serial transmit ring as telemetry
+ * frames. Records that do not fit are kept for the next call. Call
+ * from the main loop only.
+ */
+void log_flush() {
+	LOG_RECORD* rec;
+	
+	while (logTail != logHead) {
+		if (serial_free() < TLM_LOG_FRAME) break;	// Transmit ring full, retry later
+		
+		rec = &logRing[logTail];
+		telemetry_log(rec->id, rec->a, rec->b);
+		logTail = (logTail + 1) & LOG_MASK;
+	}
+}
+
+/**
+ * Function: log_dropped
+ *
+ * Returns: Number of records discarded because the ring was full.
+ */
+uint16_t log_dropped() {
+	return logDropped;
+}
@@ -0,0 +1,28 @@
+/**
+ * log.h - EGB240DVR Library, Deferred logging module header
+ *
+ * Records (message ID, arguments) tuples in constant time from any
+ * context, including interrupt service routines. Records are drained
+ * lazily as telemetry frames and formatted on the host.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef LOG_H_
+#define LOG_H_
+
+// Message IDs, generated from the message table
+#define LOG_MSG(id, format) id,
+enum {
+#include "log_msgs.h"
+	LOG_MSG_COUNT
+};
+#undef LOG_MSG
+
+void log_write(uint8_t id, int16_t a, int16_t b);	// Records a message (O(1), ISR safe)
+void log_flush();									// Moves recorded messages to the serial transmit ring
+uint16_t log_dropped();								// Returns the number of records lost (log full)
+
+#endif /* LOG_H_ */
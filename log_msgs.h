@@ -0,0 +1,27 @@
+/**
+ * log_msgs.h - EGB240DVR Library, Log message table
+ *
+ * Single source of truth for deferred log messages. The firmware only
+ * uses the message IDs (see log.h); the format strings are never
+ * compiled into the firmware. The host decoder (tools/telemetry.py)
+ * reads this file to format received log records.
+ *
+ * Each entry is LOG_MSG(id, format). Formats take up to two %d
+ * arguments. Append new messages at the end so existing IDs (the
+ * position in this table) remain stable.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+LOG_MSG(LOG_MOUNT_ERR,		"f_mount returned error code: %d")
+LOG_MSG(LOG_OPEN_ERR,		"f_open returned error code: %d")
+LOG_MSG(LOG_CLOSE_ERR,		"f_close returned error code: %d")
+LOG_MSG(LOG_LSEEK_ERR,		"f_lseek returned error code: %d")
+LOG_MSG(LOG_WRITE_ERR,		"f_write returned error code: %d")
+LOG_MSG(LOG_WRITE_SHORT,	"f_write wrote %d of %d bytes to file.")
+LOG_MSG(LOG_READ_ERR,		"f_read returned error code: %d")
+LOG_MSG(LOG_READ_SHORT,		"f_read read %d of %d bytes from file.")
+LOG_MSG(LOG_STALL,		"Pipeline stalled in state %d, continuing in segment %d")
+LOG_MSG(LOG_SYNC_ERR,		"f_sync returned error code: %d")
@@ -0,0 +1,263 @@
+/**
+ * loopback.c - EGB240DVR Library, Loopback self-test module
+ *
+ * Self-test of the analogue chain: the PWM output (OC4B, through the
+ * output filter) is wired to ADC0 and the ADC interrupt, via
+ * loopback_sample, takes each input sample and sets the next output
+ * in the same call. Output and input are therefore aligned to the
+ * sample; a sample written at conversion n is first seen by
+ * conversion n + 1, so one sample of the round trip is digital.
+ *
+ * The test runs in two parts:
+ *   - LOOPBACK_REPEATS impulses (one full scale sample, every
+ *     LOOPBACK_WINDOW samples). The responses are summed in the idle
+ *     audio buffer; the peak, refined by a parabola through its
+ *     neighbours, gives the latency in 1/100ths of a sample.
+ *   - a sweep of LOOPBACK_TONES sine tones. After LOOPBACK_SETTLE
+ *     samples each tone is correlated over LOOPBACK_MEASURE samples
+ *     with the sine and cosine it is generated from. The tones are
+ *     whole cycles in the measurement, so the two sums give the gain
+ *     and phase of the chain at that frequency without leakage from
+ *     DC or other tones.
+ * Each result is sent (TLM_LOOPBACK, TLM_RESPONSE frames, decoded by
+ * tools/telemetry.py) by loopback_poll as soon as it is ready. The
+ * whole test takes about 3 s at 15.625 kHz.
+ *
+ * Requires:
+ *   buffer - Idle audio buffer holds the impulse response
+ *   serial - Console ring space
+ *   telemetry - TLM_LOOPBACK and TLM_RESPONSE frames
+ *   sched - Control task is posted when the test is complete
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "serial.h"
+#include "telemetry.h"
+#include "sched.h"
+#include "loopback.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define LOOPBACK_IDLE		0x80	// Output between impulses and after the test
+#define LOOPBACK_IMPULSE	0xFF	// Impulse output
+
+#define PENDING_IMPULSE		0x01	// Impulse response ready to send
+#define PENDING_TONE		0x02	// Tone result ready to send
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+
+// One cycle of sine, amplitude 127
+static const int8_t sine[256] PROGMEM = {
+	   0,    3,    6,    9,   12,   16,   19,   22,   25,   28,   31,   34,   37,   40,   43,   46,
+	  49,   51,   54,   57,   60,   63,   65,   68,   71,   73,   76,   78,   81,   83,   85,   88,
+	  90,   92,   94,   96,   98,  100,  102,  104,  106,  107,  109,  111,  112,  113,  115,  116,
+	 117,  118,  120,  121,  122,  122,  123,  124,  125,  125,  126,  126,  126,  127,  127,  127,
+	 127,  127,  127,  127,  126,  126,  126,  125,  125,  124,  123,  122,  122,  121,  120,  118,
+	 117,  116,  115,  113,  112,  111,  109,  107,  106,  104,  102,  100,   98,   96,   94,   92,
+	  90,   88,   85,   83,   81,   78,   76,   73,   71,   68,   65,   63,   60,   57,   54,   51,
+	  49,   46,   43,   40,   37,   34,   31,   28,   25,   22,   19,   16,   12,    9,    6,    3,
+	   0,   -3,   -6,   -9,  -12,  -16,  -19,  -22,  -25,  -28,  -31,  -34,  -37,  -40,  -43,  -46,
+	 -49,  -51,  -54,  -57,  -60,  -63,  -65,  -68,  -71,  -73,  -76,  -78,  -81,  -83,  -85,  -88,
+	 -90,  -92,  -94,  -96,  -98, -100, -102, -104, -106, -107, -109, -111, -112, -113, -115, -116,
+	-117, -118, -120, -121, -122, -122, -123, -124, -125, -125, -126, -126, -126, -127, -127, -127,
+	-127, -127, -127, -127, -126, -126, -126, -125, -125, -124, -123, -122, -122, -121, -120, -118,
+	-117, -116, -115, -113, -112, -111, -109, -107, -106, -104, -102, -100,  -98,  -96,  -94,  -92,
+	 -90,  -88,  -85,  -83,  -81,  -78,  -76,  -73,  -71,  -68,  -65,  -63,  -60,  -57,  -54,  -51,
+	 -49,  -46,  -43,  -40,  -37,  -34,  -31,  -28,  -25,  -22,  -19,  -16,  -12,   -9,   -6,   -3
+};
+
+// Tones in cycles per LOOPBACK_MEASURE samples (126 Hz to 7 kHz at 15.625 kHz)
+static const uint16_t tones[LOOPBACK_TONES] PROGMEM = {
+	33, 66, 131, 262, 524, 786, 1049, 1311, 1573, 1835
+};
+
+static int16_t* impulse;			// Summed impulse response (idle audio buffer)
+static uint16_t loopbackRate;		// Sample rate of the test
+static volatile uint8_t stage;		// 0: impulses, 1 to LOOPBACK_TONES: tone stage - 1, then finished
+static volatile uint16_t count;		// Samples into the stage
+static volatile uint16_t phase;		// Tone phase (256 per table entry)
+static volatile uint16_t step;		// Phase increment per sample
+static volatile int32_t sumI;		// Input correlated with the cosine
+static volatile int32_t sumQ;		// Input correlated with the sine
+static volatile uint8_t pending;	// Results waiting to be sent (PENDING_*)
+static volatile uint16_t resultTone;	// Last tone measured (cycles per LOOPBACK_MEASURE samples)
+static volatile int32_t resultI;		// Its correlation sums
+static volatile int32_t resultQ;
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+/**
+ * Function: loopback_latency
+ *
+ * Finds the peak of the summed impulse response and sends it with the
+ * latency, interpolated between samples.
+ */
+static void loopback_latency() {
+	int16_t peak = 0, y, before, after;
+	int32_t den;
+	int16_t latency;
+	uint8_t i, at = 1;
+	
+	for (i = 1; i < LOOPBACK_WINDOW; i++) {
+		y = impulse[i] - impulse[0];		// Before the impulse is seen
+		if (abs(y) > abs(peak)) {
+			peak = y;
+			at = i;
+		}
+	}
+	
+	latency = at * 100;
+	if (at + 1 < LOOPBACK_WINDOW) {			// Vertex of the parabola through the peak
+		before = impulse[at - 1] - impulse[0];
+		after = impulse[at + 1] - impulse[0];
+		den = 2 * ((int32_t)before - 2 * peak + after);
+		if (den) latency += (int32_t)100 * (before - after) / den;
+	}
+	telemetry_loopback(latency, peak, loopbackRate);
+}
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: loopback_start
+ *
+ * Prepares a new test, which then runs as the ADC delivers samples.
+ * Takes the audio buffer, so call only while stopped.
+ *
+ * Parameters:
+ *    rate - Sample rate of the ADC (reported with the results).
+ */
+void loopback_start(uint16_t rate) {
+	impulse = (int16_t*)buffer_block();
+	memset(impulse, 0, LOOPBACK_WINDOW * sizeof(int16_t));
+	loopbackRate = rate;
+	
+	cli();
+	stage = 0;
+	count = 0;
+	pending = 0;
+	sei();
+}
+
+/**
+ * Function: loopback_sample
+ *
+ * Takes the input sample of this conversion and sets the output for
+ * the next. Called from the ADC ISR in place of buffer_queue.
+ *
+ * Parameters:
+ *    input - ADC result.
+ */
+void loopback_sample(uint8_t input) {
+	int8_t x = input - 0x80;
+	int8_t s, c;
+	
+	if (stage == 0) {									// ---Impulses-----------
+		uint8_t i = count & (LOOPBACK_WINDOW - 1);
+		impulse[i] += x;
+		OCR4B = i ? LOOPBACK_IDLE : LOOPBACK_IMPULSE;
+		if (++count == LOOPBACK_WINDOW * LOOPBACK_REPEATS) {
+			pending |= PENDING_IMPULSE;
+			stage = 1;
+			count = 0;
+			phase = 0;
+			step = pgm_read_word(&tones[0]) << 4;		// Whole cycles in LOOPBACK_MEASURE samples
+			sumI = 0;
+			sumQ = 0;
+		}
+		return;
+	}
+	if (stage > LOOPBACK_TONES) return;					// Finished
+	
+	s = pgm_read_byte(&sine[phase >> 8]);				// ---Tone---------------
+	c = pgm_read_byte(&sine[(uint8_t)((phase >> 8) + 64)]);
+	if (count >= LOOPBACK_SETTLE) {
+		sumI += (int16_t)x * c;
+		sumQ += (int16_t)x * s;
+	}
+	OCR4B = LOOPBACK_IDLE + (((int16_t)s * LOOPBACK_AMPLITUDE) >> 7);
+	phase += step;
+	
+	if (++count == LOOPBACK_SETTLE + LOOPBACK_MEASURE) {
+		resultTone = step >> 4;
+		resultI = sumI;
+		resultQ = sumQ;
+		pending |= PENDING_TONE;
+		stage++;
+		count = 0;
+		sumI = 0;
+		sumQ = 0;
+		if (stage > LOOPBACK_TONES) {
+			OCR4B = LOOPBACK_IDLE;
+		} else {
+			phase = 0;
+			step = pgm_read_word(&tones[stage - 1]) << 4;
+		}
+	}
+}
+
+/**
+ * Function: loopback_poll
+ *
+ * Sends a waiting result if the console ring has room for it. When the
+ * last one has been sent the control task is posted to end the test.
+ * Call regularly from the main loop.
+ */
+void loopback_poll() {
+	uint16_t tone;
+	int32_t i, q;
+	uint8_t last;
+	
+	if (!pending) return;
+	
+	if (pending & PENDING_IMPULSE) {
+		if (serial_free() < TLM_FRAME(TLM_LOOPBACK_LENGTH)) return;
+		loopback_latency();
+		cli();
+		pending &= ~PENDING_IMPULSE;
+		sei();
+		return;
+	}
+	
+	if (serial_free() < TLM_FRAME(TLM_RESPONSE_LENGTH)) return;
+	cli();
+	tone = resultTone;
+	i = resultI;
+	q = resultQ;
+	pending &= ~PENDING_TONE;
+	last = (stage > LOOPBACK_TONES);
+	sei();
+	
+	telemetry_response((uint32_t)tone * loopbackRate / LOOPBACK_MEASURE, i, q);
+	if (last) sched_post(TASK_CONTROL);
+}
+
+/**
+ * Function: loopback_done
+ *
+ * Returns: True once the test has finished and every result was sent.
+ */
+uint8_t loopback_done() {
+	return stage > LOOPBACK_TONES && !pending;
+}
@@ -0,0 +1,29 @@
+/**
+ * loopback.h - EGB240DVR Library, Loopback self-test module header
+ *
+ * Measures the round-trip latency and magnitude response of the whole
+ * analogue chain with the PWM output (OC4B) wired to ADC0. Stimulus
+ * and capture both run in the ADC interrupt, one output and one input
+ * sample per conversion, so they are aligned to the sample.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef LOOPBACK_H_
+#define LOOPBACK_H_
+
+#define LOOPBACK_WINDOW		32		// Impulse response length (samples)
+#define LOOPBACK_REPEATS	32		// Impulses averaged
+#define LOOPBACK_SETTLE		512		// Samples before each tone is measured
+#define LOOPBACK_MEASURE	4096	// Samples measured per tone (whole cycles of every tone)
+#define LOOPBACK_AMPLITUDE	100		// Tone amplitude (PWM counts * 128 / 127)
+#define LOOPBACK_TONES		10		// Tones in the sweep
+
+void loopback_start(uint16_t rate);	// Starts the test (ADC not yet running), rate in samples per second
+void loopback_sample(uint8_t input);	// Takes one input sample and sets the next output (ADC ISR)
+void loopback_poll();				// Sends the next result when the console has room
+uint8_t loopback_done();			// True once the test has finished and every result was sent
+
+#endif /* LOOPBACK_H_ */
@@ -21,8 +21,52 @@
  * indicator that the programme is running; a 1 Hz, 50 % duty
  * cycle flash should be observed under normal operation.
  *
+ * Main loop work is split into tasks run by a cooperative priority
+ * scheduler (sched.c): SD card writes first, then read-ahead, control,
+ * metering, USB and logging. Tasks are posted by the interrupt service
+ * routines and the CPU sleeps (idle mode) while none are ready. The
+ * time spent asleep and each task's run time and deadline misses are
+ * reported at the end of each take. While not stopped, the CPU load
+ * (audio and timer ISRs, foreground work and idle time, see load.c) is
+ * reported every second.
+ *
+ * Recording and playback are supervised (supervisor.c). If no page has
+ * been committed to or from the SD card for SUPERVISOR_TIMEOUT, the card
+ * is reinitialised and a recording continues in a new segment file
+ * (e.g. "EGB24001.WAV"); playback resumes from the last page read. The
+ * hardware watchdog resets the unit if the main loop itself hangs, and
+ * an interrupted recording is then continued in a new segment. The open
+ * segment is synced to the card every SYNC_PAGES pages, so a reset or
+ * power loss loses at most the pages written since the last sync and the
+ * two pages in the buffer (17 KB, about 1.1 s at 15.625 kHz).
+ *
+ * Pressing record (or "pause") while recording pauses the take: sampling
+ * stops but the file stays open, synced so that it is valid on the card
+ * if power is lost. Pressing record (or "rec") again resumes instantly.
+ *
+ * After STANDBY_TIMEOUT stopped with no USB host and no activity (or on
+ * the "standby" command) the unit powers down (standby.c). Pressing
+ * record wakes it straight into recording; the SD card stays mounted
+ * and the time from wake to sampling is reported.
+ *
+ * The "pattern 1" command makes following takes record a known test
+ * sequence instead of the ADC (pattern.h). Every page is checked before
+ * it is written, and breaks in the sequence (lost or repeated samples)
+ * are reported with the take summary; tools/pattern.py checks the file.
+ *
+ * The "loopback" command runs a self-test with the PWM output wired to
+ * ADC0 (loopback.c): the round-trip latency and the response of the
+ * analogue chain to a sweep of tones are reported, then the unit stops.
+ *
+ * The "throughput" command benchmarks the record path (throughput.c):
+ * synthetic pages are streamed through wave_write at rising rates until
+ * a buffer deadline is missed, and the highest rate sustained for each
+ * page size, batch and alignment is reported.
+ *
  * A serial USB interface is provided as a secondary control and
- * debugging interface. Errors will be printed to this interface.
+ * debugging interface. Errors will be printed to this interface, and
+ * the recorder can be controlled remotely with the commands listed
+ * in shell.h.
  *
  * Version:				v1.4
  *    Date:				28/05/2017
@@ -44,6 +88,28 @@
 #include "wave.h"
 #include "buffer.h"
 #include "adc.h"
+#include "transfer.h"
+#include "telemetry.h"
+#include "log.h"
+#include "shell.h"
+#include "sched.h"
+#include "button.h"
+#include "supervisor.h"
+#include "load.h"
+#include "standby.h"
+#include "profile.h"
+#include "stack.h"
+#include "playback.h"
+#include "pattern.h"
+#include "record.h"
+#include "loopback.h"
+#include "throughput.h"
+
+#if defined(USB_MSC_MODE)
+#include "lib/usb_msc/usb_msc.h"
+#elif defined(USB_AUDIO_MODE)
+#include "lib/usb_audio/usb_audio.h"
+#endif
 
 /************************************************************************/
 /* MACROS to use in the code	                                        */
@@ -54,21 +120,63 @@
 #define BIT_IS_SET(byte, bit) (byte & (1 << bit))  // check to see if 
 												   //     the bit is set or not
 
+#define PRESSED(b) (button == (BUTTON_PRESS | (b)))   // check for a debounced press event
+												   //     of button b (see button.h)
+
 #define TOP 255									   // Init 0xFF 
 #define pageSize 512							   // Init Size of the Page
 
+#define PWM_RATE 62500							   // Timer4 overflow (PWM ISR) rate in Hz
+#define SPEAKER_TARGET 512						   // Speaker ring fill level tracked by rate control
+#define SPEAKER_CHUNK 16						   // Bytes moved from USB to the ring per loop
+#define SPEAKER_TIMEOUT 7813					   // Stream ends after 500 ms without data (ticks)
+#define SYNC_PAGES 32							   // Recording is synced to the card every 32 pages (16 KB)
+
+// Task deadlines in Timer0 ticks (64 us) from post to completion
+#define PAGE_TICKS(rate) ((uint32_t)pageSize * TIMER_TICKS_PER_SEC / (rate))	// One page of samples
+#define DEADLINE_CONTROL 1563					   // 100 ms
+#define DEADLINE_METER 15625					   // 1 s
+#define DEADLINE_USB 156						   // 10 ms
+#define DEADLINE_LOG 1563						   // 100 ms
+
+#define STANDBY_TIMEOUT 937500UL				   // Stopped this long without activity: standby (60 s)
+
+// Every take summary frame must fit in the console ring on its own (TLM_TASKS is the largest)
+#if TLM_FRAME(TLM_TASKS_LENGTH(TASK_COUNT)) > SERIAL_TX_SIZE - 1 || TLM_FRAME(TLM_PATTERN_LENGTH) > SERIAL_TX_SIZE - 1
+#error "Take summary frame larger than the console transmit ring"
+#endif
+
 /************************************************************************/
 /* ENUM DEFINITIONS                                                     */
 /************************************************************************/
 enum {
 	DVR_STOPPED,
 	DVR_RECORDING,
-	DVR_PLAYING
+	DVR_PLAYING,
+	DVR_MIC,						// Streaming ADC samples to a USB audio host
+	DVR_SPEAKER,					// Playing PCM streamed by a USB serial host
+	DVR_PAUSED,						// Recording paused, file still open
+	DVR_LOOPBACK,					// Loopback self-test (OC4B wired to ADC0)
+	DVR_THROUGHPUT					// SD card throughput benchmark
+};
+
+// Frames of the take summary, in the order they are sent
+enum {
+	SUMMARY_STATS,
+	SUMMARY_LATENCY,
+	SUMMARY_IDLE,
+	SUMMARY_TASKS,
+	SUMMARY_MEMORY,
+	SUMMARY_PATTERN,				// Only in test pattern mode
+	SUMMARY_DONE					// Nothing left to send
 };
 
 /************************************************************************/
 /* GLOBAL VARIABLES                                                     */
 /************************************************************************/
+uint8_t state = DVR_STOPPED;		// State of the DVR state machine
+uint8_t shellRequest = SHELL_NONE;	// Remote command waiting for TASK_CONTROL
+
 volatile uint16_t pageCount = 0;	// Page counter - used to terminate recording
 volatile uint16_t newPage = 0;		// Flag that indicates a new page 
 									//					is available for read/write
@@ -77,19 +185,42 @@ volatile uint8_t stop = 0;			// Flag that indicates playback/recording
 
 // Personal global variables for playback
 volatile uint32_t data_amount = 0;	// Amount of samples used to play
-volatile uint8_t played = 1;		// Flag used in interrupt for Ini
-volatile uint8_t first_que = 0;		// First sample
-volatile uint8_t second_que = 0;	// Next sample
-volatile uint8_t first_played = 0;	// Flag indicates if first sample was played
-volatile uint8_t second_played = 0;	// Flag indicates if second sample was played
-volatile int count = 0;				// Flag indicates skip every second interupt
 
 volatile int debaunce_counter = 0;				// Flag indicates skip every second interupt
+
+// SD card access statistics (reported via telemetry at the end of a take)
+uint16_t sdPages = 0;				// Pages written/read in the current take
+uint16_t sdMaxTicks = 0;			// Worst case page access time (64 us ticks)
+uint16_t sdCommitted = 0;			// Pages successfully written/read in the current take
+
+// Continuation file of the current recording (kept across a watchdog reset, see wave_segment)
+uint8_t takeSegment __attribute__((section(".noinit")));
+
+volatile uint8_t pwmLatencyMax = 0;	// Latest PWM ISR entry after overflow (cycles)
+
+uint32_t loadLast = 0;				// Tick count of the last CPU load report
+uint8_t summaryNext = SUMMARY_DONE;	// Next take summary frame to send (SUMMARY_*)
+uint32_t lastActivity = 0;			// Tick count of the last button, command or state change
+
+uint16_t sampleRate = ADC_RATE_DEFAULT;	// Recording sample rate (set with shell "rate")
+uint8_t patternMode = 0;				// Flag: record the test pattern (set with shell "pattern")
+
+// Speaker mode (PCM streamed over USB serial, played by the PWM ISR)
+volatile uint8_t speaker = 0;				// Flag: PWM ISR plays the streamed ring
+volatile uint16_t speakerPhase = 0;			// Phase accumulator, a sample is due on each wrap
+volatile uint16_t speakerStep = 0;			// Phase increment per PWM ISR (adapted to host clock)
+volatile uint16_t speakerUnderruns = 0;		// Times the ring ran empty while playing
+volatile uint8_t speakerEmpty = 0;			// Flag: ring is empty (counts each underrun once)
+uint16_t speakerOverruns = 0;				// Times the ring was full with host data waiting
+uint8_t speakerFull = 0;					// Flag: ring is full (counts each overrun once)
+uint32_t speakerLast = 0;					// Tick count when data was last received
 /************************************************************************/
 /* FUNCTION PROTOTYPES                                                  */
 /************************************************************************/
 void pageFull();
 void pageEmpty();
+void pageMic();
+void pageStream();
 
 /************************************************************************/
 /* INITIALISATION FUNCTIONS                                             */
@@ -110,7 +241,7 @@ void clock_init() {
 void hardware_setup (){
 	// clear the bit and set the button pins as input (1= output && 0=input)		
 	DDRD |= 0b11110000;			// LEDS
-	DDRF &= ~0b11110000;		// Buttons
+	button_init();				// Buttons
 }
 
 // Initialize PWM state. Sets Prescaler to 8
@@ -135,10 +266,12 @@ void stop_pwm(){
 // Initialize DVR subsystems and enable interrupts
 void init() {
 	cli();						// Disable interrupts
+	supervisor_init();			// Disarm the watchdog (enabled after a watchdog reset)
 	clock_init();				// Configure clocks
 	pll_init();					// Configure PLL (used by Timer4 and USB serial)
 	serial_init();				// Initialize USB serial interface (debug)
 	timer_init();				// Initialize timer (used by FatFs library)
+	sched_init();				// Initialize scheduler (idle sleep, cycle counter)
 	hardware_setup();			// Initialize Button with LEDs
 	set_pwm();
 	buffer_init(pageFull,
@@ -160,8 +293,10 @@ void pageFull() {
 		// If all pages have been read
 		adc_stop();				// Stop recording (disable new ADC conversions)
 		stop = 1;				// Flag recording complete
+		sched_post(TASK_SD_WRITE);	// Write final page
 	} else {
 		newPage = 1;			// Flag new page is ready to write to SD card
+		sched_post(TASK_SD_WRITE);	// Write page
 	}
 }
 
@@ -169,125 +304,651 @@ void pageFull() {
 void pageEmpty() {
 	if (data_amount > (6*pageSize)) {	// If Data reached final 2 page
 		newPage = 1;
+		sched_post(TASK_SD_READ);		// Read ahead next page
 	}	
 }
 
+// CALLED FROM BUFFER MODULE WHILE STREAMING TO A USB AUDIO HOST
+void pageMic() {
+	// Samples are consumed byte-wise by the USB start of frame
+	// interrupt, nothing to do on page boundaries
+}
+
+// CALLED FROM BUFFER MODULE WHILE PLAYING A USB SPEAKER STREAM
+void pageStream() {
+	// Samples are produced in blocks by the main loop and consumed
+	// byte-wise by the PWM interrupt, nothing to do on page boundaries
+}
+
 /************************************************************************/
 /* RECORD/PLAYBACK ROUTINES                                             */
 /************************************************************************/
 
-// Initiates a record cycle
-void dvr_record() {
+// Claims the SD card for recording/playback. If the card was written
+// by a USB mass storage host, the file system is remounted first.
+void dvr_claim_card() {
+#ifdef USB_MSC_MODE
+	if (usb_msc_changed()) {
+		wave_init();			// Cached file system state is stale
+	}
+#endif
+}
+
+// Writes the oldest buffer page to the SD card, timing the access
+void dvr_write_page() {
+	uint32_t start = timer_ticks();
+	uint16_t ticks;
+	
+	if (!record_page(pageSize, patternMode)) {		// Pattern checked in pattern mode
+		sdCommitted++;
+		supervisor_commit();	// Page is on the card
+		if (sdCommitted % SYNC_PAGES == 0) {
+			wave_sync();		// Header and file size valid if the unit is reset
+		}
+	}
+	
+	ticks = timer_ticks() - start;
+	if (ticks > sdMaxTicks) sdMaxTicks = ticks;
+	sdPages++;
+	telemetry_sd(TLM_SD_WRITE, ticks);
+}
+
+// Reads the next page of samples from the SD card, timing the access
+void dvr_read_page() {
+	uint32_t start = timer_ticks();
+	uint16_t ticks;
+	
+	if (!wave_read(buffer_writePage(), pageSize)) {
+		sdCommitted++;
+		supervisor_commit();	// Page is in the buffer
+	}
+	
+	ticks = timer_ticks() - start;
+	if (ticks > sdMaxTicks) sdMaxTicks = ticks;
+	sdPages++;
+	telemetry_sd(TLM_SD_READ, ticks);
+}
+
+/**
+ * Function: dvr_report_summary
+ *
+ * Sends the next frames of the take summary (see task_meter) while the
+ * console ring has room for them. The whole summary does not fit in
+ * the ring at once, so the rest is sent by TASK_LOG after each flush.
+ * Each measurement is read and reset as its frame is sent.
+ */
+void dvr_report_summary() {
+	const PATTERN_RESULT* check;
+	SCHED_STATS stats;
+	uint16_t maxRun[TASK_COUNT];
+	uint8_t misses[TASK_COUNT];
+	uint16_t adcMin, adcMax;
+	uint8_t id;
+	
+	while (summaryNext != SUMMARY_DONE) {
+		switch (summaryNext) {
+			case SUMMARY_STATS:						// SD card access summary
+				if (serial_free() < TLM_FRAME(TLM_STATS_LENGTH)) return;
+				telemetry_stats(sdPages, sdMaxTicks);
+				break;
+			case SUMMARY_LATENCY:					// Audio ISR latency
+				if (serial_free() < TLM_FRAME(TLM_LATENCY_LENGTH)) return;
+				adc_latency(&adcMin, &adcMax);
+				telemetry_latency(adcMin, adcMax, pwmLatencyMax);
+				pwmLatencyMax = 0;
+				break;
+			case SUMMARY_IDLE:						// CPU idle time
+				if (serial_free() < TLM_FRAME(TLM_IDLE_LENGTH)) return;
+				telemetry_idle(sched_idle());
+				break;
+			case SUMMARY_TASKS:						// Task run times and deadline misses
+				if (serial_free() < TLM_FRAME(TLM_TASKS_LENGTH(TASK_COUNT))) return;
+				for (id = 0; id < TASK_COUNT; id++) {
+					sched_stats(id, &stats);
+					maxRun[id] = stats.maxRun;
+					misses[id] = stats.misses > 255 ? 255 : stats.misses;
+				}
+				telemetry_tasks(maxRun, misses, TASK_COUNT);
+				break;
+			case SUMMARY_MEMORY:					// RAM budget, stack high-water mark
+				if (serial_free() < TLM_FRAME(TLM_MEMORY_LENGTH)) return;
+				telemetry_memory(stack_static(), stack_max(), stack_free());
+				break;
+			case SUMMARY_PATTERN:					// Test pattern check
+				if (!patternMode) break;
+				if (serial_free() < TLM_FRAME(TLM_PATTERN_LENGTH)) return;
+				check = pattern_result();
+				telemetry_pattern(check->pages, check->breaks, check->lost, check->unresolved, check->first);
+				break;
+		}
+		summaryNext++;
+	}
+}
+
+// Reports the CPU load since the last report
+void dvr_report_load() {
+	uint16_t permille[LOAD_COUNT];
+	
+	loadLast = timer_ticks();
+	load_measure(permille);
+	telemetry_load(permille, LOAD_COUNT);
+}
+
+// Starts a speaker stream. Playback begins once the ring is half full.
+void dvr_speaker_start() {
+	buffer_init(pageStream, pageStream);		// Stream ring, no page handling
+	speakerStep = ((uint32_t)sampleRate << 16) / PWM_RATE;	// Nominal samples per PWM period
+	speakerPhase = 0;
+	speakerUnderruns = 0;
+	speakerEmpty = 0;
+	speakerOverruns = 0;
+	speakerFull = 0;
+	speakerLast = timer_ticks();
+	OCR4B = 0x80;								// Silence until primed
+}
+
+// Moves streamed samples into the ring and adapts the playback rate.
+// Returns true when the stream has ended.
+uint8_t dvr_speaker_service() {
+	uint8_t chunk[SPEAKER_CHUNK];
+	uint16_t space, n, level, step;
+	
+	space = buffer_space();
+	if (space) {
+		n = serial_read(chunk, space < SPEAKER_CHUNK ? space : SPEAKER_CHUNK);
+		if (n) {
+			buffer_put(chunk, n);
+			speakerLast = timer_ticks();
+			speakerFull = 0;
+		}
+	} else if (serial_available()) {
+		if (!speakerFull) speakerOverruns++;	// Host ahead of playback clock
+		speakerFull = 1;
+		speakerLast = timer_ticks();
+	}
+	
+	level = 1023 - buffer_space();
+	if (!speaker) {
+		if (level >= SPEAKER_TARGET) {			// Primed, start playing
+			speaker = 1;
+			start_pwm();
+		}
+	} else {
+		// Proportional rate control: play faster when the ring fills
+		// (host clock fast), slower when it drains (host clock slow)
+		step = ((uint32_t)sampleRate << 16) / PWM_RATE + ((int16_t)level - SPEAKER_TARGET) / 2;
+		cli();
+		speakerStep = step;
+		sei();
+	}
+	
+	return (timer_ticks() - speakerLast) > SPEAKER_TIMEOUT;
+}
+
+// Ends a speaker stream and reports its statistics
+void dvr_speaker_stop() {
+	stop_pwm();
+	speaker = 0;
+	buffer_init(pageFull, pageEmpty);			// Restore record/playback callbacks
+	telemetry_stream(speakerUnderruns, speakerOverruns);
+}
+
+// Starts the loopback self-test. The ADC ISR sets the PWM output for
+// each sample (see loopback.c), so the PWM interrupt stays disabled.
+void dvr_loopback_start() {
+	adc_pattern(0);				// Real input (the pattern is restored by dvr_record)
+	loopback_start(sampleRate);	// Takes the buffer
+	OCR4B = 0x80;				// Idle output
+	TCCR4A = 0x21;				// OC4B on, no PWM interrupt
+	adc_loopback(1);
+	adc_start();				// Begin sampling
+}
+
+// Ends the loopback self-test
+void dvr_loopback_stop() {
+	adc_stop();
+	adc_loopback(0);			// Results go to the buffer again
+	stop_pwm();
+	buffer_reset();
+}
+
+// Returns the next continuation segment of the current recording
+uint8_t dvr_next_segment() {
+	return (takeSegment >= 99) ? 1 : takeSegment + 1;
+}
+
+// Initiates a record cycle into the given segment (0: the selected file)
+void dvr_record(uint8_t segment) {
 	buffer_reset();				// Reset buffer state
 	
-	pageCount = 305;			// Maximum record time of 10 sec
+	pageCount = (uint32_t)sampleRate * 10 / pageSize;	// Maximum record time of 10 sec
 	newPage = 0;				// Clear new page flag
+	sdPages = 0;				// Clear SD access statistics
+	sdMaxTicks = 0;
+	sdCommitted = 0;
+	sched_idle();				// Start CPU idle measurement
 	
+	if (segment == 0) {			// New take (continuation segments keep the sequence)
+		adc_pattern(patternMode);	// Test pattern or ADC samples
+		pattern_reset();
+	}
+	takeSegment = segment;
+	wave_segment(segment);		// Select file (or continuation) to record
+	dvr_claim_card();			// Remount SD card if changed over USB
 	wave_create();				// Create new wave file on the SD card
+	supervisor_start(DVR_RECORDING);	// Supervise the write pipeline
 	adc_start();				// Begin sampling
 
 	SET_BIT (PORTD, PD1);		// turn on the first led
-	PORTD &= 0b00001111;		// turn other LEDs off
 }
 
 
+/************************************************************************/
+/* STATE TRANSITIONS                                                    */
+/************************************************************************/
+
+// Enters a new state: updates the LEDs and reports the transition
+void dvr_enter(uint8_t newState) {
+	uint16_t permille[LOAD_COUNT];
+	
+	if (state == DVR_STOPPED && newState != DVR_STOPPED) {
+		load_measure(permille);					// Start load measurement, discard the idle interval
+		loadLast = timer_ticks();
+	}
+	state = newState;
+	lastActivity = timer_ticks();
+	
+	PORTD &= 0b00001111;						// Turn all LEDs off
+	switch (state) {
+		case DVR_STOPPED:
+		case DVR_MIC:
+			PORTD |= 0b01000000;				// Turn LED3 on
+			break;
+		case DVR_RECORDING:
+			PORTD |= 0b00100000;				// Turn LED2 on
+			break;
+		case DVR_PAUSED:
+			PORTD |= 0b01100000;				// Turn LED2 and LED3 on
+			break;
+		default:
+			PORTD |= 0b00010000;				// Turn LED1 on (playback, speaker)
+			break;
+	}
+	
+	telemetry_state(state);
+}
+
+// Starts playback of the selected file
+void dvr_play() {
+	buffer_reset();
+	newPage = 0;
+	stop = 0;
+	sdPages = 0;				// Clear SD access statistics
+	sdMaxTicks = 0;
+	sdCommitted = 0;
+	sched_idle();				// Start CPU idle measurement
+	dvr_claim_card();			// Remount SD card if changed over USB
+	wave_segment(0);			// Play the selected file
+	data_amount = wave_open ()*PLAYBACK_PWM_PER_SAMPLE+1;	// Open the file to read not VOID function
+	playback_reset();			// Fetch a fresh pair of samples first
+	
+	dvr_read_page();			// Feel first page with samples
+	dvr_read_page();			// Feels second page with samples
+	supervisor_start(DVR_PLAYING);	// Supervise the read pipeline
+	start_pwm();				// Start PWM
+}
+
+// Pauses a recording. The file stays open and the samples of the
+// partially filled page stay in the buffer, to be continued on resume.
+void dvr_pause() {
+	adc_stop();					// Stop sampling
+	supervisor_stop();			// Nothing to commit while paused
+	if (newPage) {				// Write a page that filled before the pause
+		newPage = 0;
+		dvr_write_page();
+	}
+	wave_sync();				// Header and file size valid if power is lost
+}
+
+// Resumes a paused recording (no SD card access)
+void dvr_resume() {
+	supervisor_start(DVR_RECORDING);	// Supervise the write pipeline
+	adc_start();				// Continue sampling into the same page
+}
+
+// Powers down until the record button is pressed, then starts recording.
+// USB is attached again once sampling has started.
+void dvr_standby() {
+	uint32_t wake;
+	uint16_t ticks;
+	
+	PORTD &= 0b00001111;		// Turn all LEDs off (including LED4)
+	standby_enter();
+	
+	wake = timer_ticks();
+	dvr_record(0);				// SD card is still mounted
+	dvr_enter(DVR_RECORDING);
+	ticks = timer_ticks() - wake;
+	
+	serial_init();				// Attach USB (host enumerates in the background)
+	telemetry_wake(ticks);
+}
+
+// Recovers a stalled pipeline: reinitialises the SD card, then continues
+// a recording in the next segment file, or playback from the last page read
+void dvr_recover() {
+	telemetry_error(TLM_SRC_SUPERVISOR, state);
+	supervisor_start(state);	// Re-arm the watchdog for the recovery itself
+	
+	if (state == DVR_RECORDING) {
+		wave_close();			// Keep the pages already written, if the card allows
+		wave_init();			// Reinitialise the card and remount
+		takeSegment = dvr_next_segment();
+		wave_segment(takeSegment);
+		wave_create();			// Continue the take in a new file
+		newPage = 0;			// Pages in flight were overwritten by the ADC
+	} else {
+		wave_init();			// Reinitialise the card and remount
+		wave_open();
+		wave_seek((uint32_t)sdCommitted * pageSize);	// Continue after the last page read
+	}
+	
+	log_write(LOG_STALL, state, takeSegment);
+	supervisor_start(state);	// Restart the stall timer
+}
+
+/************************************************************************/
+/* TASKS (RUN BY THE SCHEDULER IN PRIORITY ORDER, SEE sched.h)          */
+/************************************************************************/
+
+// TASK_SD_WRITE: writes full pages to the SD card, finalises the take
+void task_sd_write() {
+	if (state == DVR_THROUGHPUT) {				// ---Benchmark: next synthetic batch when due---
+		if (throughput_poll()) {				// Table complete
+			throughput_stop();
+			dvr_enter(DVR_STOPPED);				// Transition to stopped state
+		}
+		return;
+	}
+	if (state != DVR_RECORDING) return;
+	
+	if (newPage) {								// ---Write samples to SD card when buffer page is full---
+		newPage = 0;							// Acknowledge new page flag
+		dvr_write_page();
+	}
+	if (stop) {									// ---Stop is flagged when the last page has been recorded---
+		stop = 0;								// Acknowledge stop flag
+		dvr_write_page();						// Write final page
+		wave_close();							// Finalize WAVE file 
+		supervisor_stop();						// Take complete, disarm the watchdog
+		dvr_enter(DVR_STOPPED);					// Transition to stopped state
+		sched_post(TASK_METER);					// Report take summary
+	}
+}
+
+// TASK_SD_READ: reads the next page ahead of playback, finalises playback
+void task_sd_read() {
+	if (state != DVR_PLAYING) return;
+	
+	if (stop) {									//---- Finalize Playback------
+		stop = 0;
+		stop_pwm();								// Stops PWM
+		wave_close ();							// close the file after reading
+		supervisor_stop();						// Playback complete, disarm the watchdog
+		dvr_enter(DVR_STOPPED);					// Transition to stopped state
+		sched_post(TASK_METER);					// Report playback summary
+	} else if (newPage) {						// ------Page is reeded
+		newPage = 0;
+		dvr_read_page();						// Writes next page
+	}
+}
+
+// TASK_SUPERVISE: recovers a stalled record/playback pipeline, enters
+// standby when idle (posted by the ~1 ms tick, and by the watchdog interrupt)
+void task_supervise() {
+	if (supervisor_stalled() && (state == DVR_RECORDING || state == DVR_PLAYING)) {
+		dvr_recover();
+	} else if (state == DVR_STOPPED && !serial_ready() && (timer_ticks() - lastActivity) > STANDBY_TIMEOUT) {
+		dvr_standby();							// No host and nothing to do
+	} else if (state == DVR_THROUGHPUT) {
+		sched_post(TASK_SD_WRITE);				// Pace the benchmark writes
+	}
+}
+
+// TASK_CONTROL: acts on button events and remote commands
+void task_control() {
+	uint8_t button = button_get();				// Next button event (0 if none)
+	uint8_t request = shellRequest;				// Remote command (SHELL_NONE if none)
+	uint16_t rate;
+	
+	shellRequest = SHELL_NONE;
+	if (button || request != SHELL_NONE) lastActivity = timer_ticks();
+	
+	// Requests that do not depend on the state
+	switch (request) {
+		case SHELL_FILE:
+			if (state == DVR_STOPPED && shell_argument()[0]) {
+				wave_select(shell_argument());			// Select file for record/play
+				shell_reply(1);
+			} else {
+				shell_reply(0);
+			}
+			break;
+		case SHELL_RATE:
+			if (state == DVR_STOPPED && (rate = adc_set_rate(shell_value()))) {
+				sampleRate = rate;						// Achieved rate (Timer1 rounding)
+				wave_set_samplerate(sampleRate);		// Rate written to new WAVE headers
+				sched_task(TASK_SD_WRITE, task_sd_write, PAGE_TICKS(sampleRate));
+				shell_reply(1);
+			} else {
+				shell_reply(0);
+			}
+			break;
+		case SHELL_STATS:
+			sched_post(TASK_METER);						// Summary of the last take
+			break;
+		case SHELL_PROFILE:
+			shell_reply(profile_request());				// Table follows (sent by TASK_LOG)
+			break;
+		case SHELL_PATTERN:
+			if (state == DVR_STOPPED) {
+				patternMode = (shell_value() != 0);		// Applies from the next take
+				shell_reply(1);
+			} else {
+				shell_reply(0);
+			}
+			break;
+		case SHELL_TRANSFER:
+#if !defined(USB_MSC_MODE) && !defined(USB_AUDIO_MODE)
+			if (state == DVR_STOPPED) {
+				transfer_frame();						// Serve one file transfer frame
+			} else {
+				transfer_busy();						// SD card and buffer in use
+			}
+#endif
+			break;
+	}
+	if (button == (BUTTON_LONG | BUTTON_STOP)) {		// Hold stop: report statistics
+		sched_post(TASK_METER);
+	}
+	
+	// Switch depending on state
+	switch (state) {
+		case DVR_STOPPED:
+			if ( PRESSED(BUTTON_RECORD) || request == SHELL_RECORD ) {	// -----STARTING THE RECORDING----
+				dvr_record(0);							// Initiate recording
+				dvr_enter(DVR_RECORDING);				// Transition to "recording" state
+			} else if ( PRESSED(BUTTON_PLAY) || request == SHELL_PLAY ) {	// -------STARTING PLAYBACK-------
+				dvr_enter(DVR_PLAYING);					// Transition to "Playing" state
+				dvr_play();
+#if !defined(USB_MSC_MODE) && !defined(USB_AUDIO_MODE)
+			} else if ( request == SHELL_STANDBY ) {	// ---Power down until record------
+				shell_reply(1);
+				serial_flush();							// Best effort, USB is detached next
+				dvr_standby();
+			} else if ( request == SHELL_SPEAKER ) {	// ---Host streams audio---------
+				dvr_speaker_start();					// Prime the stream ring
+				shell_reply(1);							// Host may start sending PCM
+				dvr_enter(DVR_SPEAKER);					// Transition to "speaker" state
+				sched_post(TASK_USB);
+			} else if ( request == SHELL_LOOPBACK ) {	// ---Self-test, OC4B wired to ADC0---
+				shell_reply(1);							// Results follow as telemetry
+				dvr_loopback_start();
+				dvr_enter(DVR_LOOPBACK);				// Transition to "loopback" state
+			} else if ( request == SHELL_THROUGHPUT ) {	// ---SD card benchmark----------
+				shell_reply(1);							// Table follows as telemetry
+				dvr_claim_card();						// Remount SD card if changed over USB
+				throughput_start();
+				dvr_enter(DVR_THROUGHPUT);				// Transition to "throughput" state
+#endif
+			}
+			break;
+		case DVR_RECORDING:
+			if ( PRESSED(BUTTON_STOP) || request == SHELL_STOP ) {	// --- STOP REcording on Button Press--
+				PORTD &= 0b00001111;					// Turn all LEDs off
+				PORTD |= 0b00010000;					// Turn LED1 on					
+				pageCount = 1;							// Finish recording last page									
+			} else if ( (PRESSED(BUTTON_RECORD) || request == SHELL_PAUSE) && pageCount > 1 ) {	// ---Pause (unless stopping)---
+				dvr_pause();
+				dvr_enter(DVR_PAUSED);					// Transition to "paused" state
+			}
+			break;
+		case DVR_PAUSED:
+			if ( PRESSED(BUTTON_RECORD) || request == SHELL_RECORD ) {	// ---Resume recording----------
+				dvr_resume();
+				dvr_enter(DVR_RECORDING);				// Transition to "recording" state
+			} else if ( PRESSED(BUTTON_STOP) || request == SHELL_STOP ) {	// ---Stop while paused---------
+				wave_close();							// Finalize WAVE file (partial page is dropped)
+				dvr_enter(DVR_STOPPED);					// Transition to stopped state
+				sched_post(TASK_METER);					// Report take summary
+			}
+			break;
+		case DVR_PLAYING:
+			if ( PRESSED(BUTTON_STOP) || request == SHELL_STOP ) {	// ---- Stops PLayback------
+				stop = 1;								// Sets stop flag
+				newPage = 0;							// Finalize page
+				stop_pwm();								// Stops PWM
+				sched_post(TASK_SD_READ);				// Finalize playback
+			}
+			break;
+#if !defined(USB_MSC_MODE) && !defined(USB_AUDIO_MODE)
+		case DVR_SPEAKER:
+			if ( PRESSED(BUTTON_STOP) ) {				// ---Stream stopped--------------
+				dvr_speaker_stop();
+				dvr_enter(DVR_STOPPED);					// Transition to stopped state
+			}
+			break;
+#endif
+		case DVR_LOOPBACK:
+			if ( PRESSED(BUTTON_STOP) || request == SHELL_STOP || loopback_done() ) {	// ---Test complete or stopped---
+				dvr_loopback_stop();
+				dvr_enter(DVR_STOPPED);					// Transition to stopped state
+			}
+			break;
+		case DVR_THROUGHPUT:
+			if ( PRESSED(BUTTON_STOP) || request == SHELL_STOP ) {	// ---Benchmark stopped----------
+				throughput_stop();
+				dvr_enter(DVR_STOPPED);					// Transition to stopped state
+			}
+			break;
+		case DVR_MIC:
+			break;										// Controlled by the USB audio host
+		default:
+			// Invalid state, return to valid idle state (stopped)
+			telemetry_error(TLM_SRC_MAIN, state);
+			dvr_enter(DVR_STOPPED);
+			break;
+	}
+}
+
+// TASK_METER: starts the take summary: measurements, task accounting and RAM use
+void task_meter() {
+	summaryNext = SUMMARY_STATS;
+	dvr_report_summary();						// As much as fits now, TASK_LOG sends the rest
+}
+
+// TASK_USB: services the USB port (posted by the ~1 ms tick)
+void task_usb() {
+#if defined(USB_MSC_MODE)
+	if (state == DVR_STOPPED) {
+		usb_msc_task(buffer_block());			// Serve one SCSI command
+		sched_post(TASK_USB);					// Service the bulk endpoints continuously
+	} else {
+		usb_msc_task(0);						// Card in use, report medium not present
+	}
+#elif defined(USB_AUDIO_MODE)
+	if (state == DVR_STOPPED && usb_audio_streaming()) {	// ---Host opened the microphone---
+		buffer_init(pageMic, pageMic);			// Capture ring, no page handling
+		usb_audio_source(buffer_level,
+						   buffer_dequeue);		// Feed isochronous packets
+		adc_start();							// Begin sampling
+		dvr_enter(DVR_MIC);						// Transition to "microphone" state
+	} else if (state == DVR_MIC && !usb_audio_streaming()) {	// ---Host closed the microphone---
+		adc_stop();								// Stop sampling
+		usb_audio_source(0, 0);					// Detach capture ring
+		buffer_init(pageFull,
+					   pageEmpty);				// Restore record/playback callbacks
+		dvr_enter(DVR_STOPPED);					// Transition to stopped state
+	}
+#else
+	uint8_t request;
+	
+	if (state == DVR_SPEAKER) {					// Serial input is audio while streaming
+		if (dvr_speaker_service()) {			// ---Stream ended--------------
+			dvr_speaker_stop();
+			dvr_enter(DVR_STOPPED);				// Transition to stopped state
+		} else {
+			sched_post(TASK_USB);				// Service the bulk endpoint continuously
+		}
+		return;
+	}
+	
+	request = shell_poll();						// Check for remote commands (non-blocking)
+	if (request != SHELL_NONE) {
+		shellRequest = request;
+		sched_post(TASK_CONTROL);				// Runs before the shell is polled again
+	}
+#endif
+}
+
+// TASK_LOG: moves log records, load reports and console output to the USB port
+void task_log() {
+	if (state != DVR_STOPPED && (timer_ticks() - loadLast) >= TIMER_TICKS_PER_SEC) {
+		dvr_report_load();						// Once a second during a take
+	}
+	log_flush();								// Queue deferred log records
+	dvr_report_summary();						// Queue the rest of the take summary
+	profile_poll();								// Queue the next requested ISR profile row
+	loopback_poll();							// Queue the next loopback result
+	serial_flush();								// Send queued console output (non-blocking)
+}
+
 /************************************************************************/
 /* MAIN LOOP (CODE ENTRY)                                               */
 /************************************************************************/
 int main(void) {
-	uint8_t state = DVR_STOPPED;// Start DVR in stopped state	
 	// Initialization
 	init();	
-	PORTD &= 0b00001111;		// turn other LEDs off
-	// Loop forever (state machine)
 	stop_pwm();
-    for(;;) {		
-		// Switch depending on state
-		switch (state) {
-			case DVR_STOPPED:
-				PORTD &= 0b00001111;					// Turn all LEDs off
-				PORTD |= 0b01000000;					// Turn LED 3				
-				if ( BIT_IS_SET (~PINF, PF5 ) ) {			// -----STARTING THE RECORDING----
-					PORTD |= 0b10000000;					// Turn LED2 on				
-					
-					printf("Recording started...");			// Output status to console
-					dvr_record();							// Initiate recording
-					state = DVR_RECORDING;					// Transition to "recording" state
-				 }											// -------------------------------
-				 if ( BIT_IS_SET (~PINF, PF4 ) ) {			// -------STARTING PLAYBACK-------
-				 	 PORTD &= 0b00001111;					// Turn all LEDs off
-					 //PORTD |= 0b01000000;					// turn LED3 on
-					 PORTD |= 0b00010000;					// turn LED1 on
-					 printf("Preparing file\n");			// Output status to console
-					 buffer_reset();
-					 newPage = 0;
-					 data_amount = wave_open ()*4+1;		// Open the file to read not VOID function
-					 
-					 wave_read (buffer_writePage(),
-											   pageSize);   // Feel first page with samples
-					 wave_read (buffer_writePage(),
-											   pageSize);   // Feels second page with samples
-					 start_pwm();							// Start PWM					 
-					 state = DVR_PLAYING;					// Transition to "Playing" state
-				 }											// ----------------------------------
-				break;
-			case DVR_RECORDING:
-				PORTD |= 0b00100000;						// Keeps LED2 turn on
-				if ( BIT_IS_SET (~PINF, PF6) ) {			// --- STOP REcording on Button Press--
-					PORTD &= 0b00001111;					// Turn all LEDs off
-					PORTD |= 0b00010000;					// Turn LED1 on					
-					pageCount = 1;							// Finish recording last page									
-				}											// ----------------------------------
-			
-				if (newPage) {								// ---Write samples to SD card when buffer page is full---
-					newPage = 0;							// Acknowledge new page flag
-					wave_write(buffer_readPage(), pageSize);
-				} else if (stop) {							// ---Stop is flagged when the last page has been recorded---
-					stop = 0;								// Acknowledge stop flag
-					wave_write(buffer_readPage(),
-												 pageSize);	// Write final page
-					wave_close();							// Finalize WAVE file 
-					printf("Recording COMPLETE!\n");		// Print status to console
-					while(BIT_IS_SET (~PINF, PF5 ));
-					state = DVR_STOPPED;					// Transition to stopped state
-				}											// --------------------------------------------------------
-				break;
-			case DVR_PLAYING:
-				PORTB |= 0b01000000;						// Keeps LED3 turn on
-				
-				if ( BIT_IS_SET (~PINF, PF6) ) {			// ---- Stops PLayback------
-					PORTD &= 0b00001111;					// turn other LEDs off
-					PORTD |= 0b00010000;					// turn LED1 on
-					
-					stop = 1;								// Sets stop flag
-					newPage = 0;							// Finalize page
-					stop_pwm();								// Stops PWM
-				}											// --------------------------				
-				if(newPage){								// ------Page is reeded
-					newPage = 0;					
-					wave_read (buffer_writePage(), 
-												pageSize);  // Writes next page
-				}											//---------------------------
-				else if(stop) {								//---- Finalize Playback------
-					
-					stop = 0;					
-					wave_close ();							// close the file after reading
-					printf("DONE!");
-					while(BIT_IS_SET (~PINF, PF4 ));
-					state = DVR_STOPPED;					// Transition to stopped state
-				}											//-----------------------------
-				
-				break;
-			default:
-				// Invalid state, return to valid idle state (stopped)
-				printf("ERROR: State machine in main entered invalid state!\n");
-				state = DVR_STOPPED;
-				break;
-
-		} // END switch(state)
-			
-	} // END for(;;)
-
+	
+	sched_task(TASK_SD_WRITE, task_sd_write, PAGE_TICKS(sampleRate));
+	sched_task(TASK_SD_READ, task_sd_read, PAGE_TICKS(ADC_RATE_DEFAULT));
+	sched_task(TASK_SUPERVISE, task_supervise, DEADLINE_CONTROL);
+	sched_task(TASK_CONTROL, task_control, DEADLINE_CONTROL);
+	sched_task(TASK_METER, task_meter, DEADLINE_METER);
+	sched_task(TASK_USB, task_usb, DEADLINE_USB);
+	sched_task(TASK_LOG, task_log, DEADLINE_LOG);
+	
+	dvr_enter(DVR_STOPPED);		// Start DVR in stopped state
+	if (supervisor_resumed() == DVR_RECORDING) {
+		dvr_record(dvr_next_segment());	// Watchdog reset during a recording: continue it
+		dvr_enter(DVR_RECORDING);
+	}
+	
+	// Loop forever: run ready tasks, sleep when there are none
+    for(;;) {
+		sched_run();
+	}
 }
 
 /**
@@ -296,35 +957,36 @@ int main(void) {
  * Creates an average value to fill space. (var1+var2)/2 RUns per 3 sample
  */
 ISR(TIMER4_OVF_vect) {
+	uint8_t entry = TCNT4;								// Cycles since overflow (16 MHz timer clock)
+	LOAD_ENTER();
+	PROFILE_LATENCY(PROFILE_PWM, entry);
+	if (entry > pwmLatencyMax) pwmLatencyMax = entry;
+	
+	if (speaker) {										// ----- USB speaker stream -------------------
+		speakerPhase += speakerStep;
+		if (speakerPhase < speakerStep) {				// Phase wrapped, next sample is due
+			if (buffer_level()) {
+				OCR4B = buffer_dequeue();
+				speakerEmpty = 0;
+			} else if (!speakerEmpty) {					// Hold last sample, count underrun
+				speakerUnderruns++;
+				speakerEmpty = 1;
+			}
+		}
+		LOAD_EXIT(LOAD_PWM);
+		return;
+	}													// --------------------------------------------
 	debaunce_counter++;
 	if(--data_amount > 0){
-		count++;
-		if(count >=2) {
-			count = 0;
-			if(played){										// True if 2 samples has not been played yet.
-				first_que = buffer_dequeue();				// Stores first value
-				second_que = buffer_dequeue();				// Stores second value
-				first_played = 0;							// Sets flag for first
-				second_played = 0;							// Sets flag for second
-				played = 0;									// Values are stored, start play
-				} else {										// ------Plays samples of creates one--------
-				if(!first_played) {							// ------Play first sample-------------------
-					OCR4B = first_que;
-					first_played = 1;
-				} else if(!second_played) {					// ------Play average sample-----------------
-					OCR4B = (first_que+second_que)/2.0;
-					second_played = 1;
-				} else {									// ------Play second sample-------------------
-					OCR4B = second_que;
-					played = 1;
-				}											// --------------------------------------------
-			}
-		}								// -----Runs until all samples were played
-														// --------------------------------------------
+		uint8_t duty;
+		if (playback_step(&duty)) OCR4B = duty;			// Interpolated samples (see playback.c)
+														// -----Runs until all samples were played
 	} else {											// ----- File has been played------------------
 		newPage = 0;									// Empties the page
 		stop = 1;										// Stops playback run
+		sched_post(TASK_SD_READ);						// Finalize playback
 		stop_pwm();										// Stops PWM
 	} // END data_amount								// --------------------------------------------
 	
+	LOAD_EXIT(LOAD_PWM);
 } // END Interrupt
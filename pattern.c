@@ -0,0 +1,135 @@
+/**
+ * pattern.c - EGB240DVR Library, Test pattern module
+ *
+ * On-device verifier for takes recorded from the test pattern (see
+ * adc_pattern). Every page is checked just before it is written to
+ * the SD card, so the check covers the ADC interrupt, the buffer and
+ * the page hand-over to the write task; the host tool
+ * tools/pattern.py checks the file itself.
+ *
+ * Each sample is compared with the one predicted from the two before
+ * it. At a break the sequence is stepped on from the expected sample
+ * until it meets the samples actually found, which gives the number
+ * of samples lost, and checking picks up from the samples found.
+ * Breaks that are not resolved within PATTERN_SEARCH_MAX samples (a
+ * repeated page, or corrupt data) are counted separately. A page
+ * costs about 10 cycles per sample, and a break up to
+ * PATTERN_SEARCH_MAX steps (roughly 4 ms).
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <stdint.h>
+
+#include "pattern.h"
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static PATTERN_RESULT result;	// Results for the current take
+static uint8_t primed;			// Samples of the take seen so far (up to 2)
+static uint8_t last;			// Last sample checked
+static uint8_t before;			// Sample before it
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+/**
+ * Function: pattern_gap
+ *
+ * Steps the sequence on from the expected sample until it reaches the
+ * sample found, followed by the one after it.
+ *
+ * Parameters:
+ *    found - Sample found in place of the expected one.
+ *    after - Sample following it.
+ *    known - Non-zero if after is valid (0 for the last sample of a
+ *            page, which is then matched on one sample alone).
+ *
+ * Returns: Samples missing before the found sample, or 0 if it was not
+ *          reached within PATTERN_SEARCH_MAX samples.
+ */
+static uint16_t pattern_gap(uint8_t found, uint8_t after, uint8_t known) {
+	uint8_t current = PATTERN_NEXT(last, before);	// Expected sample
+	uint8_t previous = last;
+	uint8_t next;
+	uint16_t gap;
+
+	for (gap = 1; gap <= PATTERN_SEARCH_MAX; gap++) {
+		next = PATTERN_NEXT(current, previous);
+		previous = current;
+		current = next;
+		if (current == found && (!known || PATTERN_NEXT(current, previous) == after)) {
+			return gap;
+		}
+	}
+	return 0;
+}
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: pattern_reset
+ *
+ * Clears the results and starts a new take; the first two samples
+ * checked set the position in the sequence.
+ */
+void pattern_reset() {
+	result.pages = 0;
+	result.breaks = 0;
+	result.lost = 0;
+	result.unresolved = 0;
+	result.first = PATTERN_NONE;
+	primed = 0;
+}
+
+/**
+ * Function: pattern_check
+ *
+ * Checks the next page of the take against the sequence.
+ *
+ * Parameters:
+ *    page - Samples to check.
+ *    count - Number of samples.
+ */
+void pattern_check(const uint8_t* page, uint16_t count) {
+	uint16_t i, gap;
+	uint8_t sample;
+
+	for (i = 0; i < count; i++) {
+		sample = page[i];
+		if (primed < 2) {
+			primed++;
+		} else if (sample != PATTERN_NEXT(last, before)) {
+			result.breaks++;
+			if (result.first == PATTERN_NONE) result.first = result.pages;
+			gap = (i + 1 < count) ? pattern_gap(sample, page[i + 1], 1) : pattern_gap(sample, 0, 0);
+			if (gap) {
+				result.lost += gap;
+			} else {
+				result.unresolved++;
+			}
+			primed = 1;				// Next sample is taken as found (resynchronise)
+		}
+		before = last;
+		last = sample;
+	}
+	result.pages++;
+}
+
+/**
+ * Function: pattern_result
+ *
+ * Returns: The results since pattern_reset.
+ */
+const PATTERN_RESULT* pattern_result() {
+	return &result;
+}
@@ -0,0 +1,38 @@
+/**
+ * pattern.h - EGB240DVR Library, Test pattern module header
+ *
+ * Known sample sequence recorded in place of the ADC result to find
+ * lost or repeated samples. The sequence is a 16-bit maximal length
+ * LFSR (x^16 + x^11 + x^9 + x^8 + 1) advanced 8 bits per sample, so
+ * any two consecutive samples give its position (period 65535).
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef PATTERN_H_
+#define PATTERN_H_
+
+#define PATTERN_SEED		0x01	// Sample before the first of a take (the one before it is 0)
+#define PATTERN_SEARCH_MAX	4096	// Longest gap measured by the verifier (samples)
+#define PATTERN_NONE		0xFFFF	// No break found (first break page)
+
+// Next sample of the sequence from the last two samples
+#define PATTERN_NEXT(last, before) \
+	((uint8_t)((before) ^ (last) ^ ((last) << 1) ^ ((before) >> 7) ^ ((last) << 3) ^ ((before) >> 5)))
+
+// Verifier results for the current take
+typedef struct {
+	uint16_t pages;			// Pages checked
+	uint16_t breaks;		// Places where the sequence did not continue
+	uint32_t lost;			// Samples missing at the measured breaks
+	uint16_t unresolved;	// Breaks not followed by a gap of up to PATTERN_SEARCH_MAX (repeated or corrupt data)
+	uint16_t first;			// Page of the first break (PATTERN_NONE if none)
+} PATTERN_RESULT;
+
+void pattern_reset();										// Starts checking a new take
+void pattern_check(const uint8_t* page, uint16_t count);	// Checks the next page of the take
+const PATTERN_RESULT* pattern_result();						// Results since pattern_reset
+
+#endif /* PATTERN_H_ */
@@ -0,0 +1,89 @@
+/**
+ * playback.c - EGB240DVR Library, Playback interpolation module
+ *
+ * Produces the PWM duty cycle for WAVE file playback from the samples
+ * in the circular buffer. The PWM runs at four times the sample rate;
+ * every second PWM period is a step. Samples are fetched in pairs, and
+ * each four steps play the first sample, the average of the pair and
+ * the second sample, while the fetching step holds the previous output.
+ *
+ * The module has no hardware dependencies: the PWM interrupt applies
+ * the duty cycle, and the host build (host/golden.c) runs the same code
+ * to measure the quality of the playback path.
+ *
+ * Requires:
+ *   buffer - Circular buffer, source of the samples
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <stdint.h>
+
+#include "buffer.h"
+#include "playback.h"
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static volatile uint8_t played = 1;		// Flag: both samples of the pair have been played
+static volatile uint8_t first_que = 0;		// First sample of the pair
+static volatile uint8_t second_que = 0;	// Second sample of the pair
+static volatile uint8_t first_played = 0;	// Flag indicates if first sample was played
+static volatile uint8_t second_played = 0;	// Flag indicates if average sample was played
+static volatile uint8_t count = 0;			// Skips every second PWM period
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: playback_reset
+ *
+ * Starts a new stream: the next step fetches a fresh pair of samples.
+ */
+void playback_reset() {
+	count = 0;
+	played = 1;
+}
+
+/**
+ * Function: playback_step
+ *
+ * Advances the interpolator by one PWM period. Must be called from the
+ * PWM interrupt (or with it disabled) as it dequeues from the buffer.
+ *
+ * Parameters:
+ *    duty - Receives the new duty cycle (0 to 255).
+ *
+ * Returns: 1 if a new duty cycle was produced, 0 to hold the current one.
+ */
+uint8_t playback_step(uint8_t* duty) {
+	if (++count < 2) return 0;
+	count = 0;
+
+	if (played) {									// ------Fetch the next pair---------------------
+		first_que = buffer_dequeue();
+		second_que = buffer_dequeue();
+		first_played = 0;
+		second_played = 0;
+		played = 0;
+		return 0;
+	}
+
+	if (!first_played) {							// ------Play first sample-----------------------
+		*duty = first_que;
+		first_played = 1;
+	} else if (!second_played) {					// ------Play average sample---------------------
+		*duty = ((uint16_t)first_que + second_que) >> 1;
+		second_played = 1;
+	} else {										// ------Play second sample----------------------
+		*duty = second_que;
+		played = 1;
+	}
+	return 1;
+}
@@ -0,0 +1,20 @@
+/**
+ * playback.h - EGB240DVR Library, Playback interpolation module header
+ *
+ * Converts the sample stream in the circular buffer into PWM duty
+ * cycles, called once per PWM (Timer4 overflow) period.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef PLAYBACK_H_
+#define PLAYBACK_H_
+
+#define PLAYBACK_PWM_PER_SAMPLE	4	// PWM periods per sample (62.5 kHz PWM, 15.625 kHz samples)
+
+void playback_reset();				// Starts a new stream (nothing fetched yet)
+uint8_t playback_step(uint8_t* duty);	// One PWM period, returns 1 if *duty holds a new duty cycle
+
+#endif /* PLAYBACK_H_ */
@@ -0,0 +1,91 @@
+/**
+ * profile.c - EGB240DVR Library, ISR profiler
+ *
+ * Each instrumented ISR reads the Timer3 cycle counter on entry and
+ * exit (PROFILE_ENTER/PROFILE_EXIT) and updates its entry in the table.
+ * The "profile" shell command requests the table, which is sent one
+ * TLM_PROFILE frame per ISR by profile_poll as space in the console
+ * ring allows (the whole table does not fit at once). Each entry is
+ * cleared as it is sent, so a report covers the time since the last.
+ *
+ * Built only with ISR_PROFILE defined; otherwise profile_request
+ * reports that the profiler is not available.
+ *
+ * Requires:
+ *   serial - Console ring space
+ *   telemetry - TLM_PROFILE frames
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <string.h>
+
+#include "serial.h"
+#include "telemetry.h"
+#include "profile.h"
+
+#ifdef ISR_PROFILE
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+volatile PROFILE_ENTRY profile[PROFILE_COUNT];	// Profile table, indexed by PROFILE_*
+static uint8_t reportNext = PROFILE_COUNT;		// Next row to send (PROFILE_COUNT: none)
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: profile_request
+ * 
+ * Starts sending the profile table (see profile_poll).
+ *
+ * Returns: True.
+ */
+uint8_t profile_request() {
+	reportNext = 0;
+	return 1;
+}
+
+/**
+ * Function: profile_poll
+ * 
+ * Sends the next requested row of the profile table, if the console
+ * ring has room for the whole frame, and clears it. Call regularly
+ * from the main loop.
+ */
+void profile_poll() {
+	PROFILE_ENTRY entry;
+	uint16_t average;
+	
+	if (reportNext >= PROFILE_COUNT || serial_free() < TLM_FRAME(TLM_PROFILE_LENGTH)) return;
+	
+	cli();
+	memcpy(&entry, (const void*)&profile[reportNext], sizeof(entry));
+	memset((void*)&profile[reportNext], 0, sizeof(entry));
+	sei();
+	
+	average = entry.count ? entry.total / entry.count : 0;
+	telemetry_profile(reportNext, entry.count, average, entry.max, entry.latency);
+	reportNext++;
+}
+
+#else
+
+uint8_t profile_request() {
+	return 0;		// Not compiled in (define ISR_PROFILE)
+}
+
+void profile_poll() {
+}
+
+#endif /* ISR_PROFILE */
@@ -0,0 +1,64 @@
+/**
+ * profile.h - EGB240DVR Library, ISR profiler header
+ *
+ * Compile time optional instrumentation of every interrupt service
+ * routine: run count, average and worst case run time in CPU cycles,
+ * and the worst case latency from trigger to entry where the trigger
+ * time is known (ADC, PWM). Define ISR_PROFILE for the whole project
+ * to enable it; otherwise the macros compile to nothing.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+// Profiled interrupt service routines
+#define PROFILE_ADC		0		// ADC_vect
+#define PROFILE_TIMER0	1		// TIMER0_COMPA_vect
+#define PROFILE_PWM		2		// TIMER4_OVF_vect
+#define PROFILE_USB_GEN	3		// USB_GEN_vect
+#define PROFILE_USB_COM	4		// USB_COM_vect (runs with interrupts enabled, includes nested ISRs)
+#define PROFILE_WDT		5		// WDT_vect
+#define PROFILE_COUNT	6
+
+#ifdef ISR_PROFILE
+
+typedef struct {
+	uint32_t count;			// Times the ISR ran
+	uint32_t total;			// Cycles spent in the ISR (average = total / count)
+	uint16_t max;			// Longest run (cycles)
+	uint16_t latency;		// Longest trigger to entry time (cycles, 0 if not measured)
+} PROFILE_ENTRY;
+
+extern volatile PROFILE_ENTRY profile[PROFILE_COUNT];
+
+// Records one run of an ISR (called with interrupts disabled)
+static inline void profile_exit(uint8_t id, uint16_t cycles) {
+	profile[id].count++;
+	profile[id].total += cycles;
+	if (cycles > profile[id].max) profile[id].max = cycles;
+}
+
+// Place at the start and end of the body of an ISR without load
+// accounting; LOAD_ENTER/LOAD_EXIT (load.h) profile the others
+#define PROFILE_ENTER()				uint16_t profileStart = TCNT3
+#define PROFILE_EXIT(id)			PROFILE_RUN(id, TCNT3 - profileStart)
+#define PROFILE_RUN(id, cycles)		profile_exit(id, cycles)
+#define PROFILE_LATENCY(id, cycles)	do { if ((cycles) > profile[id].latency) profile[id].latency = (cycles); } while (0)
+
+#else
+
+#define PROFILE_ENTER()
+#define PROFILE_EXIT(id)
+#define PROFILE_RUN(id, cycles)
+#define PROFILE_LATENCY(id, cycles)
+
+#endif /* ISR_PROFILE */
+
+uint8_t profile_request();	// Starts sending the profile table, false if not compiled in
+void profile_poll();		// Sends the next table row when the console has room
+
+#endif /* PROFILE_H_ */
@@ -0,0 +1,55 @@
+/**
+ * record.c - EGB240DVR Library, Record page module
+ *
+ * Writes the next full page of the circular buffer to the WAVE file,
+ * and in test pattern mode checks it with the on-device verifier
+ * first. Both must see the same page: buffer_readPage moves on to the
+ * other page on every call, so the page is fetched once.
+ *
+ * The module has no hardware dependencies: the SD write task calls it
+ * for every page recorded, and the host build (host/test_record.c)
+ * runs the same code to check what reaches the file.
+ *
+ * Requires:
+ *   buffer - Circular buffer, source of the pages
+ *   pattern - Test pattern verifier
+ *   wave - WAVE file being recorded
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <stdint.h>
+
+#include "buffer.h"
+#include "pattern.h"
+#include "wave.h"
+#include "record.h"
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: record_page
+ *
+ * Writes the next full page of the buffer to the WAVE file.
+ *
+ * Parameters:
+ *    count - Page size in samples.
+ *    check - True to verify the page against the test pattern.
+ *
+ * Returns: 0 on success, non-zero if the write failed (see wave_write).
+ */
+uint8_t record_page(uint16_t count, uint8_t check) {
+	uint8_t* page = buffer_readPage();		// Advances the tail: fetch once
+	
+	if (check) {
+		pattern_check(page, count);			// Verify the test pattern
+	}
+	return wave_write(page, count);
+}
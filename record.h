@@ -0,0 +1,17 @@
+/**
+ * record.h - EGB240DVR Library, Record page module header
+ *
+ * Moves each full page of the circular buffer to the WAVE file being
+ * recorded, verifying the test pattern on the way in pattern mode.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef RECORD_H_
+#define RECORD_H_
+
+uint8_t record_page(uint16_t count, uint8_t check);	// Writes the next full page, 0 on success
+
+#endif /* RECORD_H_ */
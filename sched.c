@@ -0,0 +1,209 @@
+/**
+ * sched.c - EGB240DVR Library, Cooperative scheduler
+ *
+ * Replaces the ad hoc main loop with prioritised tasks. Interrupt
+ * service routines post tasks (page full/empty, button events, the
+ * ~1 ms service tick) with sched_post, which marks the task ready and
+ * timestamps the post. sched_run runs the highest priority ready task
+ * to completion; tasks never block, so a lower priority task can
+ * delay the SD card writer by at most its own run time. The run time
+ * of every task and its post-to-completion time against its deadline
+ * are recorded, showing which work endangers the page deadline.
+ *
+ * When no task is ready the CPU enters idle sleep. The ready mask is
+ * tested and the CPU put to sleep with interrupts disabled; sei takes
+ * effect only after the following instruction, so a task posted just
+ * before sleep_cpu still wakes the CPU and is never missed. Idle mode
+ * keeps the timers, ADC, PWM and USB running.
+ *
+ * Timer3 free runs at the CPU clock and measures the time spent in
+ * sleep, from which the remaining CPU headroom is reported. Time spent
+ * in the ISRs accounted by the load meter (load.c) while asleep is not
+ * counted as idle.
+ *
+ * Requires:
+ *   timer - Timer0 tick count, used for deadlines and run times
+ *   load - ISR cycle counts, excluded from idle time
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+#include <string.h>
+
+#include "timer.h"
+#include "sched.h"
+#include "load.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define SCHED_CYCLES_PER_TICK	1024	// CPU cycles per Timer0 tick (64 us)
+
+/************************************************************************/
+/* TYPE DEFINITIONS                                                     */
+/************************************************************************/
+typedef struct {
+	void (*run)(void);		// Task function (0 if not registered)
+	uint16_t deadline;		// Allowed time from post to completion (ticks)
+	uint16_t posted;		// Tick count (low 16 bits) when posted
+} SCHED_TASK;
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static SCHED_TASK tasks[TASK_COUNT];		// Task table, indexed by priority
+static SCHED_STATS stats[TASK_COUNT];		// Accounting, indexed by priority
+static volatile uint8_t ready = 0;			// Ready mask (bit n = task n)
+static uint32_t idleCycles = 0;				// CPU cycles spent asleep (free running)
+static uint32_t idleMark = 0;				// Idle cycles when idle measurement started
+static uint32_t idleStart = 0;				// Tick count when idle measurement started
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: sched_init
+ * 
+ * Selects idle sleep mode and starts Timer3 as a free running cycle
+ * counter (normal mode, /1 prescaler, no interrupts).
+ */
+void sched_init() {
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	TCCR3A = 0x00;	// Normal mode
+	TIMSK3 = 0x00;	// No interrupts
+	TCCR3B = 0x01;	// Start timer, /1 prescaler
+	idleStart = timer_ticks();
+}
+
+/**
+ * Function: sched_task
+ * 
+ * Registers the function run for a task.
+ *
+ * Parameters:
+ *    id - Task ID (TASK_*), which is also its priority.
+ *    run - Function to run when the task is posted.
+ *    deadline - Ticks allowed from post to completion before a miss is counted.
+ */
+void sched_task(uint8_t id, void (*run)(void), uint16_t deadline) {
+	tasks[id].run = run;
+	tasks[id].deadline = deadline;
+}
+
+/**
+ * Function: sched_post
+ * 
+ * Makes a task ready to run. Posting a task that is already ready
+ * has no further effect (the task runs once).
+ *
+ * Parameters:
+ *    id - Task ID (TASK_*).
+ */
+void sched_post(uint8_t id) {
+	uint8_t bit = 1 << id;
+	uint8_t sreg = SREG;
+	
+	cli();
+	if (!(ready & bit)) {
+		ready |= bit;
+		tasks[id].posted = timer_ticks();
+	}
+	SREG = sreg;
+}
+
+/**
+ * Function: sched_run
+ * 
+ * Runs the highest priority ready task to completion and records its
+ * accounting. If no task is ready, sleeps in idle mode until one is
+ * posted.
+ */
+void sched_run() {
+	uint8_t id, pending;
+	uint16_t start, end, posted;
+	uint32_t isr;
+	
+	cli();
+	pending = ready;
+	if (!pending) {
+		isr = load_isr_cycles();
+		start = TCNT3;
+		sleep_enable();
+		sei();				// Takes effect after sleep_cpu, no lost wakeup
+		sleep_cpu();
+		sleep_disable();
+		cli();
+		// Timer0 wakes at least every 64 us; the waking ISRs are not idle time
+		idleCycles += (uint16_t)(TCNT3 - start) - (uint16_t)(load_isr_cycles() - isr);
+		sei();
+		return;
+	}
+	for (id = 0; !(pending & (1 << id)); id++);	// Highest priority (lowest ID)
+	ready &= ~(1 << id);
+	posted = tasks[id].posted;
+	sei();
+	
+	start = timer_ticks();
+	if (tasks[id].run) tasks[id].run();
+	end = timer_ticks();
+	
+	stats[id].runs++;
+	if ((uint16_t)(end - start) > stats[id].maxRun) stats[id].maxRun = end - start;
+	if ((uint16_t)(start - posted) > stats[id].maxLatency) stats[id].maxLatency = start - posted;
+	if ((uint16_t)(end - posted) > tasks[id].deadline) stats[id].misses++;
+}
+
+/**
+ * Function: sched_stats
+ * 
+ * Returns the accounting of a task since the last call and starts a
+ * new measurement.
+ *
+ * Parameters:
+ *    id - Task ID (TASK_*).
+ *    result - Receives the accounting.
+ */
+void sched_stats(uint8_t id, SCHED_STATS* result) {
+	*result = stats[id];
+	memset(&stats[id], 0, sizeof(SCHED_STATS));
+}
+
+/**
+ * Function: sched_idle
+ * 
+ * Returns the fraction of time spent asleep since the last call (CPU
+ * headroom), and starts a new measurement. Intervals must be shorter
+ * than ~4 minutes (32-bit cycle count).
+ *
+ * Returns: Idle time in 1/1000ths of the elapsed time.
+ */
+uint16_t sched_idle() {
+	uint32_t now = timer_ticks();
+	uint32_t ticks = now - idleStart;
+	uint16_t idle = ticks ? ((idleCycles - idleMark) / ticks) * 1000 / SCHED_CYCLES_PER_TICK : 0;
+	
+	idleMark = idleCycles;
+	idleStart = now;
+	
+	return idle > 1000 ? 1000 : idle;
+}
+
+/**
+ * Function: sched_idle_cycles
+ * 
+ * Returns: The free running count of CPU cycles spent asleep (wraps
+ * after ~4 minutes). Only updated by sched_run, in the main loop.
+ */
+uint32_t sched_idle_cycles() {
+	return idleCycles;
+}
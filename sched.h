@@ -0,0 +1,42 @@
+/**
+ * sched.h - EGB240DVR Library, Cooperative scheduler header
+ *
+ * Priority based run-to-completion scheduler for main loop work.
+ * Tasks are posted from interrupt service routines (or other tasks)
+ * and run in priority order; the CPU sleeps while none are pending.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+// Task IDs, in priority order (0 = highest)
+#define TASK_SD_WRITE	0		// Write a full page to the SD card (recording)
+#define TASK_SD_READ	1		// Read ahead the next page from the SD card (playback)
+#define TASK_SUPERVISE	2		// Recover a stalled record/playback pipeline (~1 ms tick)
+#define TASK_CONTROL	3		// Act on button events and remote commands
+#define TASK_METER		4		// Report statistics and measurements
+#define TASK_USB		5		// Service the USB port (~1 ms tick)
+#define TASK_LOG		6		// Move log records and telemetry to the console (~1 ms tick)
+#define TASK_COUNT		7
+
+// Per-task accounting (Timer0 ticks, 64 us)
+typedef struct {
+	uint16_t runs;			// Times the task has run
+	uint16_t maxRun;		// Longest run time
+	uint16_t maxLatency;	// Longest time from post to start
+	uint16_t misses;		// Runs that finished after the deadline
+} SCHED_STATS;
+
+void sched_init();			// Configures idle sleep and the Timer3 cycle counter
+void sched_task(uint8_t id, void (*run)(void), uint16_t deadline);	// Registers a task (deadline in ticks from post)
+void sched_post(uint8_t id);	// Makes a task ready to run (ISR safe)
+void sched_run();			// Runs the highest priority ready task, or sleeps until one is posted
+void sched_stats(uint8_t id, SCHED_STATS* stats);	// Returns and resets a task's accounting
+uint16_t sched_idle();		// Returns idle time since the last call, in 1/1000ths
+uint32_t sched_idle_cycles();	// Returns the free running count of cycles asleep
+
+#endif /* SCHED_H_ */
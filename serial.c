@@ -6,6 +6,17 @@
  * Allows the use of stdio library functions (printf etc.)
  * Can be used for debug, control and user interface purposes.
  *
+ * Output is non-blocking: characters are placed in a RAM transmit
+ * ring and sent to the USB endpoint by serial_flush, which never
+ * waits for the host. If the ring is full (host not reading, or
+ * output produced faster than it can be sent) characters are dropped
+ * and counted, so printing can never stall the audio pipeline.
+ *
+ * When the project is built with USB_MSC_MODE or USB_AUDIO_MODE
+ * defined, the USB port enumerates as a mass storage device or a
+ * microphone instead (see lib/usb_msc, lib/usb_audio). Console output
+ * is then discarded and no input is available.
+ *
  * Requires:
  *   lib/usb_serial - USB serial library published by PJRC.com
  *
@@ -18,9 +29,38 @@
 /************************************************************************/
 /* INCLUDED LIBRARIES/HEADER FILES                                      */
 /************************************************************************/
+#include <avr/io.h>
+
 #include <stdio.h>
 
+#if defined(USB_MSC_MODE)
+#include "lib/usb_msc/usb_msc.h"
+#elif defined(USB_AUDIO_MODE)
+#include "lib/usb_audio/usb_audio.h"
+#else
 #include "lib/usb_serial/usb_serial.h"
+#endif
+
+#include "serial.h"
+
+#if defined(USB_MSC_MODE) || defined(USB_AUDIO_MODE)
+#define SERIAL_NO_CONSOLE	// USB port is not a serial port
+#endif
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define SERIAL_TX_MASK	(SERIAL_TX_SIZE - 1)
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+#ifndef SERIAL_NO_CONSOLE
+static uint8_t txRing[SERIAL_TX_SIZE];	// Transmit ring
+static volatile uint8_t txHead = 0;		// Write index (putchar)
+static volatile uint8_t txTail = 0;		// Read index (flush)
+#endif
+static volatile uint16_t txDropped = 0;	// Characters discarded while ring full
 
 /************************************************************************/
 /* PROTOTYPE FUNCTIONS                                                  */
@@ -32,9 +72,28 @@ static FILE stdinout = FDEV_SETUP_STREAM(serial_putchar, serial_getchar, _FDEV_S
 /************************************************************************/
 /* PRIVATE/UTILLITY FUNCTIONS                                           */
 /************************************************************************/
+#ifdef SERIAL_NO_CONSOLE
 static uint8_t serial_putchar(char c, FILE *stream) {
-	//outputs a character via the USB serial interface
-	return usb_serial_putchar(c);
+	//no console, discard output
+	return 0;
+}
+
+static uint8_t serial_getchar(FILE *stream) {
+	//no console, report end of file
+	return _FDEV_EOF;
+}
+#else
+static uint8_t serial_putchar(char c, FILE *stream) {
+	uint8_t next = (txHead + 1) & SERIAL_TX_MASK;
+	
+	//queue a character for the USB serial interface, drop if full
+	if (next == txTail) {
+		txDropped++;
+		return 0;
+	}
+	txRing[txHead] = c;
+	txHead = next;
+	return 0;
 }
 
 static uint8_t serial_getchar(FILE *stream) {
@@ -43,6 +102,7 @@ static uint8_t serial_getchar(FILE *stream) {
 	//read a character from the USB serial interface 
 	return usb_serial_getchar();
 }
+#endif
 
 /************************************************************************/
 /* PUBLIC/USER FUNCTIONS                                                */
@@ -56,11 +116,32 @@ static uint8_t serial_getchar(FILE *stream) {
  * interface and creates the input and output serial streams.
  */
 void serial_init() {
+#if defined(USB_MSC_MODE)
+	usb_msc_init();		  // Initialise USB mass storage
+#elif defined(USB_AUDIO_MODE)
+	usb_audio_init();	  // Initialise USB microphone
+#else
 	usb_init();			  // Initialise USB serial
+#endif
 	stdin = &stdinout;
 	stdout = &stdinout;
 }
 
+/**
+ * Function: serial_detach
+ * 
+ * Detaches from the USB host and stops the USB controller, its pad
+ * regulator and the PLL, e.g. before power-down sleep (the host sees
+ * the device unplugged). serial_init attaches again.
+ */
+void serial_detach() {
+	UDIEN = 0;					// No USB device interrupts
+	UDCON = (1<<DETACH);		// Disconnect the D+ pull-up
+	USBCON = (1<<FRZCLK);		// Disable the controller, freeze its clock
+	PLLCSR = 0;					// Stop the PLL
+	UHWCON = 0;					// Disable the pad regulator
+}
+
 /**
  * Function: serial_ready
  * 
@@ -68,7 +149,13 @@ void serial_init() {
  *          for use. Integer encodes a boolean value.
  */
 uint8_t serial_ready() {
+#if defined(USB_MSC_MODE)
+	return usb_msc_configured();	// returns true if host has enumerated device
+#elif defined(USB_AUDIO_MODE)
+	return usb_audio_configured();	// returns true if host has enumerated device
+#else
 	return usb_configured();	// returns true if host has enumerated device
+#endif
 }
 
 /**
@@ -78,5 +165,119 @@ uint8_t serial_ready() {
  *          serial interface. Integer encodes a boolean value.
  */
 uint8_t serial_available() {
+#ifdef SERIAL_NO_CONSOLE
+	return 0;
+#else
 	return usb_serial_available();
+#endif
+}
+
+/**
+ * Function: serial_getchar_nowait
+ * 
+ * Reads a character from the serial interface without waiting.
+ *
+ * Returns: The received character, or -1 if none is available.
+ */
+int16_t serial_getchar_nowait() {
+#ifdef SERIAL_NO_CONSOLE
+	return -1;
+#else
+	return usb_serial_getchar();
+#endif
+}
+
+/**
+ * Function: serial_read
+ * 
+ * Reads a block of binary data from the serial interface without
+ * waiting, e.g. streamed audio samples.
+ *
+ * Parameters:
+ *    data - Destination for the received bytes.
+ *    count - Maximum number of bytes to read.
+ *
+ * Returns: Number of bytes read (0 if none are waiting).
+ */
+uint16_t serial_read(uint8_t* data, uint16_t count) {
+#ifdef SERIAL_NO_CONSOLE
+	return 0;
+#else
+	return usb_serial_read(data, count);
+#endif
+}
+
+/**
+ * Function: serial_write
+ * 
+ * Queues a block of binary data for transmission. The block is queued
+ * whole or not at all (counted as dropped), so framed data is never
+ * truncated. Never waits.
+ *
+ * Parameters:
+ *    data - Pointer to the data to send.
+ *    count - Number of bytes to send.
+ *
+ * Returns: 0 if queued, -1 if dropped.
+ */
+int8_t serial_write(const uint8_t* data, uint8_t count) {
+#ifndef SERIAL_NO_CONSOLE
+	uint8_t head = txHead;
+	uint8_t space = (txTail - head - 1) & SERIAL_TX_MASK;
+	
+	if (count <= space) {
+		while (count--) {
+			txRing[head] = *data++;
+			head = (head + 1) & SERIAL_TX_MASK;
+		}
+		txHead = head;
+		return 0;
+	}
+#endif
+	txDropped += count;
+	return -1;
+}
+
+/**
+ * Function: serial_free
+ * 
+ * Returns: Number of bytes that can currently be queued without
+ *          dropping output.
+ */
+uint8_t serial_free() {
+#ifndef SERIAL_NO_CONSOLE
+	return (txTail - txHead - 1) & SERIAL_TX_MASK;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Function: serial_flush
+ * 
+ * Moves queued console output into the USB endpoint, without waiting.
+ * Stops as soon as the endpoint is full or the host is not connected;
+ * the remaining characters are sent on a later call. Call regularly
+ * (e.g. every main loop iteration).
+ */
+void serial_flush() {
+#ifndef SERIAL_NO_CONSOLE
+	uint8_t tail = txTail;
+	
+	while (tail != txHead) {
+		if (usb_serial_putchar_nowait(txRing[tail])) break;
+		tail = (tail + 1) & SERIAL_TX_MASK;
+	}
+	txTail = tail;
+#endif
+}
+
+/**
+ * Function: serial_dropped
+ * 
+ * Returns: Number of output characters discarded because the
+ *          transmit ring was full.
+ */
+uint16_t serial_dropped() {
+	return txDropped;
 }
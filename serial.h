@@ -12,8 +12,17 @@
 #ifndef SERIAL_H_
 #define SERIAL_H_
 
+#define SERIAL_TX_SIZE	64		// Transmit ring size (power of 2), holds SERIAL_TX_SIZE - 1 bytes
+
 void serial_init();			// Initialises the serial module for use.
+void serial_detach();		// Detaches from the USB host and stops the USB clock (serial_init attaches).
 uint8_t serial_ready();		// Returns true if the serial interface is ready for use.
 uint8_t serial_available(); // Returns true if characters are available on the serial interface.
+int16_t serial_getchar_nowait(); // Returns the next received character, or -1 if none (never waits).
+uint16_t serial_read(uint8_t* data, uint16_t count); // Reads waiting binary data, returns bytes read (never waits).
+int8_t serial_write(const uint8_t* data, uint8_t count); // Queues a binary block (whole or dropped).
+uint8_t serial_free();		// Returns the free space in the transmit ring.
+void serial_flush();		// Sends queued output to the USB interface without waiting.
+uint16_t serial_dropped();	// Returns the number of output characters dropped (ring full).
 
 #endif /* SERIAL_H_ */
\ No newline at end of file
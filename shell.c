@@ -0,0 +1,271 @@
+/**
+ * shell.c - EGB240DVR Library, Command shell module
+ *
+ * Non-blocking, line buffered command interpreter for remote control
+ * of the recorder over the USB serial interface. shell_poll is called
+ * every main loop iteration; it reads at most SHELL_POLL_MAX characters
+ * without waiting and only parses a line once its terminator arrives,
+ * so a poll costs a few microseconds and never delays SD card access.
+ *
+ * The shell only interprets commands. Requests that change the
+ * recorder state are returned to the main state machine, which decides
+ * whether they are valid in the current state and acknowledges them
+ * with shell_reply.
+ *
+ * A file transfer frame (XFER_SYNC at the start of a line) is handed
+ * over to the transfer module as SHELL_TRANSFER.
+ *
+ * Requires:
+ *   serial - USB serial interface (non-blocking receive and transmit)
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "serial.h"
+#include "transfer.h"
+#include "shell.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define SHELL_LINE_MAX	24		// Longest command line (including terminator)
+#define SHELL_POLL_MAX	8		// Characters processed per call to shell_poll
+#define SHELL_TEXT_MAX	48		// Longest reply text
+#define SHELL_HELP_DONE	3		// helpNext when the command list is out
+
+// Defines a reply text in program memory; a text longer than
+// SHELL_TEXT_MAX fails to build (negative array size)
+#define SHELL_TEXT(name, text) \
+	static const char name[] PROGMEM = text; \
+	typedef char name##Fits[(sizeof(text) <= SHELL_TEXT_MAX + 1) ? 1 : -1]
+
+// Requests whose argument must be a number from 0 to 65535
+#define SHELL_NUMERIC(request)	((request) == SHELL_RATE || (request) == SHELL_PATTERN)
+
+/************************************************************************/
+/* TYPE DEFINITIONS                                                     */
+/************************************************************************/
+typedef struct {
+	const char* name;	// Command word
+	uint8_t request;	// Request returned to the state machine
+} SHELL_COMMAND;
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static char line[SHELL_LINE_MAX];	// Command line being received
+static uint8_t lineLength = 0;		// Characters in line
+static uint8_t lineOverflow = 0;	// Flag: line too long, discard until terminator
+static const char* argument = "";	// Argument of the last request
+static uint16_t value = 0;			// Numeric argument of the last request
+static uint8_t helpNext = SHELL_HELP_DONE;	// Next piece of the command list to send
+
+static const char cmdRec[] PROGMEM = "rec";
+static const char cmdPlay[] PROGMEM = "play";
+static const char cmdStop[] PROGMEM = "stop";
+static const char cmdFile[] PROGMEM = "file";
+static const char cmdRate[] PROGMEM = "rate";
+static const char cmdStats[] PROGMEM = "stats";
+static const char cmdSpeaker[] PROGMEM = "speaker";
+static const char cmdPause[] PROGMEM = "pause";
+static const char cmdStandby[] PROGMEM = "standby";
+static const char cmdProfile[] PROGMEM = "profile";
+static const char cmdPattern[] PROGMEM = "pattern";
+static const char cmdLoopback[] PROGMEM = "loopback";
+static const char cmdThroughput[] PROGMEM = "throughput";
+static const char cmdHelp[] PROGMEM = "help";
+static const char cmdHelpShort[] PROGMEM = "?";
+
+static const SHELL_COMMAND commands[] = {
+	{ cmdRec,	SHELL_RECORD },
+	{ cmdPlay,	SHELL_PLAY },
+	{ cmdStop,	SHELL_STOP },
+	{ cmdFile,	SHELL_FILE },
+	{ cmdRate,	SHELL_RATE },
+	{ cmdStats,	SHELL_STATS },
+	{ cmdSpeaker, SHELL_SPEAKER },
+	{ cmdPause,	SHELL_PAUSE },
+	{ cmdStandby, SHELL_STANDBY },
+	{ cmdProfile, SHELL_PROFILE },
+	{ cmdPattern, SHELL_PATTERN },
+	{ cmdLoopback, SHELL_LOOPBACK },
+	{ cmdThroughput, SHELL_THROUGHPUT }
+};
+
+SHELL_TEXT(replyOk, "ok\r\n");
+SHELL_TEXT(replyErr, "err\r\n");
+
+// Command list, sent a piece at a time as the transmit ring drains
+SHELL_TEXT(helpText0, "rec pause play stop file NAME rate HZ stats ");
+SHELL_TEXT(helpText1, "profile pattern N loopback throughput ");
+SHELL_TEXT(helpText2, "standby speaker\r\n");
+static const char* const helpText[SHELL_HELP_DONE] PROGMEM = { helpText0, helpText1, helpText2 };
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+/**
+ * Function: shell_puts_P
+ *
+ * Queues a string from program memory for transmission (whole or
+ * dropped, see serial_write). Only pass texts defined with SHELL_TEXT,
+ * which are checked at build time to fit the buffer.
+ */
+static void shell_puts_P(const char* text) {
+	uint8_t buffer[SHELL_TEXT_MAX];
+	uint8_t length = strlen_P(text);
+
+	memcpy_P(buffer, text, length);
+	serial_write(buffer, length);
+}
+
+/**
+ * Function: shell_help
+ *
+ * Sends the pieces of the command list that fit in the transmit ring;
+ * the rest is sent on later calls to shell_poll.
+ */
+static void shell_help() {
+	const char* text;
+
+	while (helpNext != SHELL_HELP_DONE) {
+		text = (const char*)pgm_read_word(&helpText[helpNext]);
+		if (serial_free() < strlen_P(text)) return;
+		shell_puts_P(text);
+		helpNext++;
+	}
+}
+
+/**
+ * Function: shell_execute
+ *
+ * Splits a complete line into command word and argument and looks
+ * up the command. Commands taking a number are answered with err here
+ * unless the whole argument is a number from 0 to 65535.
+ *
+ * Returns: The request for the state machine, or SHELL_NONE.
+ */
+static uint8_t shell_execute() {
+	char* arg;
+	char* end;
+	unsigned long number;
+	uint8_t i;
+
+	// Split off the argument (first space)
+	arg = strchr(line, ' ');
+	if (arg) {
+		*arg++ = '\0';
+		while (*arg == ' ') arg++;
+	} else {
+		arg = line + lineLength;	// Empty string
+	}
+	argument = arg;
+	number = strtoul(arg, &end, 10);	// int is 16 bits: atoi would overflow
+	value = number;
+
+	for (i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+		if (!strcmp_P(line, commands[i].name)) {
+			if (SHELL_NUMERIC(commands[i].request) && (end == arg || *end || number > 0xFFFF)) break;
+			return commands[i].request;
+		}
+	}
+
+	if (!strcmp_P(line, cmdHelp) || !strcmp_P(line, cmdHelpShort)) {
+		helpNext = 0;
+		shell_help();					// As much as fits now
+	} else {
+		shell_reply(0);					// Unknown command or bad number
+	}
+	return SHELL_NONE;
+}
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: shell_poll
+ *
+ * Continues the command list, then processes characters waiting on
+ * the serial interface. Returns as soon as no input is waiting, a line
+ * is complete, or SHELL_POLL_MAX characters have been processed.
+ *
+ * Returns: A SHELL_ request for the state machine, or SHELL_NONE.
+ */
+uint8_t shell_poll() {
+	int16_t c;
+	uint8_t n;
+
+	shell_help();						// Rest of the command list, if any
+	for (n = 0; n < SHELL_POLL_MAX; n++) {
+		c = serial_getchar_nowait();
+		if (c < 0) break;
+
+		if (c == '\r' || c == '\n') {
+			if (lineOverflow) {
+				lineOverflow = 0;
+				lineLength = 0;
+				shell_reply(0);
+			} else if (lineLength) {
+				line[lineLength] = '\0';
+				c = shell_execute();
+				lineLength = 0;
+				if (c != SHELL_NONE) return c;
+			}
+		} else if (c == XFER_SYNC && !lineLength) {
+			return SHELL_TRANSFER;			// Binary frame, not a command
+		} else if (c == '\b' || c == 0x7F) {
+			if (lineLength) lineLength--;	// Backspace/delete
+		} else if (lineLength < SHELL_LINE_MAX - 1) {
+			line[lineLength++] = c;
+		} else {
+			lineOverflow = 1;
+		}
+	}
+
+	return SHELL_NONE;
+}
+
+/**
+ * Function: shell_argument
+ *
+ * Returns: The text following the command word of the last request
+ *          (empty if none). Valid until the next call to shell_poll.
+ */
+const char* shell_argument() {
+	return argument;
+}
+
+/**
+ * Function: shell_value
+ *
+ * Returns: The argument of the last request converted to a number
+ *          (checked for rate and pattern, see shell_execute).
+ */
+uint16_t shell_value() {
+	return value;
+}
+
+/**
+ * Function: shell_reply
+ *
+ * Acknowledges a request.
+ *
+ * Parameters:
+ *    ok - True if the request was carried out.
+ */
+void shell_reply(uint8_t ok) {
+	shell_puts_P(ok ? replyOk : replyErr);
+}
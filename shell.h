@@ -0,0 +1,53 @@
+/**
+ * shell.h - EGB240DVR Library, Command shell module header
+ *
+ * Line based remote control over the USB serial interface.
+ *
+ * Commands (terminated by CR or LF):
+ *   rec          Start recording (or resume a paused recording)
+ *   pause        Pause recording (the file stays open)
+ *   play         Start playback
+ *   stop         Stop recording/playback
+ *   file NAME    Select the WAVE file to record/play (8.3 name)
+ *   rate HZ      Select the sample rate for new recordings
+ *   stats        Report statistics for the last take (TLM_STATS frame)
+ *   profile      Report the ISR profile (TLM_PROFILE frames, ISR_PROFILE builds)
+ *   standby      Power down until the record button is pressed, then record
+ *   pattern N    Record a test pattern instead of the ADC (1) or not (0)
+ *   loopback     Measure latency and response with OC4B wired to ADC0
+ *   throughput   Measure the highest rate the SD card sustains (scratch file BENCH.WAV)
+ *   speaker      Play raw 8-bit PCM sent after the "ok" reply, at the
+ *                selected rate, until the stream stops for 500 ms
+ *   help, ?      List commands
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef SHELL_H_
+#define SHELL_H_
+
+// Requests returned by shell_poll, acted on by the state machine
+#define SHELL_NONE		0	// Nothing to do
+#define SHELL_RECORD	1	// rec
+#define SHELL_PLAY		2	// play
+#define SHELL_STOP		3	// stop
+#define SHELL_FILE		4	// file NAME (see shell_argument)
+#define SHELL_RATE		5	// rate HZ (see shell_value)
+#define SHELL_STATS		6	// stats
+#define SHELL_TRANSFER	7	// File transfer frame started (see transfer.h)
+#define SHELL_SPEAKER	8	// speaker
+#define SHELL_PAUSE		9	// pause
+#define SHELL_STANDBY	10	// standby
+#define SHELL_PROFILE	11	// profile
+#define SHELL_PATTERN	12	// pattern N (see shell_value)
+#define SHELL_LOOPBACK	13	// loopback
+#define SHELL_THROUGHPUT	14	// throughput
+
+uint8_t shell_poll();			// Processes waiting input, returns a request (bounded time)
+const char* shell_argument();	// Argument of the last request
+uint16_t shell_value();			// Numeric argument of the last request
+void shell_reply(uint8_t ok);	// Sends "ok" or "err" in response to a request
+
+#endif /* SHELL_H_ */
@@ -0,0 +1,98 @@
+/**
+ * stack.c - EGB240DVR Library, Stack usage monitor
+ *
+ * RAM is 2.5 KB and static buffers take most of it; the stack grows
+ * down from the top of RAM towards them with no protection. Before
+ * any C code runs (in .init1, ahead of the start-up code that clears
+ * .bss and sets up the stack pointer) every byte from the end of
+ * static data (_end) to the top of RAM (__stack) is painted with
+ * STACK_CANARY. Bytes the stack has ever used are overwritten, so
+ * scanning up from _end for the first changed byte gives the stack
+ * high-water mark. The scan is bounded by the free RAM (a few hundred
+ * bytes) and is only done on request.
+ *
+ * tools/ramreport.py gives the static RAM of each module from the
+ * linker map, so the two together show the whole RAM budget.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+
+#include "stack.h"
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+extern uint8_t __data_start;	// Start of static data (linker script)
+extern uint8_t _end;			// End of static data, start of free RAM (linker script)
+extern uint8_t __stack;			// Top of RAM, initial stack pointer (linker script)
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+/**
+ * Function: stack_paint
+ *
+ * Paints the free RAM with STACK_CANARY. Runs from .init1, before r1 is
+ * cleared and the stack is set up, so it is written in assembly and
+ * uses only r24, r25 and Z. Never called directly.
+ */
+void stack_paint() __attribute__((naked, used, section(".init1")));
+void stack_paint() {
+	__asm__ __volatile__ (
+		"	ldi r30, lo8(_end)\n"
+		"	ldi r31, hi8(_end)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(__stack)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(__stack)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:: "i" (STACK_CANARY)
+	);
+}
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: stack_static
+ *
+ * Returns: The bytes of RAM taken by static data (.data, .bss, .noinit).
+ */
+uint16_t stack_static() {
+	return &_end - &__data_start;
+}
+
+/**
+ * Function: stack_free
+ *
+ * Returns: The bytes between the end of static data and the deepest
+ * point the stack has reached since reset.
+ */
+uint16_t stack_free() {
+	const uint8_t* p = &_end;
+	
+	while (p <= &__stack && *p == STACK_CANARY) p++;
+	
+	return p - &_end;
+}
+
+/**
+ * Function: stack_max
+ *
+ * Returns: The deepest stack use since reset, in bytes.
+ */
+uint16_t stack_max() {
+	return (&__stack - &_end) + 1 - stack_free();
+}
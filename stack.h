@@ -0,0 +1,22 @@
+/**
+ * stack.h - EGB240DVR Library, Stack usage monitor header
+ *
+ * The RAM between the end of static data and the top of RAM is
+ * painted at boot; the stack high-water mark is found at run time
+ * by looking for the deepest overwritten byte.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef STACK_H_
+#define STACK_H_
+
+#define STACK_CANARY	0xC5	// Paint pattern
+
+uint16_t stack_static();	// Bytes of static data (.data, .bss, .noinit)
+uint16_t stack_max();		// Deepest stack use since reset, in bytes
+uint16_t stack_free();		// Bytes never reached by the stack since reset
+
+#endif /* STACK_H_ */
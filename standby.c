@@ -0,0 +1,67 @@
+/**
+ * standby.c - EGB240DVR Library, Standby module
+ *
+ * Puts the unit into power-down sleep between sessions. The USB port
+ * is detached and its PLL stopped; all clocks except the watchdog's
+ * stop, so Timer0, the ADC and the PWM are frozen. The SD card stays
+ * powered and FatFs stays mounted, so recording can start on wake
+ * without reinitialising the card.
+ *
+ * The buttons are on PORTF, which has no pin change interrupt on the
+ * ATmega32U4. Instead the watchdog runs in interrupt mode and wakes
+ * the CPU every STANDBY_POLL_MS to sample the record button, which
+ * bounds the wake-up delay (plus the 16K cycle, ~1 ms, oscillator
+ * start-up from power-down).
+ *
+ * Requires:
+ *   serial - USB interface, detached while in standby
+ *   button - Debounced state is resynchronised on wake
+ *   supervisor - Provides the (inactive) watchdog interrupt
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+#include "serial.h"
+#include "button.h"
+#include "standby.h"
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: standby_enter
+ * 
+ * Detaches USB and powers down until the record button is pressed.
+ * The caller must re-attach USB (serial_init) after acting on the wake.
+ * Must not be called while the supervisor is armed (it owns the
+ * watchdog during a take).
+ */
+void standby_enter() {
+	serial_detach();			// Host sees the device unplugged
+	
+	cli();
+	wdt_reset();
+	WDTCSR = (1<<WDCE) | (1<<WDE);	// Timed sequence to change the watchdog
+	WDTCSR = (1<<WDIE) | (1<<WDP0);	// Interrupt only (no reset), 32 ms
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	sei();
+	
+	while (PINF & (1<<BUTTON_RECORD)) {	// Active low
+		sleep_mode();			// Woken by the watchdog
+	}
+	
+	wdt_disable();
+	set_sleep_mode(SLEEP_MODE_IDLE);	// Restore the scheduler's sleep mode
+	button_resync();			// The wake press is not a button event
+}
@@ -0,0 +1,18 @@
+/**
+ * standby.h - EGB240DVR Library, Standby module header
+ *
+ * Power-down standby between sessions, woken by the record button.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef STANDBY_H_
+#define STANDBY_H_
+
+#define STANDBY_POLL_MS		32		// Record button poll period while powered down
+
+void standby_enter();		// Powers down until the record button is pressed
+
+#endif /* STANDBY_H_ */
@@ -0,0 +1,166 @@
+/**
+ * supervisor.c - EGB240DVR Library, Pipeline supervisor
+ *
+ * Every SD card call is bounded by the card driver's timeouts, but a
+ * card that keeps failing (or a hang elsewhere in FatFs) still stops
+ * the take without any sign other than the log. The supervisor tracks
+ * the time since the pipeline last committed a page to (or from) the
+ * card. TASK_SUPERVISE polls supervisor_stalled on the service tick
+ * and, once the limit is exceeded, main recovers in task context by
+ * reinitialising the card and continuing the take in a new file.
+ *
+ * The hardware watchdog backs this up while a take is running. It is
+ * armed in interrupt and reset mode and reset on every committed page.
+ * The first expiry only raises an interrupt, which flags the stall and
+ * posts TASK_SUPERVISE; the hardware clears the interrupt enable, so
+ * if the main loop is itself stuck and recovery never re-arms the
+ * watchdog, the second expiry resets the device. A marker kept in
+ * uninitialised RAM survives that reset and tells main which take was
+ * interrupted, so a recording continues in a new file instead of the
+ * unit returning to the stopped state.
+ *
+ * While the supervisor is disarmed the watchdog interrupt does nothing;
+ * standby (standby.c) uses it only to wake the CPU.
+ *
+ * Requires:
+ *   timer - Timer0 tick count, used for the stall timer
+ *   sched - TASK_SUPERVISE is posted when the watchdog expires
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/wdt.h>
+
+#include "timer.h"
+#include "sched.h"
+#include "supervisor.h"
+#include "profile.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define SUPERVISOR_MAGIC	0x5A7E	// Marks a take in progress across a reset
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static uint16_t takeMarker __attribute__((section(".noinit")));	// SUPERVISOR_MAGIC while armed
+static uint8_t takeContext __attribute__((section(".noinit")));	// Caller's context while armed
+static uint8_t resumed = 0;					// Context of the take interrupted by a reset
+static volatile uint8_t armed = 0;			// Pipeline is supervised
+static uint32_t lastCommit = 0;				// Tick count when the last page was committed
+static volatile uint8_t expired = 0;		// Watchdog interrupt has fired
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: supervisor_init
+ * 
+ * Disarms the watchdog, which stays enabled after a watchdog reset,
+ * and checks whether the reset interrupted a take. Must be called
+ * before the watchdog can expire again (i.e. first thing in main).
+ */
+void supervisor_init() {
+	if ((MCUSR & (1<<WDRF)) && takeMarker == SUPERVISOR_MAGIC) {
+		resumed = takeContext;
+	}
+	takeMarker = 0;
+	
+	MCUSR &= ~(1<<WDRF);		// WDRF forces WDE on, clear it first
+	wdt_disable();
+}
+
+/**
+ * Function: supervisor_resumed
+ * 
+ * Returns: The context passed to supervisor_start (once) if the last
+ * reset was a watchdog reset during a take, otherwise 0.
+ */
+uint8_t supervisor_resumed() {
+	uint8_t r = resumed;
+	
+	resumed = 0;
+	return r;
+}
+
+/**
+ * Function: supervisor_start
+ * 
+ * Arms the watchdog (interrupt then reset, ~2 s each) and restarts the
+ * stall timer. Called when a take starts and after each recovery.
+ *
+ * Parameters:
+ *    context - Nonzero value identifying the take (e.g. the DVR state),
+ *              returned by supervisor_resumed after a watchdog reset.
+ */
+void supervisor_start(uint8_t context) {
+	lastCommit = timer_ticks();
+	expired = 0;
+	armed = 1;
+	takeMarker = SUPERVISOR_MAGIC;
+	takeContext = context;
+	
+	wdt_enable(WDTO_2S);
+	WDTCSR |= (1<<WDIE);		// First expiry interrupts, second resets
+}
+
+/**
+ * Function: supervisor_commit
+ * 
+ * Reports that a page has been written to or read from the SD card.
+ */
+void supervisor_commit() {
+	lastCommit = timer_ticks();
+	wdt_reset();
+}
+
+/**
+ * Function: supervisor_stalled
+ * 
+ * Returns: True if the pipeline is supervised and no page has been
+ * committed for SUPERVISOR_TIMEOUT, or the watchdog has expired.
+ */
+uint8_t supervisor_stalled() {
+	if (!armed) return 0;
+	
+	return expired || (timer_ticks() - lastCommit) > SUPERVISOR_TIMEOUT;
+}
+
+/**
+ * Function: supervisor_stop
+ * 
+ * Disarms the watchdog at the end of a take.
+ */
+void supervisor_stop() {
+	armed = 0;
+	takeMarker = 0;
+	
+	wdt_disable();
+}
+
+/**
+ * ISR: Watchdog Timeout Interrupt
+ * 
+ * No page has been committed for a full watchdog period. The hardware
+ * has cleared WDIE, so the device resets unless recovery re-arms it.
+ * Outside a take the interrupt only wakes the CPU from standby.
+ */
+ISR(WDT_vect) {
+	PROFILE_ENTER();
+	
+	if (armed) {
+		expired = 1;
+		sched_post(TASK_SUPERVISE);
+	}							// Otherwise a standby wake-up
+	
+	PROFILE_EXIT(PROFILE_WDT);
+}
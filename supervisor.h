@@ -0,0 +1,26 @@
+/**
+ * supervisor.h - EGB240DVR Library, Pipeline supervisor header
+ *
+ * Deadline supervision of the record and playback pipelines. The
+ * pipeline reports every committed page; the supervisor flags a stall
+ * when no page has been committed for SUPERVISOR_TIMEOUT, and the
+ * hardware watchdog resets the device if the stall is not recovered.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef SUPERVISOR_H_
+#define SUPERVISOR_H_
+
+#define SUPERVISOR_TIMEOUT	7813	// Longest time between committed pages (ticks, ~500 ms)
+
+void supervisor_init();				// Disarms the watchdog after reset, call first
+uint8_t supervisor_resumed();		// Context of a take interrupted by a watchdog reset, or 0
+void supervisor_start(uint8_t context);	// Arms the watchdog and restarts the stall timer
+void supervisor_commit();			// Reports a page committed to/from the SD card
+uint8_t supervisor_stalled();		// True if the armed pipeline has stalled
+void supervisor_stop();				// Disarms the watchdog at the end of a take
+
+#endif /* SUPERVISOR_H_ */
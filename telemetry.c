@@ -0,0 +1,438 @@
+/**
+ * telemetry.c - EGB240DVR Library, Binary telemetry module
+ *
+ * Replaces printf status output with fixed-layout binary frames.
+ * Each event costs a handful of byte copies into the serial transmit
+ * ring instead of a call into the avr-libc formatter, and the format
+ * strings no longer occupy flash. Frames are queued whole or dropped
+ * (see serial_write), so the host decoder can always resynchronise.
+ *
+ * Requires:
+ *   serial - USB serial interface (non-blocking transmit ring)
+ *   sched  - Scheduler (number of tasks in TLM_TASKS)
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+
+#include "sched.h"
+#include "serial.h"
+#include "telemetry.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define TLM_PAYLOAD_MAX	TLM_TASKS_LENGTH(TASK_COUNT)	// Largest payload (TLM_TASKS, every task)
+
+// Every fixed length payload must fit the frame buffer of tlm_send
+#if TLM_PATTERN_LENGTH > TLM_PAYLOAD_MAX || TLM_PROFILE_LENGTH > TLM_PAYLOAD_MAX || TLM_THROUGHPUT_LENGTH > TLM_PAYLOAD_MAX || TLM_RESPONSE_LENGTH > TLM_PAYLOAD_MAX
+#error "Telemetry payload larger than TLM_PAYLOAD_MAX"
+#endif
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+/**
+ * Function: tlm_send
+ *
+ * Builds a frame around a payload and queues it for transmission.
+ *
+ * Parameters:
+ *    type - Frame type (TLM_*).
+ *    payload - Pointer to the payload bytes.
+ *    length - Number of payload bytes (at most TLM_PAYLOAD_MAX).
+ */
+static void tlm_send(uint8_t type, const uint8_t* payload, uint8_t length) {
+	uint8_t frame[TLM_FRAME(TLM_PAYLOAD_MAX)];
+	uint8_t sum = type + length;
+	uint8_t i;
+	
+	frame[0] = TLM_SYNC;
+	frame[1] = type;
+	frame[2] = length;
+	for (i = 0; i < length; i++) {
+		frame[3 + i] = payload[i];
+		sum += payload[i];
+	}
+	frame[3 + length] = sum;
+	
+	serial_write(frame, TLM_FRAME(length));
+}
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: telemetry_state
+ *
+ * Reports a transition of the main state machine.
+ *
+ * Parameters:
+ *    state - The new state.
+ */
+void telemetry_state(uint8_t state) {
+	tlm_send(TLM_STATE, &state, TLM_STATE_LENGTH);
+}
+
+/**
+ * Function: telemetry_sd
+ *
+ * Reports the time taken to write or read one page on the SD card.
+ *
+ * Parameters:
+ *    op - TLM_SD_WRITE or TLM_SD_READ.
+ *    ticks - Duration in Timer0 ticks (64 us).
+ */
+void telemetry_sd(uint8_t op, uint16_t ticks) {
+	uint8_t payload[TLM_SD_LENGTH];
+	
+	payload[0] = op;
+	payload[1] = ticks;
+	payload[2] = ticks >> 8;
+	tlm_send(TLM_SD, payload, TLM_SD_LENGTH);
+}
+
+/**
+ * Function: telemetry_stats
+ *
+ * Reports a summary at the end of a recording or playback.
+ *
+ * Parameters:
+ *    pages - Number of pages transferred to/from the SD card.
+ *    maxTicks - Worst case page access time in Timer0 ticks (64 us).
+ */
+void telemetry_stats(uint16_t pages, uint16_t maxTicks) {
+	uint8_t payload[TLM_STATS_LENGTH];
+	uint16_t dropped = serial_dropped();
+	
+	payload[0] = pages;
+	payload[1] = pages >> 8;
+	payload[2] = maxTicks;
+	payload[3] = maxTicks >> 8;
+	payload[4] = dropped;
+	payload[5] = dropped >> 8;
+	tlm_send(TLM_STATS, payload, TLM_STATS_LENGTH);
+}
+
+/**
+ * Function: telemetry_error
+ *
+ * Reports an error code.
+ *
+ * Parameters:
+ *    source - Module reporting the error (TLM_SRC_*).
+ *    code - Error code, meaning depends on the source.
+ */
+void telemetry_error(uint8_t source, uint8_t code) {
+	uint8_t payload[TLM_ERROR_LENGTH];
+	
+	payload[0] = source;
+	payload[1] = code;
+	tlm_send(TLM_ERROR, payload, TLM_ERROR_LENGTH);
+}
+
+/**
+ * Function: telemetry_log
+ *
+ * Sends a deferred log record. Normally called by log_flush only.
+ *
+ * Parameters:
+ *    id - Message ID (index into log_msgs.h).
+ *    a - First format argument.
+ *    b - Second format argument.
+ */
+void telemetry_log(uint8_t id, int16_t a, int16_t b) {
+	uint8_t payload[TLM_LOG_LENGTH];
+	
+	payload[0] = id;
+	payload[1] = a;
+	payload[2] = a >> 8;
+	payload[3] = b;
+	payload[4] = b >> 8;
+	tlm_send(TLM_LOG, payload, TLM_LOG_LENGTH);
+}
+
+/**
+ * Function: telemetry_latency
+ *
+ * Reports audio interrupt entry times, in CPU cycles after the
+ * interrupt source fired (see adc_latency).
+ *
+ * Parameters:
+ *    adcMin - Earliest ADC interrupt entry (conversion + response).
+ *    adcMax - Latest ADC interrupt entry.
+ *    pwmMax - Latest PWM (Timer4 overflow) interrupt entry.
+ */
+void telemetry_latency(uint16_t adcMin, uint16_t adcMax, uint16_t pwmMax) {
+	uint8_t payload[TLM_LATENCY_LENGTH];
+	
+	payload[0] = adcMin;
+	payload[1] = adcMin >> 8;
+	payload[2] = adcMax;
+	payload[3] = adcMax >> 8;
+	payload[4] = pwmMax;
+	payload[5] = pwmMax >> 8;
+	tlm_send(TLM_LATENCY, payload, TLM_LATENCY_LENGTH);
+}
+
+/**
+ * Function: telemetry_stream
+ *
+ * Reports the end of a speaker stream.
+ *
+ * Parameters:
+ *    underruns - Times the playback ring ran empty.
+ *    overruns - Times the playback ring was full with data waiting.
+ */
+void telemetry_stream(uint16_t underruns, uint16_t overruns) {
+	uint8_t payload[TLM_STREAM_LENGTH];
+	
+	payload[0] = underruns;
+	payload[1] = underruns >> 8;
+	payload[2] = overruns;
+	payload[3] = overruns >> 8;
+	tlm_send(TLM_STREAM, payload, TLM_STREAM_LENGTH);
+}
+
+/**
+ * Function: telemetry_idle
+ *
+ * Reports the time the main loop spent asleep (CPU headroom).
+ *
+ * Parameters:
+ *    permille - Idle time in 1/1000ths of the measurement interval.
+ */
+void telemetry_idle(uint16_t permille) {
+	uint8_t payload[TLM_IDLE_LENGTH];
+	
+	payload[0] = permille;
+	payload[1] = permille >> 8;
+	tlm_send(TLM_IDLE, payload, TLM_IDLE_LENGTH);
+}
+
+/**
+ * Function: telemetry_tasks
+ *
+ * Reports the scheduler accounting since the last report.
+ *
+ * Parameters:
+ *    maxRun - Longest run time of each task (ticks), in priority order.
+ *    misses - Deadline misses of each task (saturated at 255).
+ *    count - Number of tasks (at most TLM_PAYLOAD_MAX / 3).
+ */
+void telemetry_tasks(const uint16_t* maxRun, const uint8_t* misses, uint8_t count) {
+	uint8_t payload[TLM_PAYLOAD_MAX];
+	uint8_t i;
+	
+	if (count > TLM_PAYLOAD_MAX / 3) count = TLM_PAYLOAD_MAX / 3;
+	for (i = 0; i < count; i++) {
+		payload[3 * i] = maxRun[i];
+		payload[3 * i + 1] = maxRun[i] >> 8;
+		payload[3 * i + 2] = misses[i];
+	}
+	tlm_send(TLM_TASKS, payload, TLM_TASKS_LENGTH(count));
+}
+
+/**
+ * Function: telemetry_load
+ *
+ * Reports the CPU load breakdown (see load.h).
+ *
+ * Parameters:
+ *    permille - Load of each entry in 1/1000ths of the interval.
+ *    count - Number of entries (at most TLM_PAYLOAD_MAX / 2).
+ */
+void telemetry_load(const uint16_t* permille, uint8_t count) {
+	uint8_t payload[TLM_PAYLOAD_MAX];
+	uint8_t i;
+	
+	if (count > TLM_PAYLOAD_MAX / 2) count = TLM_PAYLOAD_MAX / 2;
+	for (i = 0; i < count; i++) {
+		payload[2 * i] = permille[i];
+		payload[2 * i + 1] = permille[i] >> 8;
+	}
+	tlm_send(TLM_LOAD, payload, TLM_LOAD_LENGTH(count));
+}
+
+/**
+ * Function: telemetry_wake
+ *
+ * Reports the time from waking from standby to the first sample.
+ *
+ * Parameters:
+ *    ticks - Wake-up time in Timer0 ticks (64 us).
+ */
+void telemetry_wake(uint16_t ticks) {
+	uint8_t payload[TLM_WAKE_LENGTH];
+	
+	payload[0] = ticks;
+	payload[1] = ticks >> 8;
+	tlm_send(TLM_WAKE, payload, TLM_WAKE_LENGTH);
+}
+
+/**
+ * Function: telemetry_profile
+ *
+ * Reports one row of the ISR profile table (see profile.h).
+ *
+ * Parameters:
+ *    isr - Profiled ISR (PROFILE_*).
+ *    count - Times the ISR ran.
+ *    average - Average run time in cycles.
+ *    max - Longest run time in cycles.
+ *    latency - Longest trigger to entry time in cycles (0 if not measured).
+ */
+void telemetry_profile(uint8_t isr, uint32_t count, uint16_t average, uint16_t max, uint16_t latency) {
+	uint8_t payload[TLM_PROFILE_LENGTH];
+	
+	payload[0] = isr;
+	payload[1] = count;
+	payload[2] = count >> 8;
+	payload[3] = count >> 16;
+	payload[4] = count >> 24;
+	payload[5] = average;
+	payload[6] = average >> 8;
+	payload[7] = max;
+	payload[8] = max >> 8;
+	payload[9] = latency;
+	payload[10] = latency >> 8;
+	tlm_send(TLM_PROFILE, payload, TLM_PROFILE_LENGTH);
+}
+
+/**
+ * Function: telemetry_memory
+ *
+ * Reports the RAM budget (see stack.h).
+ *
+ * Parameters:
+ *    data - Bytes of static data.
+ *    stack - Deepest stack use since reset in bytes.
+ *    unused - Bytes never used by static data or the stack.
+ */
+void telemetry_memory(uint16_t data, uint16_t stack, uint16_t unused) {
+	uint8_t payload[TLM_MEMORY_LENGTH];
+	
+	payload[0] = data;
+	payload[1] = data >> 8;
+	payload[2] = stack;
+	payload[3] = stack >> 8;
+	payload[4] = unused;
+	payload[5] = unused >> 8;
+	tlm_send(TLM_MEMORY, payload, TLM_MEMORY_LENGTH);
+}
+
+/**
+ * Function: telemetry_pattern
+ *
+ * Reports the test pattern check of the last take (see pattern.h).
+ *
+ * Parameters:
+ *    pages - Pages checked.
+ *    breaks - Breaks in the sequence.
+ *    lost - Samples missing at the measured breaks.
+ *    unresolved - Breaks whose size was not found (repeated or corrupt data).
+ *    first - Page of the first break (0xFFFF if none).
+ */
+void telemetry_pattern(uint16_t pages, uint16_t breaks, uint32_t lost, uint16_t unresolved, uint16_t first) {
+	uint8_t payload[TLM_PATTERN_LENGTH];
+	
+	payload[0] = pages;
+	payload[1] = pages >> 8;
+	payload[2] = breaks;
+	payload[3] = breaks >> 8;
+	payload[4] = lost;
+	payload[5] = lost >> 8;
+	payload[6] = lost >> 16;
+	payload[7] = lost >> 24;
+	payload[8] = unresolved;
+	payload[9] = unresolved >> 8;
+	payload[10] = first;
+	payload[11] = first >> 8;
+	tlm_send(TLM_PATTERN, payload, TLM_PATTERN_LENGTH);
+}
+
+/**
+ * Function: telemetry_loopback
+ *
+ * Reports the loopback impulse response (see loopback.h).
+ *
+ * Parameters:
+ *    latency - Round trip latency in 1/100ths of a sample.
+ *    peak - Peak of the summed impulse responses (ADC counts).
+ *    rate - Sample rate of the test.
+ */
+void telemetry_loopback(int16_t latency, int16_t peak, uint16_t rate) {
+	uint8_t payload[TLM_LOOPBACK_LENGTH];
+	
+	payload[0] = latency;
+	payload[1] = latency >> 8;
+	payload[2] = peak;
+	payload[3] = peak >> 8;
+	payload[4] = rate;
+	payload[5] = rate >> 8;
+	tlm_send(TLM_LOOPBACK, payload, TLM_LOOPBACK_LENGTH);
+}
+
+/**
+ * Function: telemetry_response
+ *
+ * Reports the loopback measurement of one tone (see loopback.h).
+ *
+ * Parameters:
+ *    frequency - Tone frequency in Hz.
+ *    inPhase - Sum of input samples times the cosine of the tone.
+ *    quadrature - Sum of input samples times the sine of the tone.
+ */
+void telemetry_response(uint16_t frequency, int32_t inPhase, int32_t quadrature) {
+	uint8_t payload[TLM_RESPONSE_LENGTH];
+	
+	payload[0] = frequency;
+	payload[1] = frequency >> 8;
+	payload[2] = inPhase;
+	payload[3] = inPhase >> 8;
+	payload[4] = inPhase >> 16;
+	payload[5] = inPhase >> 24;
+	payload[6] = quadrature;
+	payload[7] = quadrature >> 8;
+	payload[8] = quadrature >> 16;
+	payload[9] = quadrature >> 24;
+	tlm_send(TLM_RESPONSE, payload, TLM_RESPONSE_LENGTH);
+}
+
+/**
+ * Function: telemetry_throughput
+ *
+ * Reports one row of the record path throughput table (see throughput.h).
+ *
+ * Parameters:
+ *    page - Page size in bytes.
+ *    batch - Pages per wave_write.
+ *    depth - Pages in the audio buffer.
+ *    aligned - Non-zero if the data started on a sector boundary.
+ *    rate - Highest rate sustained in bytes per second (0 if none).
+ *    worst - Worst write time at that rate (ticks).
+ */
+void telemetry_throughput(uint16_t page, uint8_t batch, uint8_t depth, uint8_t aligned, uint32_t rate, uint16_t worst) {
+	uint8_t payload[TLM_THROUGHPUT_LENGTH];
+	
+	payload[0] = page;
+	payload[1] = page >> 8;
+	payload[2] = batch;
+	payload[3] = depth;
+	payload[4] = aligned;
+	payload[5] = rate;
+	payload[6] = rate >> 8;
+	payload[7] = rate >> 16;
+	payload[8] = rate >> 24;
+	payload[9] = worst;
+	payload[10] = worst >> 8;
+	tlm_send(TLM_THROUGHPUT, payload, TLM_THROUGHPUT_LENGTH);
+}
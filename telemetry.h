@@ -0,0 +1,90 @@
+/**
+ * telemetry.h - EGB240DVR Library, Binary telemetry module header
+ *
+ * Compact fixed-layout telemetry frames sent over the USB serial
+ * interface in place of formatted status text. Frames are decoded
+ * into readable logs on the host by tools/telemetry.py.
+ *
+ * Frame layout:
+ *   TLM_SYNC, type, length, payload[length], checksum
+ * where checksum is the 8-bit sum of type, length and payload bytes.
+ * Multi-byte payload fields are little endian.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#define TLM_SYNC		0xA5	// First byte of every frame
+
+// Frame types (payload layout in brackets)
+#define TLM_STATE		0x01	// State change [uint8 state]
+#define TLM_SD			0x02	// SD page access [uint8 op, uint16 latency ticks]
+#define TLM_STATS		0x03	// End of take [uint16 pages, uint16 max latency ticks, uint16 console drops]
+#define TLM_ERROR		0x04	// Error code [uint8 source, uint8 code]
+#define TLM_LOG			0x05	// Log record [uint8 message id, int16 a, int16 b]
+#define TLM_LATENCY		0x06	// Audio ISR entry times in cycles [uint16 adc min, uint16 adc max, uint16 pwm max]
+#define TLM_STREAM		0x07	// End of speaker stream [uint16 underruns, uint16 overruns]
+#define TLM_IDLE		0x08	// CPU idle (sleep) time [uint16 1/1000ths of elapsed time]
+#define TLM_TASKS		0x09	// Scheduler accounting, per task in priority order [uint16 max run ticks, uint8 deadline misses]
+#define TLM_LOAD		0x0A	// CPU load over the last second, 1/1000ths [uint16 adc, timer0, pwm, foreground, idle]
+#define TLM_WAKE		0x0B	// Woken from standby [uint16 ticks from wake to sampling]
+#define TLM_PROFILE		0x0C	// ISR profile row [uint8 isr, uint32 count, uint16 avg cycles, uint16 max cycles, uint16 max latency cycles]
+#define TLM_MEMORY		0x0D	// RAM use in bytes [uint16 static data, uint16 stack high-water mark, uint16 never used]
+#define TLM_PATTERN		0x0E	// Test pattern check [uint16 pages, uint16 breaks, uint32 samples lost, uint16 unresolved breaks, uint16 first break page]
+#define TLM_LOOPBACK	0x0F	// Loopback impulse response [int16 latency 1/100 samples, int16 peak (sum of impulses), uint16 sample rate]
+#define TLM_RESPONSE	0x10	// Loopback tone [uint16 frequency Hz, int32 input x cosine sum, int32 input x sine sum]
+#define TLM_THROUGHPUT	0x11	// Throughput row [uint16 page bytes, uint8 pages per write, uint8 pages in buffer, uint8 aligned, uint32 max bytes/s, uint16 worst write ticks]
+
+// Payload lengths (bytes)
+#define TLM_STATE_LENGTH		1
+#define TLM_SD_LENGTH			3
+#define TLM_STATS_LENGTH		6
+#define TLM_ERROR_LENGTH		2
+#define TLM_LOG_LENGTH			5
+#define TLM_LATENCY_LENGTH		6
+#define TLM_STREAM_LENGTH		4
+#define TLM_IDLE_LENGTH			2
+#define TLM_TASKS_LENGTH(n)		(3 * (n))	// n tasks
+#define TLM_LOAD_LENGTH(n)		(2 * (n))	// n entries
+#define TLM_WAKE_LENGTH			2
+#define TLM_PROFILE_LENGTH		11
+#define TLM_MEMORY_LENGTH		6
+#define TLM_PATTERN_LENGTH		12
+#define TLM_LOOPBACK_LENGTH		6
+#define TLM_RESPONSE_LENGTH		10
+#define TLM_THROUGHPUT_LENGTH	11
+
+#define TLM_FRAME(length)	((length) + 4)	// Size of a complete frame: sync, type, length and checksum around the payload
+#define TLM_LOG_FRAME		TLM_FRAME(TLM_LOG_LENGTH)
+
+// SD operations (TLM_SD)
+#define TLM_SD_WRITE	0
+#define TLM_SD_READ		1
+
+// Error sources (TLM_ERROR)
+#define TLM_SRC_MAIN	0		// Main state machine (code = invalid state)
+#define TLM_SRC_SUPERVISOR	1	// Pipeline supervisor (code = state of the recovered pipeline)
+
+void telemetry_state(uint8_t state);					// Sends a state change frame
+void telemetry_sd(uint8_t op, uint16_t ticks);			// Sends an SD latency frame
+void telemetry_stats(uint16_t pages, uint16_t maxTicks);	// Sends an end of take summary
+void telemetry_error(uint8_t source, uint8_t code);		// Sends an error frame
+void telemetry_log(uint8_t id, int16_t a, int16_t b);	// Sends a log record (see log.h)
+void telemetry_latency(uint16_t adcMin, uint16_t adcMax, uint16_t pwmMax);	// Sends audio ISR latencies
+void telemetry_stream(uint16_t underruns, uint16_t overruns);	// Sends a speaker stream summary
+void telemetry_idle(uint16_t permille);					// Sends the CPU idle time
+void telemetry_tasks(const uint16_t* maxRun, const uint8_t* misses, uint8_t count);	// Sends task accounting
+void telemetry_wake(uint16_t ticks);					// Sends the standby wake-up time
+void telemetry_profile(uint8_t isr, uint32_t count, uint16_t average, uint16_t max, uint16_t latency);	// Sends an ISR profile row
+void telemetry_memory(uint16_t data, uint16_t stack, uint16_t unused);	// Sends the RAM use
+void telemetry_pattern(uint16_t pages, uint16_t breaks, uint32_t lost, uint16_t unresolved, uint16_t first);	// Sends the test pattern check
+void telemetry_loopback(int16_t latency, int16_t peak, uint16_t rate);	// Sends the loopback latency
+void telemetry_response(uint16_t frequency, int32_t inPhase, int32_t quadrature);	// Sends a loopback tone result
+void telemetry_throughput(uint16_t page, uint8_t batch, uint8_t depth, uint8_t aligned, uint32_t rate, uint16_t worst);	// Sends a throughput table row
+void telemetry_load(const uint16_t* permille, uint8_t count);	// Sends the CPU load breakdown
+
+#endif /* TELEMETRY_H_ */
@@ -0,0 +1,242 @@
+/**
+ * throughput.c - EGB240DVR Library, Record path throughput benchmark
+ *
+ * Streams synthetic pages through wave_write to a scratch file on the
+ * SD card, paced as the ADC would fill the audio buffer, and raises
+ * the rate until a deadline is missed. The buffer holds
+ * THROUGHPUT_BUFFER / page pages; a write of a batch of pages must
+ * complete before the producer needs the first of them again. A rate
+ * passes if THROUGHPUT_TRIAL bytes are written without a miss. The
+ * rate is doubled from THROUGHPUT_RATE_START up to the first miss and
+ * then refined by bisection.
+ *
+ * Each configuration of the table below (page size, pages per
+ * wave_write, and whether the data starts on a sector boundary or
+ * after the 44 byte WAVE header as in a recording) is measured in
+ * turn. Its highest passing rate and the worst write time at that
+ * rate are sent as a TLM_THROUGHPUT frame, decoded by
+ * tools/telemetry.py into a table row with the sample rates it allows
+ * for 8 and 16-bit samples.
+ *
+ * Writes are issued by the SD write task, posted every ~1 ms while the
+ * benchmark runs, so a write may start up to 1 ms after its batch is
+ * full; the recorder posts the task from the ADC interrupt instead.
+ *
+ * Requires:
+ *   wave - WAVE file interface (scratch file)
+ *   buffer - Audio buffer provides the synthetic samples
+ *   timer - Tick count paces the writes
+ *   serial - Console ring space
+ *   telemetry - TLM_THROUGHPUT frames
+ *   sched - Write task is posted again when the next batch is due
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include <string.h>
+
+#include "wave.h"
+#include "buffer.h"
+#include "timer.h"
+#include "serial.h"
+#include "telemetry.h"
+#include "sched.h"
+#include "throughput.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define THROUGHPUT_HEADER	44		// WAVE header bytes before the data
+#define THROUGHPUT_SECTOR	512		// SD card sector size
+
+// Configuration measured by one row of the table
+typedef struct {
+	uint16_t page;			// Page size (bytes)
+	uint8_t batch;			// Pages per wave_write
+	uint8_t aligned;		// Data starts on a sector boundary
+} THROUGHPUT_ROW;
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+static const THROUGHPUT_ROW rows[] PROGMEM = {
+	{ 512, 1, 0 },			// The recorder as built
+	{ 512, 1, 1 },
+	{ 256, 1, 0 },
+	{ 256, 2, 0 },			// Batched: two pages per write, four in the buffer
+	{ 256, 2, 1 },
+	{ 128, 4, 1 }
+};
+#define THROUGHPUT_ROWS	(sizeof(rows) / sizeof(rows[0]))
+
+static THROUGHPUT_ROW config;		// Configuration being measured
+static uint8_t row = THROUGHPUT_ROWS;	// Index of the configuration (THROUGHPUT_ROWS: finished)
+static uint8_t* samples;			// Synthetic samples (idle audio buffer)
+static char selected[13];			// File selected before the benchmark
+
+static uint32_t rate;				// Rate being tried (bytes per second)
+static uint32_t passRate;			// Highest rate passed
+static uint32_t failRate;			// Lowest rate missed (0 if none yet)
+static uint8_t refinements;			// Bisection steps taken
+static uint16_t worst;				// Worst write time at passRate (ticks)
+
+static uint32_t start;				// Tick count at the start of the trial
+static uint16_t written;			// Pages written in the trial
+static uint16_t trialWorst;			// Worst write time in the trial (ticks)
+static uint8_t pendingRow;			// Flag: row result waiting for console space
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+/**
+ * Function: throughput_ticks
+ *
+ * Returns: Ticks from the start of the trial until the given number of
+ *          pages has been produced at the current rate.
+ */
+static uint32_t throughput_ticks(uint16_t pages) {
+	return (uint32_t)pages * config.page * TIMER_TICKS_PER_SEC / rate;
+}
+
+// Starts streaming at the current rate
+static void throughput_trial() {
+	written = 0;
+	trialWorst = 0;
+	start = timer_ticks();
+}
+
+// Starts the configuration of the current row with a new scratch file
+static void throughput_row() {
+	memcpy_P(&config, &rows[row], sizeof(config));
+	rate = THROUGHPUT_RATE_START;
+	passRate = 0;
+	failRate = 0;
+	refinements = 0;
+	worst = 0;
+
+	wave_create();
+	if (config.aligned) {
+		wave_write(samples, THROUGHPUT_SECTOR - THROUGHPUT_HEADER);	// Pad the data to a sector boundary
+	}
+	throughput_trial();
+}
+
+// Records the result of a trial and selects the next rate, or ends the row
+static void throughput_result(uint8_t pass) {
+	if (pass) {
+		passRate = rate;
+		worst = trialWorst;
+	} else {
+		failRate = rate;
+	}
+
+	if (!failRate && rate < THROUGHPUT_RATE_MAX) {
+		rate *= 2;										// Still ramping up
+		if (rate > THROUGHPUT_RATE_MAX) rate = THROUGHPUT_RATE_MAX;
+	} else if (failRate && refinements < THROUGHPUT_BISECT) {
+		rate = (passRate + failRate) / 2;				// Between the last pass and miss
+		refinements++;
+	} else {
+		wave_close();									// Row complete
+		pendingRow = 1;
+		return;
+	}
+	throughput_trial();
+}
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: throughput_start
+ *
+ * Starts the benchmark with the first configuration. The selected file
+ * is kept and restored by throughput_stop. Takes the audio buffer and
+ * the SD card, so call only while stopped.
+ */
+void throughput_start() {
+	uint16_t i;
+
+	strcpy(selected, wave_selected());
+	wave_select(THROUGHPUT_NAME);
+
+	samples = buffer_block();
+	for (i = 0; i < THROUGHPUT_BUFFER; i++) {
+		samples[i] = i;									// Synthetic ramp
+	}
+
+	row = 0;
+	pendingRow = 0;
+	throughput_row();
+}
+
+/**
+ * Function: throughput_poll
+ *
+ * Writes the next batch of pages if it is due, and moves on to the
+ * next rate or configuration when a trial ends. Call from the SD write
+ * task at least every millisecond.
+ *
+ * Returns: True once every row has been measured and sent.
+ */
+uint8_t throughput_poll() {
+	uint16_t ticks, depth;
+	uint32_t now;
+
+	if (pendingRow) {									// ---Send the finished row---
+		if (serial_free() < TLM_FRAME(TLM_THROUGHPUT_LENGTH)) return 0;
+		depth = THROUGHPUT_BUFFER / config.page;
+		telemetry_throughput(config.page, config.batch, depth, config.aligned, passRate, worst);
+		pendingRow = 0;
+		if (++row < THROUGHPUT_ROWS) throughput_row();
+	}
+	if (row >= THROUGHPUT_ROWS) return 1;
+
+	now = timer_ticks();
+	if ((int32_t)(now - start - throughput_ticks(written + config.batch)) < 0) return 0;	// Batch not full yet
+
+	if (wave_write(samples, config.page * config.batch)) {
+		failRate = rate;								// Card error: end the row
+		refinements = THROUGHPUT_BISECT;
+		throughput_result(0);
+		return 0;
+	}
+	ticks = timer_ticks() - now;
+	if (ticks > trialWorst) trialWorst = ticks;
+
+	// The batch had to be written before the producer wrapped round to its first page
+	depth = THROUGHPUT_BUFFER / config.page;
+	if ((int32_t)(timer_ticks() - start - throughput_ticks(written + depth)) > 0) {
+		throughput_result(0);							// Deadline missed
+	} else if ((uint32_t)(written += config.batch) * config.page >= THROUGHPUT_TRIAL) {
+		throughput_result(1);							// Rate sustained
+	} else if ((int32_t)(timer_ticks() - start - throughput_ticks(written + config.batch)) >= 0) {
+		sched_post(TASK_SD_WRITE);						// Next batch is already due
+	}
+	return 0;
+}
+
+/**
+ * Function: throughput_stop
+ *
+ * Ends the benchmark (finished or not): closes the scratch file and
+ * selects the file selected before it started.
+ */
+void throughput_stop() {
+	if (row < THROUGHPUT_ROWS && !pendingRow) {
+		wave_close();									// Row in progress
+	}
+	row = THROUGHPUT_ROWS;
+	pendingRow = 0;
+	wave_select(selected);
+}
@@ -0,0 +1,27 @@
+/**
+ * throughput.h - EGB240DVR Library, Record path throughput benchmark header
+ *
+ * Finds the highest data rate the SD card sustains through wave_write
+ * for several page sizes, writes per call and data alignments, with
+ * the deadlines of the audio buffer.
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef THROUGHPUT_H_
+#define THROUGHPUT_H_
+
+#define THROUGHPUT_BUFFER		1024		// Audio buffer size (bytes), shared by the pages
+#define THROUGHPUT_TRIAL		65536UL		// Bytes streamed at each rate tried
+#define THROUGHPUT_RATE_START	16000UL		// First rate tried (bytes per second, about the recording rate)
+#define THROUGHPUT_RATE_MAX		512000UL	// Highest rate tried
+#define THROUGHPUT_BISECT		4			// Rate refinements after the first miss
+#define THROUGHPUT_NAME			"BENCH.WAV"	// Scratch file
+
+void throughput_start();		// Starts the benchmark (takes the buffer and the SD card)
+uint8_t throughput_poll();		// Writes the next page when due, returns true when finished
+void throughput_stop();			// Closes the scratch file and restores the selected file
+
+#endif /* THROUGHPUT_H_ */
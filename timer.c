@@ -7,9 +7,14 @@
  * The timer module sequences and triggers sampling of the ADC,
  * and is required for operation of the FAT file system module.
  * The timer may also be used to trigger other regular events.
+ * Every ~1 ms it scans the buttons (see button.c) and posts the
+ * USB and logging tasks (see sched.c).
  *
  * Requires:
  *   lib/fatfs - FatFs FAT file system library published by ChaN
+ *   sched - Scheduler, the service tick posts main loop tasks
+ *   button - Button debouncing, scanned from the Timer0 ISR
+ *   load - CPU load meter, accounts the Timer0 ISR run time
  *
  * Version: v1.0
  *    Date: 10/04/2016
@@ -26,12 +31,18 @@
 #include "lib/fatfs/diskio.h"
  
 #include "timer.h"
+#include "sched.h"
+#include "button.h"
+#include "load.h"
+#include "profile.h"
 
 /************************************************************************/
 /* GLOBAL VARIABLES                                                     */
 /************************************************************************/
 volatile uint8_t timer_fatfs = TIMER_INTERVAL_FATFS;	// Counter variable for servicing FatFs
 volatile uint16_t timer_led = TIMER_INTERVAL_LED;		// Counter for debug LED flashing
+volatile uint32_t timer_count = 0;						// Free running tick counter (64 us per tick)
+volatile uint8_t timer_event = TIMER_INTERVAL_EVENT;	// Counter for the service tick/button scan
 
 /************************************************************************/
 /* PUBLIC/USER FUNCTIONS                                                */
@@ -53,6 +64,26 @@ void timer_init() {
 	DDRD |= (1<<PIND7);		// Set PORTD7 (LED4) as output
 }
 
+/**
+ * Function: timer_ticks
+ * 
+ * Returns the number of Timer0 ticks (64 us each) elapsed since
+ * timer_init was called. Used to time long running operations
+ * such as file transfers. Wraps after ~76 hours.
+ *
+ * Returns: Free running tick count (unsigned 32-bit integer)
+ */
+uint32_t timer_ticks() {
+	uint32_t ticks;
+	uint8_t sreg = SREG;
+	
+	cli();				// 32-bit read is not atomic
+	ticks = timer_count;
+	SREG = sreg;
+	
+	return ticks;
+}
+
 /************************************************************************/
 /* INTERRUPT SERVICE ROUTINES                                           */
 /************************************************************************/
@@ -66,6 +97,9 @@ void timer_init() {
  * Used to generate regular, timed events.
  */
 ISR(TIMER0_COMPA_vect) {
+	LOAD_ENTER();
+	
+	timer_count++;
 	
 	// Timer to service FatFs module (~10 ms interval)
 	if (!(--timer_fatfs)) {
@@ -79,10 +113,20 @@ ISR(TIMER0_COMPA_vect) {
 		//disk_timerproc();
 	//}
 	
+	// Service tick and button scan (~1 ms interval)
+	if (!(--timer_event)) {
+		timer_event = TIMER_INTERVAL_EVENT;
+		button_scan();
+		sched_post(TASK_SUPERVISE);
+		sched_post(TASK_USB);
+		sched_post(TASK_LOG);
+	}
+	
 	// Timer to flash debug LED (1 Hz, 50% duty cycle flash)
 	if (!(--timer_led)) {
 		timer_led = TIMER_INTERVAL_LED;
 		PORTD ^= (1<<PIND7);
 	}
 	
+	LOAD_EXIT(LOAD_TIMER0);
 }
\ No newline at end of file
@@ -16,7 +16,10 @@
 // Defines for timer intervals
 #define TIMER_INTERVAL_FATFS	156		// 10 ms interval
 #define TIMER_INTERVAL_LED		7813	// 500 ms interval
+#define TIMER_TICKS_PER_SEC		15625	// Timer0 ticks per second
+#define TIMER_INTERVAL_EVENT	16		// ~1 ms interval (service tick, button scan)
 
-void timer_init();	// Initialise and start Timer0
+void timer_init();			// Initialise and start Timer0
+uint32_t timer_ticks();		// Returns ticks elapsed since timer_init (64 us per tick)
 
 #endif /* TIMER_H_ */
\ No newline at end of file
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""
+pattern.py - EGB240DVR test pattern checker
+
+Checks WAVE files recorded in test pattern mode (shell "pattern 1",
+see pattern.h) and reports every place where the sequence breaks:
+the sample offset and time in the file, and how many samples were
+lost or repeated there. The segments of a recovered take
+(EGB240.WAV, EGB24001.WAV, ...) can be given in order and are checked
+as one recording, so samples lost across a recovery are counted too.
+
+Any two consecutive samples give the position in the sequence
+(period 65535), so the size of a break is exact up to half a period.
+Samples that do not continue the sequence for CONFIRM samples are
+reported as corrupt.
+
+Usage:
+    python3 tools/pattern.py EGB240.WAV [EGB24001.WAV ...]
+
+The exit status is 1 if any break was found.
+"""
+
+import sys
+import wave
+
+PERIOD = 65535          # Samples before the sequence repeats
+SEED = 0x01             # PATTERN_SEED (the sample before it is 0)
+CONFIRM = 4             # Samples that must follow a break for it to count as a jump
+
+
+def pattern_next(last, before):
+    """Returns the next sample of the sequence (PATTERN_NEXT)."""
+    return (before ^ last ^ (last << 1) ^ (before >> 7) ^ (last << 3) ^ (before >> 5)) & 0xFF
+
+
+def sequence_index():
+    """Maps each pair of consecutive samples to the position of the second."""
+    index = {}
+    last, before = SEED, 0
+    for position in range(PERIOD):
+        sample = pattern_next(last, before)
+        index[(last, sample)] = position
+        before, last = last, sample
+    return index
+
+
+def read_samples(path):
+    """Returns the samples of an 8-bit mono WAVE file and its sample rate."""
+    with wave.open(path, "rb") as wav:
+        if wav.getsampwidth() != 1 or wav.getnchannels() != 1:
+            raise ValueError("%s: not 8-bit mono" % path)
+        return wav.readframes(wav.getnframes()), wav.getframerate()
+
+
+def locate(files, offset):
+    """Returns a readable file position for an offset in the whole take."""
+    for path, start, count, rate in files:
+        if offset < start + count:
+            return "%s sample %d (%.3f s)" % (path, offset - start, (offset - start) / rate)
+    path, start, count, rate = files[-1]
+    return "%s end" % path
+
+
+def follows(samples, i, count):
+    """Returns True if samples i to i + count - 1 each continue the two before them."""
+    return all(samples[j] == pattern_next(samples[j - 1], samples[j - 2])
+               for j in range(i, min(i + count, len(samples))))
+
+
+def check(samples, files, index):
+    """Reports the breaks in the sequence, returns (breaks, lost, repeated, corrupt)."""
+    breaks = lost = repeated = corrupt = 0
+    if len(samples) < 2 or not follows(samples, 2, CONFIRM):
+        print("no test pattern at the start of the take")
+        return 1, 0, 0, 1
+    position = index[(samples[0], samples[1])]      # Position of samples[i - 1]
+    print("take starts at sequence position %d" % (position - 1))
+
+    i = 2
+    while i < len(samples):
+        if samples[i] == pattern_next(samples[i - 1], samples[i - 2]):
+            position += 1
+            i += 1
+            continue
+        breaks += 1
+        if i + 1 < len(samples) and follows(samples, i + 2, CONFIRM) and (samples[i], samples[i + 1]) in index:
+            found = index[(samples[i], samples[i + 1])]     # The sequence continues from here
+            jump = (found - position - 2) % PERIOD
+            if jump < PERIOD // 2:
+                lost += jump
+                print("%s: %d samples lost" % (locate(files, i), jump))
+            else:
+                repeated += PERIOD - jump
+                print("%s: %d samples repeated" % (locate(files, i), PERIOD - jump))
+            position = found
+            i += 2
+            continue
+        skip = i        # Not the sequence: skip to where it continues again
+        while i + 1 < len(samples) and not (follows(samples, i + 2, CONFIRM) and (samples[i], samples[i + 1]) in index):
+            i += 1
+        corrupt += i - skip
+        print("%s: %d corrupt samples" % (locate(files, skip), i - skip))
+        if i + 1 >= len(samples):
+            break
+        position = index[(samples[i], samples[i + 1])]
+        i += 2
+    return breaks, lost, repeated, corrupt
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__.strip())
+        return 2
+
+    samples = bytearray()
+    files = []
+    for path in sys.argv[1:]:
+        data, rate = read_samples(path)
+        files.append((path, len(samples), len(data), rate))
+        samples += data
+
+    breaks, lost, repeated, corrupt = check(samples, files, sequence_index())
+    print("%d samples in %d file(s): %d breaks, %d samples lost, %d repeated, %d corrupt" % (
+        len(samples), len(files), breaks, lost, repeated, corrupt))
+    return 1 if breaks else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
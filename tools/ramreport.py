@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""
+ramreport.py - EGB240DVR RAM budget report
+
+Parses the linker map (Recorder.map) and reports the static RAM taken
+by each module: initialised data (.data, including constant strings
+the compiler placed in RAM), zeroed data (.bss and COMMON) and
+uninitialised data (.noinit). Whatever is left of the 2.5 KB of RAM
+is shared by the stack; compare it with the stack high-water mark
+reported at run time (TLM_MEMORY frame, see stack.c).
+
+Run as a post-build step by Recorder.cproj, or by hand:
+    python3 tools/ramreport.py Debug/Recorder.map
+    python3 tools/ramreport.py --min-stack 512 Debug/Recorder.map
+
+With --min-stack the exit status is 1 if less than the given number
+of bytes is left for the stack.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+RAM_START = 0x800100    # First SRAM address (data space) on the ATmega32U4
+RAM_SIZE = 2560         # Bytes of SRAM
+
+SECTIONS = (".data", ".bss", ".noinit")
+INPUT_RE = re.compile(r"^ (\.[\w.]+|COMMON)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$")
+CONT_RE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+
+
+def module_name(path):
+    """Returns a short module name for an object file or archive member."""
+    path = path.strip().replace("\\", "/")
+    archive = re.match(r".*/(lib\w+)\.a\((.+)\)$", path)
+    if archive:
+        return archive.group(1)         # Group library members (libc, libgcc, libm)
+    name = re.sub(r"\.o$", "", path)
+    if name.startswith("/") or ":" in name:
+        name = os.path.basename(name)   # Start-up files
+    return name
+
+
+def parse(path):
+    """
+    Returns {module: {section: bytes}} for the RAM output sections of
+    the map file.
+    """
+    usage = {}
+    section = None
+    pending = None
+    with open(path, errors="replace") as stream:
+        for line in stream:
+            line = line.rstrip("\n")
+            output = re.match(r"^(\.\w+)\s", line + " ")
+            if output and not line.startswith(" "):
+                section = output.group(1) if output.group(1) in SECTIONS else None
+                pending = None
+                continue
+            if section is None:
+                continue
+            if pending is not None:
+                cont = CONT_RE.match(line)
+                if cont:
+                    record(usage, section, int(cont.group(1), 16), int(cont.group(2), 16), cont.group(3))
+                pending = None
+                continue
+            entry = INPUT_RE.match(line)
+            if entry:
+                if entry.group(2) is None:
+                    pending = entry.group(1)    # Address, size and file on the next line
+                else:
+                    record(usage, section, int(entry.group(2), 16), int(entry.group(3), 16), entry.group(4))
+    return usage
+
+
+def record(usage, section, address, size, path):
+    """Adds an input section to the totals if it is placed in RAM."""
+    if size == 0 or address < RAM_START:
+        return
+    module = usage.setdefault(module_name(path), dict.fromkeys(SECTIONS, 0))
+    module[section] += size
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map", help="linker map file")
+    parser.add_argument("--min-stack", type=int, default=0, help="fail if fewer bytes remain for the stack")
+    args = parser.parse_args()
+
+    usage = parse(args.map)
+    totals = dict.fromkeys(SECTIONS, 0)
+
+    print("%-28s %6s %6s %7s %6s" % ("module", ".data", ".bss", ".noinit", "total"))
+    for name, sections in sorted(usage.items(), key=lambda item: -sum(item[1].values())):
+        print("%-28s %6d %6d %7d %6d" % ((name,) + tuple(sections[s] for s in SECTIONS) + (sum(sections.values()),)))
+        for s in SECTIONS:
+            totals[s] += sections[s]
+
+    used = sum(totals.values())
+    stack = RAM_SIZE - used
+    print("%-28s %6d %6d %7d %6d" % (("total",) + tuple(totals[s] for s in SECTIONS) + (used,)))
+    print("static RAM %d of %d bytes, %d bytes left for the stack" % (used, RAM_SIZE, stack))
+
+    if stack < args.min_stack:
+        print("error: less than %d bytes left for the stack" % args.min_stack, file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+"""
+telemetry.py - EGB240DVR host-side telemetry decoder
+
+Decodes the binary telemetry frames emitted by telemetry.c into
+readable log lines. Any bytes outside valid frames (plain console
+text) are passed through unchanged. Deferred log records (log.c) are
+formatted using the message table in log_msgs.h, which is read at
+start-up so the decoder always matches the firmware source tree.
+
+Usage:
+    stty -F /dev/ttyACM0 raw
+    python3 tools/telemetry.py /dev/ttyACM0
+    python3 tools/telemetry.py capture.bin      # decode a saved capture
+"""
+
+import math
+import os
+import re
+import struct
+import sys
+
+TLM_SYNC = 0xA5
+TICK_MS = 0.064     # Timer0 tick (64 us)
+CPU_MHZ = 16.0      # CPU cycles per microsecond (latency frames)
+LOOPBACK_REPEATS = 32       # Impulses summed (loopback.h)
+LOOPBACK_MEASURE = 4096     # Samples correlated per tone (loopback.h)
+LOOPBACK_AMPLITUDE = 100    # Tone amplitude, PWM counts * 128 / 127 (loopback.h)
+
+STATES = {0: "STOPPED", 1: "RECORDING", 2: "PLAYING", 3: "MIC", 4: "SPEAKER", 5: "PAUSED", 6: "LOOPBACK",
+          7: "THROUGHPUT"}
+SD_OPS = {0: "write", 1: "read"}
+SOURCES = {0: "main", 1: "supervisor"}
+PROFILES = ["adc", "timer0", "pwm", "usb_gen", "usb_com", "wdt"]
+LOADS = ["adc", "timer0", "pwm", "foreground", "idle"]
+TASKS = ["sd_write", "sd_read", "supervise", "control", "meter", "usb", "log"]
+
+MSGS_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "log_msgs.h")
+
+
+def load_messages(path=MSGS_PATH):
+    """Returns the list of log format strings, indexed by message ID."""
+    with open(path) as f:
+        return [fmt for _, fmt in re.findall(r'^LOG_MSG\((\w+),\s*"((?:[^"\\]|\\.)*)"\)', f.read(), re.M)]
+
+
+MESSAGES = load_messages()
+
+
+def format_log(msg_id, a, b):
+    """Formats a log record against the message table."""
+    if msg_id >= len(MESSAGES):
+        return "log id=%d args=%d,%d" % (msg_id, a, b)
+    fmt = MESSAGES[msg_id]
+    return "log " + fmt % (a, b)[:fmt.count("%d")]
+
+
+def describe(ftype, payload):
+    """Returns a readable description of one frame."""
+    if ftype == 0x01 and len(payload) == 1:
+        return "state %s" % STATES.get(payload[0], payload[0])
+    if ftype == 0x02 and len(payload) == 3:
+        op, ticks = struct.unpack("<BH", payload)
+        return "sd %s %.2f ms" % (SD_OPS.get(op, op), ticks * TICK_MS)
+    if ftype == 0x03 and len(payload) == 6:
+        pages, worst, drops = struct.unpack("<HHH", payload)
+        return "stats pages=%d worst=%.2f ms console_drops=%d" % (
+            pages, worst * TICK_MS, drops)
+    if ftype == 0x04 and len(payload) == 2:
+        return "error source=%s code=%d" % (SOURCES.get(payload[0], payload[0]), payload[1])
+    if ftype == 0x05 and len(payload) == 5:
+        return format_log(*struct.unpack("<Bhh", payload))
+    if ftype == 0x06 and len(payload) == 6:
+        adc_min, adc_max, pwm_max = struct.unpack("<HHH", payload)
+        return "latency adc=%.1f-%.1f us (jitter %.1f us) pwm_max=%.1f us" % (
+            adc_min / CPU_MHZ, adc_max / CPU_MHZ, (adc_max - adc_min) / CPU_MHZ, pwm_max / CPU_MHZ)
+    if ftype == 0x07 and len(payload) == 4:
+        return "stream underruns=%d overruns=%d" % struct.unpack("<HH", payload)
+    if ftype == 0x08 and len(payload) == 2:
+        return "idle %.1f %%" % (struct.unpack("<H", payload)[0] / 10.0)
+    if ftype == 0x09 and len(payload) % 3 == 0:
+        fields = []
+        for i in range(len(payload) // 3):
+            run, misses = struct.unpack("<HB", payload[3 * i:3 * i + 3])
+            name = TASKS[i] if i < len(TASKS) else str(i)
+            fields.append("%s=%.2fms/%d" % (name, run * TICK_MS, misses))
+        return "tasks (max run/misses) " + " ".join(fields)
+    if ftype == 0x0D and len(payload) == 6:
+        data, stack, unused = struct.unpack("<HHH", payload)
+        return "memory static=%d stack max=%d never used=%d bytes" % (data, stack, unused)
+    if ftype == 0x0E and len(payload) == 12:
+        pages, breaks, lost, unresolved, first = struct.unpack("<HHIHH", payload)
+        text = "pattern pages=%d breaks=%d lost=%d samples unresolved=%d" % (
+            pages, breaks, lost, unresolved)
+        if first != 0xFFFF:
+            text += " first break in page %d" % first
+        return text
+    if ftype == 0x0F and len(payload) == 6:
+        latency, peak, rate = struct.unpack("<hhH", payload)
+        if abs(peak) < LOOPBACK_REPEATS:
+            return "loopback no response (is OC4B wired to ADC0?)"
+        return "loopback latency=%.2f samples (%.1f us) peak=%.1f counts" % (
+            latency / 100.0, latency * 1e4 / rate, peak / float(LOOPBACK_REPEATS))
+    if ftype == 0x10 and len(payload) == 10:
+        freq, in_phase, quadrature = struct.unpack("<Hii", payload)
+        scale = LOOPBACK_MEASURE * 127 * LOOPBACK_AMPLITUDE * 127 / 128.0 / 2
+        gain = math.hypot(in_phase, quadrature) / scale
+        if not gain:
+            return "response %5d Hz no signal" % freq
+        return "response %5d Hz gain=%.3f (%+.2f dB) phase=%+.1f deg" % (
+            freq, gain, 20 * math.log10(gain), math.degrees(math.atan2(in_phase, quadrature)))
+    if ftype == 0x11 and len(payload) == 11:
+        page, batch, depth, aligned, rate, worst = struct.unpack("<HBBBIH", payload)
+        text = "throughput page=%4d x%d (%4d B/write) buffer=%d pages %-9s" % (
+            page, batch, page * batch, depth, "aligned" if aligned else "unaligned")
+        if not rate:
+            return text + " no rate sustained"
+        return text + " max=%6d B/s: 8-bit %6d Hz, 16-bit %6d Hz, worst write %.2f ms" % (
+            rate, rate, rate // 2, worst * TICK_MS)
+    if ftype == 0x0C and len(payload) == 11:
+        isr, count, avg, peak, latency = struct.unpack("<BIHHH", payload)
+        name = PROFILES[isr] if isr < len(PROFILES) else str(isr)
+        text = "profile %-8s count=%d avg=%d max=%d cycles" % (name, count, avg, peak)
+        if latency:
+            text += " latency max=%d cycles (%.2f us)" % (latency, latency / CPU_MHZ)
+        return text
+    if ftype == 0x0B and len(payload) == 2:
+        (ticks,) = struct.unpack("<H", payload)
+        return "wake to sampling %.2f ms" % (ticks * TICK_MS)
+    if ftype == 0x0A and len(payload) % 2 == 0:
+        values = struct.unpack("<%dH" % (len(payload) // 2), payload)
+        fields = ["%s=%.1f%%" % (LOADS[i] if i < len(LOADS) else str(i), v / 10.0)
+                  for i, v in enumerate(values)]
+        return "load " + " ".join(fields)
+    return "unknown type=0x%02X payload=%s" % (ftype, payload.hex())
+
+
+def decode(data):
+    """
+    Splits a byte string into decoded frames and pass-through text.
+    Returns (lines, remainder) where remainder is an incomplete frame
+    to be prepended to the next chunk.
+    """
+    out = []
+    text = bytearray()
+    i = 0
+    while i < len(data):
+        if data[i] != TLM_SYNC:
+            text.append(data[i])
+            i += 1
+            continue
+        if i + 3 > len(data):
+            break                       # need type and length
+        ftype, length = data[i + 1], data[i + 2]
+        end = i + 4 + length
+        if end > len(data):
+            break                       # incomplete frame
+        payload = bytes(data[i + 3:end - 1])
+        if (ftype + length + sum(payload)) & 0xFF != data[end - 1]:
+            text.append(data[i])        # not a frame, treat as text
+            i += 1
+            continue
+        if text:
+            out.append(text.decode("ascii", "replace"))
+            text = bytearray()
+        out.append("[tlm] " + describe(ftype, payload))
+        i = end
+    if text:
+        out.append(text.decode("ascii", "replace"))
+    return out, data[i:]
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+    pending = b""
+    with open(sys.argv[1], "rb", buffering=0) as stream:
+        while True:
+            chunk = stream.read(256)
+            if not chunk:
+                break
+            lines, pending = decode(pending + chunk)
+            for line in lines:
+                print(line, flush=True)
+
+
+if __name__ == "__main__":
+    main()
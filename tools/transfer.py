@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+"""
+transfer.py - EGB240DVR host-side file transfer client
+
+Lists, downloads and uploads files on the SD card over the USB serial
+port with the framed transfer protocol of transfer.c (see transfer.h),
+and reports the throughput of every transfer in KB/s, both as timed on
+the host and from the elapsed ticks in the device's trailer frame. The
+recorder must be stopped.
+
+"bench" measures all three: it lists the card, uploads SIZE KB (default
+256) of test data as XFERTEST.BIN, downloads it again and checks that
+it came back unchanged. The scratch file is left on the card.
+
+Console text and telemetry frames that arrive before a response are
+skipped.
+
+Usage:
+    stty -F /dev/ttyACM0 raw -echo
+    python3 tools/transfer.py /dev/ttyACM0 list
+    python3 tools/transfer.py /dev/ttyACM0 get EGB240.WAV [local.wav]
+    python3 tools/transfer.py /dev/ttyACM0 put local.wav [EGB240.WAV]
+    python3 tools/transfer.py /dev/ttyACM0 bench [SIZE]
+
+The exit status is 1 if a transfer failed.
+"""
+
+import os
+import select
+import struct
+import sys
+import time
+
+XFER_SYNC = 0x7E
+CMD_LIST = ord("L")
+CMD_GET = ord("G")
+CMD_PUT = ord("P")
+CMD_CREDIT = ord("C")
+CMD_DONE = ord("T")
+TICK_S = 64e-6          # Timer0 tick (64 us)
+TIMEOUT = 2.0           # Seconds to wait for a response byte
+NAME_MAX = 12           # Longest 8.3 filename (XFER_NAME_MAX)
+BENCH_NAME = "XFERTEST.BIN"
+
+# FatFs FRESULT codes are passed through; XFER_ERR codes from transfer.h
+STATUS = ["ok", "disk error", "internal error", "not ready", "no file", "no path", "invalid name",
+          "denied", "exists", "invalid object", "write protected", "invalid drive", "not enabled",
+          "no file system", "mkfs aborted", "timeout", "locked", "not enough core",
+          "too many open files", "invalid parameter"]
+XFER_ERRORS = {0xF0: "malformed frame", 0xF1: "unknown command", 0xF2: "host stopped reading",
+               0xF3: "recorder busy"}
+
+
+class TransferError(Exception):
+    pass
+
+
+def status_text(status):
+    """Returns a readable transfer or FatFs status."""
+    if status < len(STATUS):
+        return STATUS[status]
+    return XFER_ERRORS.get(status, "status 0x%02X" % status)
+
+
+class Device:
+    """Transfer protocol over a raw serial port (opened as a file)."""
+
+    def __init__(self, path):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        self.pending = bytearray()
+
+    def close(self):
+        os.close(self.fd)
+
+    def write(self, data):
+        view = memoryview(data)
+        while view:
+            view = view[os.write(self.fd, view):]
+
+    def read(self, count):
+        """Reads exactly count bytes, or raises on timeout."""
+        while len(self.pending) < count:
+            ready, _, _ = select.select([self.fd], [], [], TIMEOUT)
+            if not ready:
+                raise TransferError("no response from the device")
+            self.pending += os.read(self.fd, 65536)
+        data = bytes(self.pending[:count])
+        del self.pending[:count]
+        return data
+
+    def command(self, cmd, payload=b""):
+        # The shell only takes a frame at the start of a line
+        self.write(b"\r" + bytes([XFER_SYNC, cmd, len(payload)]) + payload)
+
+    def frame(self, expect):
+        """Waits for a response header with a command in expect, or an
+        error frame; returns (command, status, length)."""
+        while True:
+            if self.read(1)[0] != XFER_SYNC:
+                continue                # Console text or telemetry
+            header = self.read(6)
+            if header[0] in expect or header[0] == XFER_SYNC:
+                break
+            self.pending[:0] = header   # Not a response: rescan it
+        cmd, status, length = struct.unpack("<BBI", header)
+        if cmd == XFER_SYNC:
+            raise TransferError(status_text(status))
+        return cmd, status, length
+
+    def response(self, cmd):
+        """Waits for a response header to cmd; returns (status, length)."""
+        return self.frame((cmd,))[1:]
+
+    def trailer(self, length):
+        """Reads the payload of a trailer frame; returns (bytes, seconds)."""
+        count, ticks = struct.unpack("<II", self.read(length))
+        return count, ticks * TICK_S
+
+
+def rate(count, seconds):
+    return count / 1024.0 / seconds if seconds > 0 else 0.0
+
+
+def report(label, count, host, device):
+    print("%s %d bytes: %.1f KB/s on the host (%.2f s), %.1f KB/s on the device (%.2f s)" % (
+        label, count, rate(count, host), host, rate(count, device), device))
+
+
+def do_list(dev):
+    """Returns [(name, size)] of the files in the root directory."""
+    start = time.monotonic()
+    dev.command(CMD_LIST)
+    files = []
+    while True:
+        status, length = dev.response(CMD_LIST)
+        if not length:
+            break
+        payload = dev.read(length)
+        files.append((payload[4:].split(b"\0")[0].decode("ascii", "replace"),
+                      struct.unpack("<I", payload[:4])[0]))
+    elapsed = time.monotonic() - start
+    if status:
+        raise TransferError("list: " + status_text(status))
+    for name, size in files:
+        print("%-12s %10d" % (name, size))
+    print("list %d files in %.1f ms" % (len(files), elapsed * 1000))
+    return files
+
+
+def do_get(dev, name):
+    """Downloads a file; returns its contents."""
+    start = time.monotonic()
+    dev.command(CMD_GET, name.encode("ascii"))
+    status, size = dev.response(CMD_GET)
+    if status:
+        raise TransferError("get %s: %s" % (name, status_text(status)))
+    try:
+        data = dev.read(size)
+    except TransferError:       # The device ended the file early
+        raise TransferError("get %s: stopped before %d bytes" % (name, size))
+    elapsed = time.monotonic() - start
+    status, length = dev.response(CMD_DONE)
+    count, ticks = dev.trailer(length)
+    if status:
+        raise TransferError("get %s: %s after %d bytes" % (name, status_text(status), count))
+    report("get %s" % name, count, elapsed, ticks)
+    return data
+
+
+def do_put(dev, name, data):
+    """Uploads data as a file, a credited block at a time."""
+    start = time.monotonic()
+    dev.command(CMD_PUT, struct.pack("<I", len(data)) + name.encode("ascii"))
+    status, _ = dev.response(CMD_PUT)
+    if status:
+        raise TransferError("put %s: %s" % (name, status_text(status)))
+    sent = 0
+    while True:                 # Credits until the trailer, which ends early on an error
+        cmd, status, length = dev.frame((CMD_CREDIT, CMD_DONE))
+        if cmd == CMD_DONE:
+            break
+        dev.write(data[sent:sent + length])
+        sent += length
+    count, ticks = dev.trailer(length)
+    elapsed = time.monotonic() - start
+    if status:
+        raise TransferError("put %s: %s after %d bytes" % (name, status_text(status), count))
+    report("put %s" % name, count, elapsed, ticks)
+
+
+def do_bench(dev, size):
+    data = bytes((i * 7 + (i >> 9)) & 0xFF for i in range(size))
+    do_list(dev)
+    do_put(dev, BENCH_NAME, data)
+    if do_get(dev, BENCH_NAME) != data:
+        raise TransferError("get %s: contents differ from the upload" % BENCH_NAME)
+
+
+def card_name(path):
+    name = os.path.basename(path).upper()
+    if len(name) > NAME_MAX:
+        raise TransferError("%s is not an 8.3 filename" % name)
+    return name
+
+
+def main():
+    args = sys.argv[1:]
+    if len(args) < 2 or args[1] not in ("list", "get", "put", "bench"):
+        print(__doc__.strip())
+        return 2
+
+    dev = Device(args[0])
+    try:
+        if args[1] == "list":
+            do_list(dev)
+        elif args[1] == "get" and len(args) in (3, 4):
+            data = do_get(dev, card_name(args[2]))
+            with open(args[3] if len(args) == 4 else args[2], "wb") as f:
+                f.write(data)
+        elif args[1] == "put" and len(args) in (3, 4):
+            with open(args[2], "rb") as f:
+                data = f.read()
+            do_put(dev, card_name(args[3] if len(args) == 4 else args[2]), data)
+        elif args[1] == "bench" and len(args) <= 3:
+            do_bench(dev, 1024 * (int(args[2]) if len(args) == 3 else 256))
+        else:
+            print(__doc__.strip())
+            return 2
+    except TransferError as error:
+        print("error: %s" % error)
+        return 1
+    finally:
+        dev.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,341 @@
+/**
+ * transfer.c - EGB240DVR Library, USB file transfer module
+ *
+ * Implements a framed file transfer protocol over the USB serial
+ * interface so that recordings can be retrieved without removing
+ * the SD card. See transfer.h for the frame format.
+ *
+ * Downloads read the file in 1024 byte blocks directly into the
+ * circular buffer memory (both pages). Reads of whole sectors are
+ * passed straight through FatFs to the card as multi-block reads,
+ * and each block is handed to usb_serial_write, which fills the
+ * 64 byte bulk endpoint a packet at a time. A trailer frame reports
+ * the number of bytes sent and the elapsed time in Timer0 ticks so
+ * the host can compute the achieved throughput.
+ *
+ * Uploads are flow controlled by credit frames. The device grants the
+ * host one 1024 byte block (both buffer pages) at a time, receives it
+ * straight out of the bulk OUT endpoint with usb_serial_read, and
+ * writes it with a single multi-sector f_write before granting the
+ * next block, so the host can never overrun the buffer. The same
+ * trailer frame reports the sustained upload throughput.
+ *
+ * Frames arrive through the command shell, which hands over as soon
+ * as it sees a sync byte at the start of a line. Transfers must only
+ * be started while the recorder is stopped, as the circular buffer and
+ * the WAVE file structure are shared with the record/playback pipeline.
+ *
+ * Requires:
+ *   lib/fatfs - FatFs FAT file system library published by ChaN
+ *   lib/usb_serial - USB serial library published by PJRC.com
+ *   buffer - Circular buffer, used as transfer memory
+ *   timer - Timer module, used for timeouts and throughput timing
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+// Not available when USB is configured as a mass storage or audio device
+#if !defined(USB_MSC_MODE) && !defined(USB_AUDIO_MODE)
+
+/************************************************************************/
+/* INCLUDED LIBRARIES/HEADER FILES                                      */
+/************************************************************************/
+#include <avr/io.h>
+
+#include <string.h>
+
+#include "lib/fatfs/ff.h"
+#include "lib/usb_serial/usb_serial.h"
+
+#include "buffer.h"
+#include "timer.h"
+#include "transfer.h"
+
+/************************************************************************/
+/* DEFINES                                                              */
+/************************************************************************/
+#define XFER_TIMEOUT	1563	// Command byte timeout in ticks (~100 ms)
+#define XFER_RX_TIMEOUT	7813	// Upload data timeout in ticks (~500 ms)
+#define XFER_BLOCK		1024	// Bytes read from/written to SD card per block (2 sectors)
+#define XFER_NAME_MAX	12		// Longest 8.3 filename
+#define XFER_PAYLOAD_MAX (4 + XFER_NAME_MAX)	// Longest command payload (PUT)
+
+/************************************************************************/
+/* GLOBAL VARIABLES                                                     */
+/************************************************************************/
+extern FIL file;	// File structure shared with the WAVE module
+
+/************************************************************************/
+/* PRIVATE/UTILLITY FUNCTIONS                                           */
+/************************************************************************/
+
+/**
+ * Function: xfer_getc
+ *
+ * Waits for the next byte of a command frame.
+ *
+ * Returns: The received byte, or -1 on timeout.
+ */
+static int16_t xfer_getc() {
+	int16_t c;
+	uint32_t start = timer_ticks();
+
+	do {
+		c = usb_serial_getchar();
+		if (c >= 0) return c;
+	} while ((timer_ticks() - start) < XFER_TIMEOUT);
+
+	return -1;
+}
+
+/**
+ * Function: xfer_respond
+ *
+ * Sends a response frame header.
+ *
+ * Parameters:
+ *    cmd - Command being responded to.
+ *    status - XFER_OK, an XFER_ERR code or a FatFs result code.
+ *    length - Number of payload bytes that follow the header.
+ *
+ * Returns: 0 on success, -1 if the host is not reading.
+ */
+static int8_t xfer_respond(uint8_t cmd, uint8_t status, uint32_t length) {
+	uint8_t header[7];
+
+	header[0] = XFER_SYNC;
+	header[1] = cmd;
+	header[2] = status;
+	memcpy(&header[3], &length, 4);		// Little endian on AVR
+
+	return usb_serial_write(header, sizeof(header));
+}
+
+/**
+ * Function: xfer_list
+ *
+ * Sends one frame per file in the root directory. Each payload is the
+ * file size (uint32) followed by the null terminated 8.3 filename.
+ * An empty frame terminates the list.
+ */
+static void xfer_list() {
+	FRESULT result;
+	DIR dir;
+	FILINFO info;
+
+	result = f_opendir(&dir, "/");
+	while (result == FR_OK) {
+		result = f_readdir(&dir, &info);
+		if (result || !info.fname[0]) break;	// Error or end of directory
+		if (info.fattrib & (AM_DIR | AM_HID | AM_SYS)) continue;
+
+		if (xfer_respond(XFER_CMD_LIST, XFER_OK, 4 + sizeof(info.fname))) return;
+		usb_serial_write((uint8_t*)&info.fsize, 4);
+		usb_serial_write((uint8_t*)info.fname, sizeof(info.fname));
+	}
+
+	xfer_respond(XFER_CMD_LIST, result, 0);
+	usb_serial_flush_output();
+}
+
+/**
+ * Function: xfer_done
+ *
+ * Sends the trailer frame ending a download or upload.
+ *
+ * Parameters:
+ *    status - Final status of the transfer.
+ *    bytes - Number of file bytes transferred.
+ *    start - Tick count when the transfer started.
+ */
+static void xfer_done(uint8_t status, uint32_t bytes, uint32_t start) {
+	uint32_t stats[2];
+
+	// Bytes transferred and elapsed ticks (64 us) for throughput
+	stats[0] = bytes;
+	stats[1] = timer_ticks() - start;
+	xfer_respond(XFER_CMD_DONE, status, sizeof(stats));
+	usb_serial_write((uint8_t*)stats, sizeof(stats));
+	usb_serial_flush_output();
+}
+
+/**
+ * Function: xfer_get
+ *
+ * Streams a file to the host. The response header carries the file
+ * size, followed by the raw file contents and a trailer frame.
+ *
+ * Parameters:
+ *    name - Null terminated 8.3 filename in the root directory.
+ */
+static void xfer_get(const char* name) {
+	FRESULT result;
+	UINT br;
+	uint8_t status = XFER_OK;
+	uint8_t* block = buffer_block();
+	uint32_t sent = 0;
+	uint32_t start;
+
+	result = f_open(&file, name, FA_READ);
+	if (result) {
+		xfer_respond(XFER_CMD_GET, result, 0);
+		usb_serial_flush_output();
+		return;
+	}
+
+	start = timer_ticks();
+	xfer_respond(XFER_CMD_GET, XFER_OK, file.fsize);
+
+	while (sent < file.fsize) {
+		result = f_read(&file, block, XFER_BLOCK, &br);
+		if (result || !br) {
+			status = result ? result : FR_INT_ERR;
+			break;
+		}
+		if (usb_serial_write(block, br)) {
+			status = XFER_ERR_USB;
+			break;
+		}
+		sent += br;
+	}
+
+	f_close(&file);
+
+	xfer_done(status, sent, start);
+}
+
+/**
+ * Function: xfer_put
+ *
+ * Receives a file from the host, one credited block at a time, and
+ * writes it to the SD card. Any existing file is overwritten.
+ *
+ * Parameters:
+ *    size - Number of bytes the host will send.
+ *    name - Null terminated 8.3 filename in the root directory.
+ */
+static void xfer_put(uint32_t size, const char* name) {
+	FRESULT result;
+	UINT bw;
+	uint16_t want, got;
+	uint8_t status = XFER_OK;
+	uint8_t* block = buffer_block();
+	uint32_t received = 0;
+	uint32_t start, last;
+
+	result = f_open(&file, name, FA_CREATE_ALWAYS | FA_WRITE);
+	xfer_respond(XFER_CMD_PUT, result, 0);
+	if (result) {
+		usb_serial_flush_output();
+		return;
+	}
+
+	start = timer_ticks();
+	while (received < size) {
+		want = (size - received) < XFER_BLOCK ? (size - received) : XFER_BLOCK;
+
+		// Grant the host one block, then collect it
+		xfer_respond(XFER_CMD_CREDIT, XFER_OK, want);
+		usb_serial_flush_output();
+		got = 0;
+		last = timer_ticks();
+		while (got < want) {
+			bw = usb_serial_read(block + got, want - got);
+			if (bw) {
+				got += bw;
+				last = timer_ticks();
+			} else if ((timer_ticks() - last) >= XFER_RX_TIMEOUT) {
+				break;
+			}
+		}
+		if (got < want) {
+			status = XFER_ERR_USB;
+			break;
+		}
+
+		result = f_write(&file, block, want, &bw);
+		if (result || bw != want) {
+			status = result ? result : FR_DENIED;	// Volume full
+			break;
+		}
+		received += want;
+	}
+
+	result = f_close(&file);
+	if (status == XFER_OK) status = result;
+	if (status != XFER_OK) usb_serial_flush_input();
+
+	xfer_done(status, received, start);
+}
+
+/************************************************************************/
+/* PUBLIC/USER FUNCTIONS                                                */
+/************************************************************************/
+
+/**
+ * Function: transfer_frame
+ *
+ * Receives and executes a single command frame. The sync byte must
+ * already have been consumed (see shell_poll). Must only be called
+ * while the recorder is stopped.
+ */
+void transfer_frame() {
+	int16_t c;
+	uint8_t cmd, len, i;
+	char payload[XFER_PAYLOAD_MAX + 1];
+	uint32_t size;
+
+	// Command and payload length
+	if ((c = xfer_getc()) < 0) goto frame_error;
+	cmd = c;
+	if ((c = xfer_getc()) < 0) goto frame_error;
+	len = c;
+	if (len > XFER_PAYLOAD_MAX) goto frame_error;
+
+	// Payload
+	for (i = 0; i < len; i++) {
+		if ((c = xfer_getc()) < 0) goto frame_error;
+		payload[i] = c;
+	}
+	payload[len] = '\0';
+
+	switch (cmd) {
+		case XFER_CMD_LIST:
+			xfer_list();
+			break;
+		case XFER_CMD_GET:
+			xfer_get(payload);
+			break;
+		case XFER_CMD_PUT:
+			if (len < 5) goto frame_error;
+			memcpy(&size, payload, 4);		// Little endian on AVR
+			xfer_put(size, payload + 4);
+			break;
+		default:
+			xfer_respond(cmd, XFER_ERR_CMD, 0);
+			usb_serial_flush_output();
+			break;
+	}
+	return;
+
+frame_error:
+	usb_serial_flush_input();
+	xfer_respond(XFER_SYNC, XFER_ERR_FRAME, 0);
+	usb_serial_flush_output();
+}
+
+/**
+ * Function: transfer_busy
+ *
+ * Rejects a command frame received while recording or playing. The
+ * rest of the frame is discarded.
+ */
+void transfer_busy() {
+	usb_serial_flush_input();
+	xfer_respond(XFER_SYNC, XFER_ERR_BUSY, 0);
+	usb_serial_flush_output();
+}
+
+#endif /* !USB_MSC_MODE && !USB_AUDIO_MODE */
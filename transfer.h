@@ -0,0 +1,42 @@
+/**
+ * transfer.h - EGB240DVR Library, USB file transfer module header
+ *
+ * Framed file transfer protocol over the USB serial interface.
+ * Allows recordings to be listed and downloaded, and WAVE files to be
+ * uploaded for playback, without removing the SD card.
+ *
+ * Command frame (host to device):
+ *   XFER_SYNC, command, length, payload[length]
+ *
+ * Response frame (device to host):
+ *   XFER_SYNC, command, status, length (uint32, little endian),
+ *   followed by length bytes of payload
+ *
+ * Version: v1.0
+ *    Date: 18/10/2026
+ *  Author: Group 420
+ */
+
+#ifndef TRANSFER_H_
+#define TRANSFER_H_
+
+#define XFER_SYNC		0x7E	// First byte of every frame
+
+// Commands
+#define XFER_CMD_LIST	'L'		// List files in root directory (one frame per file, empty frame ends list)
+#define XFER_CMD_GET	'G'		// Download the file named in the payload
+#define XFER_CMD_PUT	'P'		// Upload a file (payload: uint32 size, then filename)
+#define XFER_CMD_CREDIT	'C'		// Device ready to receive the number of bytes given in length
+#define XFER_CMD_DONE	'T'		// Trailer sent after a transfer (bytes, elapsed ticks)
+
+// Status codes (FatFs FRESULT codes are passed through unchanged)
+#define XFER_OK			0x00
+#define XFER_ERR_FRAME	0xF0	// Malformed or timed out command frame
+#define XFER_ERR_CMD	0xF1	// Unknown command
+#define XFER_ERR_USB	0xF2	// Host stopped reading during transfer
+#define XFER_ERR_BUSY	0xF3	// Recorder not stopped, frame discarded
+
+void transfer_frame();	// Receives and executes one command frame (sync byte already read)
+void transfer_busy();	// Discards a command frame received while not stopped
+
+#endif /* TRANSFER_H_ */
@@ -2,13 +2,14 @@
  * wave.c - EGB240DVR Library, WAVE file interface
  *
  * Provides an interface to read and write WAVE files to an SD card via
- * the FATFS library. This implementation hardcodes the WAVE filename 
- * to "EGB240.WAV" in the root directory of the SD card.
+ * the FATFS library. WAVE files are located in the root directory of the
+ * SD card. The filename defaults to "EGB240.WAV" and can be changed with
+ * wave_select.
  *
  * Requires:
  *   lib/fatfs - FatFs FAT file system library published by ChaN
  *   timer - Timer module, used to service the FatFs library
- *   serial - USB serial interface to provide debugging information
+ *   log - Deferred logging, used to report errors
  *
  * Hardware resources:
  *   The WAVE file modules accesses an SD card via the SPI interface.
@@ -32,11 +33,11 @@
 #include <avr/io.h>
 
 #include <string.h>
-#include <stdio.h>
 
 #include "lib/fatfs/ff.h"
 #include "lib/fatfs/diskio.h"
 
+#include "log.h"
 #include "wave.h"
 
 /************************************************************************/
@@ -51,6 +52,11 @@ volatile uint32_t sampleCount = 0;	// Sample counter (used to finalise WAVE head
 
 uint8_t finaliseHeader = 0;			// Flag to indicate header must be updated/finalised
 
+char waveName[13] = "EGB240.WAV";	// Filename (8.3) selected for wave_create/wave_open
+char segmentName[13];				// Filename of a continuation segment (see wave_segment)
+const char* openName = waveName;	// Filename actually used by wave_create/wave_open
+uint32_t waveRate = 15625;			// Sample rate written to new WAVE headers
+
 /************************************************************************/
 /* FUNCTION PROTOTYPES                                                  */
 /************************************************************************/
@@ -113,18 +119,19 @@ void initialise_header(uint32_t samplerate, uint8_t bps, uint8_t channels) {
  * Function: write_wave_header
  * 
  * Writes a WAVE header structure into an open file.
- * Wave configuration is hardcoded to 15625 samples per second, 8 bits per sample, mono.
+ * Wave configuration is 8 bits per sample, mono, at the rate set by wave_set_samplerate
+ * (15625 samples per second by default).
  */
 void write_wave_header() {
 	FRESULT result;
-	uint16_t bw;
+	UINT bw;
 	
-	initialise_header(15625, 8, 1);	// Create header for 15.625 kHz, 8-bit per sample, mono WAVE file
+	initialise_header(waveRate, 8, 1);	// Create header for 8-bit per sample, mono WAVE file
 	result = f_write(&file, &(waveHeader.bytes), 44, &bw); // Write header to file
 
-	// If error has occurred, write status to console
-	if (result) printf("f_write returned error code: %d\n", result);
-	if (bw != 44) printf("f_write wrote %d of 44 bytes to file.", bw);
+	// If error has occurred, log status
+	if (result) log_write(LOG_WRITE_ERR, result, 0);
+	if (bw != 44) log_write(LOG_WRITE_SHORT, bw, 44);
 	
 	// Flag that header requires finalisation
 	finaliseHeader = 1;
@@ -139,14 +146,14 @@ void write_wave_header() {
  */
 uint32_t read_wave_header() {
 	FRESULT result;
-	uint16_t br;
+	UINT br;
 	
 	// Read header from WAVE file into structure
 	result = f_read(&file, &(waveHeader.bytes), 44, &br);
 
-	// If error has occurred, write status to console
-	if (result) printf("f_read returned error code: %d\n", result);
-	if (br != 44) printf("f_read read %d of 44 bytes from file.", br);
+	// If error has occurred, log status
+	if (result) log_write(LOG_READ_ERR, result, 0);
+	if (br != 44) log_write(LOG_READ_SHORT, br, 44);
 	
 	
 	if (result | (br != 44)) {
@@ -164,25 +171,25 @@ uint32_t read_wave_header() {
  */
 void finalise_wave_header() {
 	FRESULT result;
-	uint16_t bw;
+	UINT bw;
 	
 	// Calculate header fields to update
 	uint32_t dataSize = sampleCount;
 	uint32_t chunkSize = 36 + dataSize;
 	
 	// Finalise wave file header
-	// Where errors occur, print to console
+	// Where errors occur, log status
 	result = f_lseek(&file, 4);						// Seek to dataSize location
-	if (result) printf("f_lseek returned error code: %d\n", result);
+	if (result) log_write(LOG_LSEEK_ERR, result, 0);
 	result = f_write(&file, &chunkSize, 4, &bw);	// Write dataSize field to file
-	if (result) printf("f_write returned error code: %d\n", result);
-	if (bw != 4) printf("f_write wrote %d of 4 bytes to file.", bw);
+	if (result) log_write(LOG_WRITE_ERR, result, 0);
+	if (bw != 4) log_write(LOG_WRITE_SHORT, bw, 4);
 	
 	result = f_lseek(&file, 40);					// Seek to chunkSize location
-	if (result) printf("f_lseek returned error code: %d\n", result);
+	if (result) log_write(LOG_LSEEK_ERR, result, 0);
 	result = f_write(&file, &dataSize, 4, &bw);		// Write chuckSize field to file
-	if (result) printf("f_write returned error code: %d\n", result);
-	if (bw != 4) printf("f_write wrote %d of 4 bytes to file.", bw);
+	if (result) log_write(LOG_WRITE_ERR, result, 0);
+	if (bw != 4) log_write(LOG_WRITE_SHORT, bw, 4);
 }
 
 /************************************************************************/
@@ -200,15 +207,80 @@ void wave_init() {
 	
 	result = f_mount(&fs, "/", 1);	// force mount SD card root directory
 
-	// If error occurs, write status to console
-	if (result) printf("f_mount returned error code: %d\n", result);
+	// If error occurs, log status
+	if (result) log_write(LOG_MOUNT_ERR, result, 0);
+}
+
+/**
+ * Function: wave_select
+ * 
+ * Selects the file used by subsequent calls to wave_create and wave_open.
+ * Names longer than 12 characters (8.3 format) are truncated.
+ *
+ * Parameters:
+ *    name - Null terminated filename in the root directory.
+ */
+void wave_select(const char* name) {
+	strncpy(waveName, name, sizeof(waveName) - 1);
+	waveName[sizeof(waveName) - 1] = '\0';
+	openName = waveName;
+}
+
+/**
+ * Function: wave_selected
+ * 
+ * Returns: The currently selected filename.
+ */
+const char* wave_selected() {
+	return waveName;
+}
+
+/**
+ * Function: wave_segment
+ * 
+ * Selects a continuation segment of the selected file for subsequent
+ * calls to wave_create/wave_open. Segment n of "EGB240.WAV" is named
+ * "EGB240nn.WAV" (up to six characters of the name and two digits).
+ *
+ * Parameters:
+ *    segment - Segment number (1 to 99), or 0 for the selected file.
+ */
+void wave_segment(uint8_t segment) {
+	uint8_t i;
+	
+	if (!segment) {
+		openName = waveName;
+		return;
+	}
+	
+	// Up to 6 characters of the selected name, then a two digit segment number
+	for (i = 0; i < 6 && waveName[i] && waveName[i] != '.'; i++) {
+		segmentName[i] = waveName[i];
+	}
+	segmentName[i++] = '0' + (segment / 10) % 10;
+	segmentName[i++] = '0' + segment % 10;
+	strcpy(&segmentName[i], ".WAV");
+	openName = segmentName;
+}
+
+/**
+ * Function: wave_set_samplerate
+ * 
+ * Sets the sample rate written into the header of files created
+ * by subsequent calls to wave_create.
+ *
+ * Parameters:
+ *    samplerate - Sample rate in samples per second.
+ */
+void wave_set_samplerate(uint32_t samplerate) {
+	waveRate = samplerate;
 }
 
 /**
  * Function: wave_create
  * 
  * Creates a and initialises a WAVE file for read/write access.
- * The WAVE filename is hardcoded to "EGB240.WAV"
+ * The WAVE filename is set by wave_select (default "EGB240.WAV").
  * If a file with the same name exists it is overwritten and cleared.
  * The created WAVE file is initialised with an empty header.
  *
@@ -219,10 +291,10 @@ void wave_create() {
 	FRESULT result;
 	
 	// Create new WAVE file with read/write access (force overwrite if file exists)
-	result = f_open(&file, "EGB240.WAV", FA_CREATE_ALWAYS | FA_READ | FA_WRITE);
+	result = f_open(&file, openName, FA_CREATE_ALWAYS | FA_READ | FA_WRITE);
 
-	// If error occurs, write status to console
-	if (result) printf("f_open returned error code: %d\n", result);
+	// If error occurs, log status
+	if (result) log_write(LOG_OPEN_ERR, result, 0);
 	
 	// Write WAVE file header to file
 	write_wave_header();
@@ -235,7 +307,7 @@ void wave_create() {
  * Function: wave_open
  * 
  * Opens an existing WAVE file for read only access.
- * The WAVE filename is hardcoded to "EGB240.WAV"
+ * The WAVE filename is set by wave_select (default "EGB240.WAV").
  *
  * Returns: The number of samples in the opened WAVE file.
  */
@@ -243,15 +315,41 @@ uint32_t wave_open() {
 	FRESULT result;
 	
 	// Open an existing WAVE file with read only access
-	result = f_open(&file, "EGB240.WAV", FA_READ);
+	result = f_open(&file, openName, FA_READ);
 
-	// If error occurs, write status to console
-	if (result) printf("f_open returned error code: %d\n", result);
+	// If error occurs, log status
+	if (result) log_write(LOG_OPEN_ERR, result, 0);
 	
 	// Read the WAVE file header and return the number of samples reported
 	return read_wave_header();
 }
 
+/**
+ * Function: wave_sync
+ * 
+ * Makes a WAVE file opened with wave_create valid on the card without
+ * closing it: the header is updated for the samples written so far and
+ * the file size and cached data are flushed. Writing continues at the
+ * end of the file, so resuming needs no further directory or FAT access.
+ */
+void wave_sync() {
+	FRESULT result;
+	DWORD end = f_tell(&file);
+	
+	if (finaliseHeader) {
+		// Header stays flagged, wave_close updates it again
+		finalise_wave_header();
+		result = f_lseek(&file, end);				// Back to the end of the samples
+		if (result) log_write(LOG_LSEEK_ERR, result, 0);
+	}
+	
+	// Flush file size, FAT and cached sector to the card
+	result = f_sync(&file);
+	
+	// If error occurs, log status
+	if (result) log_write(LOG_SYNC_ERR, result, 0);
+}
+
 /**
  * Function: wave_close
  * 
@@ -269,8 +367,8 @@ void wave_close() {
 	// Close WAVE file
 	result = f_close(&file);
 
-	// If error occurs, write status to console
-	if (result) printf("f_close returned error code: %d\n", result);
+	// If error occurs, log status
+	if (result) log_write(LOG_CLOSE_ERR, result, 0);
 }
 
 /**
@@ -282,19 +380,23 @@ void wave_close() {
  * Parameters:
  *    pSamples - Pointer to array of 8-bit audio samples to write to WAVE file.
  *    count - Number of samples to write from array into WAVE file.
+ *
+ * Returns: 0 on success, a FatFs error code, or 1 if the write was short.
  */
-void wave_write(uint8_t* pSamples, uint16_t count) {
+uint8_t wave_write(uint8_t* pSamples, uint16_t count) {
 	FRESULT result;
-	uint16_t bw;
+	UINT bw;
 	
 	result = f_write(&file, pSamples, count, &bw); // Write samples to file
 
-	// If error occurs, write status to console
-	if (result) printf("f_write returned error code: %d\n", result);
-	if (bw != count) printf("f_write wrote %d of %d bytes to file.", bw, count);
+	// If error occurs, log status
+	if (result) log_write(LOG_WRITE_ERR, result, 0);
+	if (bw != count) log_write(LOG_WRITE_SHORT, bw, count);
 
 	// Increment sample count by number of samples written to file
 	sampleCount += bw;
+	
+	return result ? result : (bw != count);
 }
 
 /**
@@ -306,14 +408,35 @@ void wave_write(uint8_t* pSamples, uint16_t count) {
  * Parameters:
  *    pSamples - Pointer to array of 8-bit audio samples into which samples will be read.
  *    count - Number of samples to read into array from WAVE file.
+ *
+ * Returns: 0 on success, a FatFs error code, or 1 if the read was short.
  */
-void wave_read(uint8_t* pSamples, uint16_t count) {
+uint8_t wave_read(uint8_t* pSamples, uint16_t count) {
 	FRESULT result;
-	uint16_t br;
+	UINT br;
 	
 	result = f_read(&file, pSamples, count, &br); // Read samples from file
 
-	// If error occurs, write status to console
-	if (result) printf("f_write returned error code: %d\n", result);
-	if (br != count) printf("f_write wrote %d of %d bytes to file.", br, count);
+	// If error occurs, log status
+	if (result) log_write(LOG_READ_ERR, result, 0);
+	if (br != count) log_write(LOG_READ_SHORT, br, count);
+	
+	return result ? result : (br != count);
+}
+
+/**
+ * Function: wave_seek
+ * 
+ * Moves the read/write position of an open WAVE file to a sample.
+ *
+ * Parameters:
+ *    sample - Sample number (byte offset from the start of the data).
+ */
+void wave_seek(uint32_t sample) {
+	FRESULT result;
+	
+	result = f_lseek(&file, 44 + sample);	// Samples follow the 44 byte header
+
+	// If error occurs, log status
+	if (result) log_write(LOG_LSEEK_ERR, result, 0);
 }
\ No newline at end of file
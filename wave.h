@@ -2,8 +2,8 @@
  * wave.h - EGB240DVR Library, WAVE file interface header
  *
  * Provides an interface to read and write WAVE files to an SD card via
- * the FATFS library. This implementation hardcodes the WAVE filename 
- * to "EGB240.WAV" in the root directory of the SD card.
+ * the FATFS library. WAVE files are located in the root directory of the
+ * SD card; the filename defaults to "EGB240.WAV".
  *
  * Version: v1.0
  *    Date: 10/04/2016
@@ -41,10 +41,16 @@ typedef union {
 } WAVE_HEADER;
 
 void wave_init();		// Initialise WAVE file interface
+void wave_select(const char* name);				// Select file used by wave_create/wave_open
+const char* wave_selected();					// Returns the selected filename
+void wave_segment(uint8_t segment);				// Use continuation file n of the selection (0: the selection)
+void wave_set_samplerate(uint32_t samplerate);	// Set sample rate for new WAVE files
 void wave_create();		// Create and open new WAVE file (read/write)
 uint32_t wave_open();	// Open existing wave file (read only)
-void wave_write(uint8_t* pSamples, uint16_t count);	// Write samples to a WAVE file
-void wave_read(uint8_t* pSamples, uint16_t count);	// Read samples from WAVE file
+uint8_t wave_write(uint8_t* pSamples, uint16_t count);	// Write samples to a WAVE file (0 on success)
+uint8_t wave_read(uint8_t* pSamples, uint16_t count);	// Read samples from WAVE file (0 on success)
+void wave_seek(uint32_t sample);	// Move to a sample of a WAVE file opened with wave_open
+void wave_sync();		// Make a file opened with wave_create valid on the card, keep it open
 void wave_close();		// Close wave file opened with wave_create or wave_open
 
 #endif /* WAVE_H_ */
\ No newline at end of file